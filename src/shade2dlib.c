@@ -1,8 +1,25 @@
+#define _POSIX_C_SOURCE 200809L
+#define GL_GLEXT_PROTOTYPES  // Framebuffer objects, exported directly by libGL on Linux
+
 #include "shade2dlib.h"
 #include <GLFW/glfw3.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
 #include <string.h>
+#include <float.h>
+#include <time.h>
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -11,6 +28,48 @@
 // Define ObjectID if not already defined (assuming it's an unsigned int for IDs)
 typedef unsigned int ObjectID;  // This should ideally be in the header, but adding here for completeness if missing
 
+// Everything the input functions can observe during one frame
+typedef struct {
+    unsigned char keys[(SHAD2D_KEY_LAST + 8) / 8];  // Bit per key code
+    unsigned char buttons;                          // Bit per mouse button
+    double mouse_x, mouse_y;
+    uint32_t dt_us;  // Frame time in microseconds, so replays see identical values
+} Shade2DInputFrame;
+
+struct Window2DState {
+    bool closed;
+    RenderLayer2D *layers;
+
+    // Input for the current frame, polled from GLFW or decoded from a replay
+    Shade2DInputFrame input;
+    double frame_start;
+    FILE *recording;
+    Shade2DInputFrame recorded;  // Last frame written, the base for the next delta
+    unsigned char *replay;
+    size_t replay_size, replay_offset;
+
+    // Software rendering, used by headless windows
+    uint32_t *pixels;       // Window framebuffer, RGBA bytes
+    uint32_t *target;       // Current destination: pixels, or a layer being redrawn
+    int target_width, target_height;
+    uint32_t clear_color;
+    uint32_t color;
+
+    int circle_segments;  // 0 means the default
+};
+
+static uint32_t shade2d_pack_rgba(unsigned char r, unsigned char g, unsigned char b, unsigned char a) {
+    // Byte order in memory is R, G, B, A on little-endian hosts
+    return (uint32_t)r | ((uint32_t)g << 8) | ((uint32_t)b << 16) | ((uint32_t)a << 24);
+}
+
+// Returns the software renderer state when drawing should skip OpenGL
+static Window2DState *shade2d_software(Window2D window) {
+    return (!window.handle && window.state && window.state->target) ? window.state : NULL;
+}
+
+static void shade2d_begin_input_frame(Window2D window);
+
 Window2D shade2d_init_window(const char* title, int width, int height) {
     if (!glfwInit()) {
         exit(EXIT_FAILURE);
@@ -33,22 +92,82 @@ Window2D shade2d_init_window(const char* title, int width, int height) {
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+
+    window.state = calloc(1, sizeof(Window2DState));
+    shade2d_begin_input_frame(window);
     
     return window;
 }
 
+Window2D shade2d_init_headless_window(const char* title, int width, int height) {
+    Window2D window;
+    window.width = width;
+    window.height = height;
+    window.title = title;
+    window.handle = NULL;
+
+    // Everything is drawn into a CPU framebuffer instead of an OpenGL context
+    window.state = calloc(1, sizeof(Window2DState));
+    window.state->pixels = calloc((size_t)width * height, sizeof(uint32_t));
+    if (!window.state->pixels) {
+        exit(EXIT_FAILURE);
+    }
+    window.state->target = window.state->pixels;
+    window.state->target_width = width;
+    window.state->target_height = height;
+    window.state->clear_color = shade2d_pack_rgba(0, 0, 0, 255);
+    window.state->color = shade2d_pack_rgba(255, 255, 255, 255);
+    shade2d_begin_input_frame(window);
+
+    return window;
+}
+
 void shade2d_destroy_window(Window2D window) {
-    glfwDestroyWindow(window.handle);
-    glfwTerminate();
+    if (window.state) {
+        while (window.state->layers) {
+            shade2d_destroy_render_layer(window, window.state->layers);
+        }
+        shade2d_stop_input_recording(window);
+        free(window.state->replay);
+        free(window.state->pixels);
+        free(window.state);
+    }
+    if (window.handle) {
+        glfwDestroyWindow(window.handle);
+        glfwTerminate();
+    }
+}
+
+void shade2d_close_window(Window2D window) {
+    if (window.state) {
+        window.state->closed = true;
+    }
+    if (window.handle) {
+        glfwSetWindowShouldClose(window.handle, 1);
+    }
 }
 
 bool shade2d_is_running(Window2D window) {
+    if (!window.handle) {
+        return window.state && !window.state->closed;
+    }
     return !glfwWindowShouldClose(window.handle);
 }
 
 void shade2d_update_window(Window2D window) {
-    glfwSwapBuffers(window.handle);
-    glfwPollEvents();
+    // Headless windows have nothing to present, the framebuffer is read directly
+    if (window.handle) {
+        glfwSwapBuffers(window.handle);
+        glfwPollEvents();
+    }
+    shade2d_begin_input_frame(window);
+}
+
+const unsigned char* shade2d_get_framebuffer(Window2D window) {
+    if (window.handle || !window.state) {
+        return NULL;
+    }
+    return (const unsigned char*)window.state->pixels;
 }
 
 int shade2d_get_width(Window2D window) {
@@ -60,7 +179,9 @@ int shade2d_get_height(Window2D window) {
 }
 
 void shade2d_set_window_fps(Window2D window, int fps) {
-    (void)window; // Mark as unused
+    if (!window.handle) {
+        return;  // Headless windows run as fast as possible
+    }
     if (fps <= 0) {
         glfwSwapInterval(0); // Unlimited frame rate
     } else {
@@ -73,14 +194,127 @@ void shade2d_set_window_fps(Window2D window, int fps) {
     }
 }
 
+void shade2d_set_circle_segments(Window2D window, int segments) {
+    if (window.state) {
+        window.state->circle_segments = segments < 3 ? 3 : segments;
+    }
+}
+
+// Software rasterizer
+//
+// Pixels are covered when their center is inside the shape, matching OpenGL's
+// rasterization rules closely enough for headless rendering and tests.
+
+static void shade2d_soft_fill_span(Window2DState *st, int y, float x0, float x1) {
+    if (y < 0 || y >= st->target_height) return;
+    int ix0 = (int)ceilf(x0 - 0.5f);
+    int ix1 = (int)ceilf(x1 - 0.5f);
+    if (ix0 < 0) ix0 = 0;
+    if (ix1 > st->target_width) ix1 = st->target_width;
+    uint32_t *row = st->target + (size_t)y * st->target_width;
+    for (int x = ix0; x < ix1; x++) {
+        row[x] = st->color;
+    }
+}
+
+static void shade2d_soft_fill_rect(Window2DState *st, float x, float y, float width, float height) {
+    int iy0 = (int)ceilf(y - 0.5f);
+    int iy1 = (int)ceilf(y + height - 0.5f);
+    if (iy0 < 0) iy0 = 0;
+    if (iy1 > st->target_height) iy1 = st->target_height;
+    for (int iy = iy0; iy < iy1; iy++) {
+        shade2d_soft_fill_span(st, iy, x, x + width);
+    }
+}
+
+static void shade2d_soft_fill_circle(Window2DState *st, float cx, float cy, float radius) {
+    int iy0 = (int)ceilf(cy - radius - 0.5f);
+    int iy1 = (int)ceilf(cy + radius - 0.5f);
+    if (iy0 < 0) iy0 = 0;
+    if (iy1 > st->target_height) iy1 = st->target_height;
+    for (int iy = iy0; iy < iy1; iy++) {
+        float dy = iy + 0.5f - cy;
+        float half = sqrtf(fmaxf(radius * radius - dy * dy, 0.0f));
+        shade2d_soft_fill_span(st, iy, cx - half, cx + half);
+    }
+}
+
+static void shade2d_soft_fill_convex(Window2DState *st, const float *xs, const float *ys, int count) {
+    if (count < 3) return;
+    float miny = ys[0], maxy = ys[0];
+    for (int i = 1; i < count; i++) {
+        miny = fminf(miny, ys[i]);
+        maxy = fmaxf(maxy, ys[i]);
+    }
+    int iy0 = (int)ceilf(miny - 0.5f);
+    int iy1 = (int)ceilf(maxy - 0.5f);
+    if (iy0 < 0) iy0 = 0;
+    if (iy1 > st->target_height) iy1 = st->target_height;
+    for (int iy = iy0; iy < iy1; iy++) {
+        float yc = iy + 0.5f;
+        float x0 = FLT_MAX, x1 = -FLT_MAX;
+        for (int i = 0; i < count; i++) {
+            int j = (i + 1 == count) ? 0 : i + 1;
+            float ya = ys[i], yb = ys[j];
+            if ((ya <= yc && yc < yb) || (yb <= yc && yc < ya)) {
+                float x = xs[i] + (yc - ya) * (xs[j] - xs[i]) / (yb - ya);
+                x0 = fminf(x0, x);
+                x1 = fmaxf(x1, x);
+            }
+        }
+        if (x0 < x1) shade2d_soft_fill_span(st, iy, x0, x1);
+    }
+}
+
+// Source-over blend of two packed pixels with straight (not premultiplied) alpha
+static uint32_t shade2d_soft_blend(uint32_t dst, uint32_t src) {
+    uint32_t a = src >> 24;
+    if (a == 255) return src;
+    if (a == 0) return dst;
+    uint32_t da = dst >> 24;
+    uint32_t out = 0;
+    if (da == 255) {
+        for (int shift = 0; shift < 24; shift += 8) {
+            uint32_t sc = (src >> shift) & 0xFF;
+            uint32_t dc = (dst >> shift) & 0xFF;
+            out |= ((sc * a + dc * (255 - a)) / 255) << shift;
+        }
+        return out | 0xFF000000u;
+    }
+    // Translucent targets, such as render layers, gain coverage so they composite like direct drawing
+    uint32_t oa = a + da * (255 - a) / 255;
+    for (int shift = 0; shift < 24; shift += 8) {
+        uint32_t sc = (src >> shift) & 0xFF;
+        uint32_t dc = (dst >> shift) & 0xFF;
+        out |= ((sc * a * 255 + dc * da * (255 - a)) / (oa * 255)) << shift;
+    }
+    return out | oa << 24;
+}
+
+static void shade2d_soft_clear(Window2DState *st, uint32_t color) {
+    size_t count = (size_t)st->target_width * st->target_height;
+    for (size_t i = 0; i < count; i++) {
+        st->target[i] = color;
+    }
+}
+
 void shade2d_set_background(Window2D window, unsigned char r, unsigned char g, unsigned char b) {
-    (void)window; // Mark as unused
+    Window2DState *software = shade2d_software(window);
+    if (software) {
+        software->clear_color = shade2d_pack_rgba(r, g, b, 255);
+        shade2d_soft_clear(software, software->clear_color);
+        return;
+    }
     glClearColor(r/255.0f, g/255.0f, b/255.0f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
 }
 
 void shade2d_set_color(Window2D window, unsigned char r, unsigned char g, unsigned char b) {
-    (void)window; // Mark as unused
+    Window2DState *software = shade2d_software(window);
+    if (software) {
+        software->color = shade2d_pack_rgba(r, g, b, 255);
+        return;
+    }
     glColor3f(r/255.0f, g/255.0f, b/255.0f);
 }
 
@@ -97,7 +331,12 @@ Circle2D shade2d_circle(Window2D window, float x, float y, float radius) {
 }
 
 void shade2d_draw_circle(Window2D window, Circle2D circle) {
-    (void)window; // Mark as unused
+    Window2DState *software = shade2d_software(window);
+    if (software) {
+        shade2d_soft_fill_circle(software, circle.x, circle.y, circle.radius);
+        software->color = shade2d_pack_rgba(255, 255, 255, 255);  // Same reset as below
+        return;
+    }
     
     // Set up orthographic projection
     int width = shade2d_get_width(window);
@@ -113,7 +352,7 @@ void shade2d_draw_circle(Window2D window, Circle2D circle) {
     glBegin(GL_TRIANGLE_FAN);
     glVertex2f(circle.x, circle.y); // Center
     
-    int segments = 32;
+    int segments = (window.state && window.state->circle_segments > 0) ? window.state->circle_segments : 32;
     for (int i = 0; i <= segments; i++) {
         float angle = i * 2.0f * M_PI / segments;
         glVertex2f(
@@ -129,11 +368,19 @@ void shade2d_draw_circle(Window2D window, Circle2D circle) {
 }
 
 void shade2d_clear_window(Window2D window) {
-    (void)window; // Mark as unused
+    Window2DState *software = shade2d_software(window);
+    if (software) {
+        shade2d_soft_clear(software, software->clear_color);
+        return;
+    }
     glClear(GL_COLOR_BUFFER_BIT);
 }
 
 void shade2d_setup_projection(Window2D window) {
+    if (shade2d_software(window)) {
+        return;  // The software rasterizer always works in window coordinates
+    }
+
     // Set up orthographic projection
     int width = shade2d_get_width(window);
     int height = shade2d_get_height(window);
@@ -159,7 +406,11 @@ Rectangle2D shade2d_rectangle(Window2D window, float x, float y, float width, fl
 }
 
 void shade2d_draw_rectangle(Window2D window, Rectangle2D rectangle) {
-    (void)window; // Mark as unused
+    Window2DState *software = shade2d_software(window);
+    if (software) {
+        shade2d_soft_fill_rect(software, rectangle.x, rectangle.y, rectangle.width, rectangle.height);
+        return;
+    }
     
     // Draw the rectangle
     glBegin(GL_QUADS);
@@ -170,188 +421,2316 @@ void shade2d_draw_rectangle(Window2D window, Rectangle2D rectangle) {
     glEnd();
 }
 
-bool shade2d_is_key_pressed(Window2D window, int key) {
-    if (window.handle) {
-        return glfwGetKey(window.handle, key) == GLFW_PRESS;
-    }
-    return false;
+Box2D shade2d_box(Window2D window, float x, float y, float width, float height, float angle) {
+    (void)window; // Mark as unused
+    Box2D box;
+    box.x = x;
+    box.y = y;
+    box.velx = 0;
+    box.vely = 0;
+    box.mass = 1.0f; // Default mass
+    box.width = width;
+    box.height = height;
+    box.angle = angle;
+    box.angvel = 0;
+    return box;
 }
 
-bool shade2d_is_mouse_pressed_button(Window2D window, int button, Rectangle2D rectangle) {
-    if (window.handle) {
-        double xpos, ypos;
-        glfwGetCursorPos(window.handle, &xpos, &ypos);
-
-        bool is_inside = (xpos >= rectangle.x && xpos <= rectangle.x + rectangle.width &&
-                          ypos >= rectangle.y && ypos <= rectangle.y + rectangle.height);
+void shade2d_draw_box(Window2D window, Box2D box) {
+    float c = cosf(box.angle);
+    float s = sinf(box.angle);
+    float hw = box.width / 2.0f;
+    float hh = box.height / 2.0f;
+    float xs[4] = {
+        box.x + c * -hw - s * -hh, box.x + c * hw - s * -hh,
+        box.x + c * hw - s * hh, box.x + c * -hw - s * hh
+    };
+    float ys[4] = {
+        box.y + s * -hw + c * -hh, box.y + s * hw + c * -hh,
+        box.y + s * hw + c * hh, box.y + s * -hw + c * hh
+    };
 
-        return is_inside && (glfwGetMouseButton(window.handle, button) == GLFW_PRESS);
+    Window2DState *software = shade2d_software(window);
+    if (software) {
+        shade2d_soft_fill_convex(software, xs, ys, 4);
+        return;
     }
-    return false;
-}
 
-bool shade2d_is_mouse_pressed_button_circle(Window2D window, int button, Circle2D circle) {
-    if (window.handle) {
-        double mouseX, mouseY;
-        glfwGetCursorPos(window.handle, &mouseX, &mouseY);
-        
-        // Calculate distance from mouse to circle center
-        float dx = mouseX - circle.x;
-        float dy = mouseY - circle.y;
-        float distance = sqrtf(dx * dx + dy * dy);
-        
-        bool isInside = distance <= circle.radius;
-        bool buttonPressed = glfwGetMouseButton(window.handle, button) == GLFW_PRESS;
-        
-        return isInside && buttonPressed;
+    glBegin(GL_QUADS);
+    for (int i = 0; i < 4; i++) {
+        glVertex2f(xs[i], ys[i]);
     }
-    return false;
+    glEnd();
 }
 
-// Utility Functions
-void shade2d_buffer_init(Window2D window) {
-    (void)window; // Mark as unused
-    // Dummy implementation - buffer concept is unclear in this context
-    // Might be related to event handling during delays or a misunderstanding
-    // of how rendering buffers work in immediate mode OpenGL.
-    // No action needed for basic functionality.
+static float shade2d_cross3(const float o[2], const float a[2], const float b[2]) {
+    return (a[0] - o[0]) * (b[1] - o[1]) - (a[1] - o[1]) * (b[0] - o[0]);
 }
 
-void shade2d_buffer_destroy(Window2D window) {
+Polygon2D shade2d_polygon(Window2D window, float x, float y, const float *vertices, int count) {
     (void)window; // Mark as unused
-    // Dummy implementation - see shade2d_buffer_init
-    // No action needed for basic functionality.
-}
+    Polygon2D polygon;
+    memset(&polygon, 0, sizeof(polygon));
+    polygon.x = x;
+    polygon.y = y;
+    polygon.mass = 1.0f; // Default mass
 
-void shade2d_window_delay(Window2D window, double seconds) {
-    if (window.handle) {
-        double start_time = glfwGetTime();
-        while (glfwGetTime() - start_time < seconds) {
-            glfwPollEvents(); // Poll events to keep the window responsive
+    if (count > SHAD2D_MAX_POLYGON_VERTICES) count = SHAD2D_MAX_POLYGON_VERTICES;
+    if (count < 3) return polygon;
+
+    // Sort points by x then y (insertion sort, count is tiny)
+    float pts[SHAD2D_MAX_POLYGON_VERTICES][2];
+    for (int i = 0; i < count; i++) {
+        pts[i][0] = vertices[i * 2];
+        pts[i][1] = vertices[i * 2 + 1];
+        for (int j = i; j > 0 && (pts[j][0] < pts[j - 1][0] ||
+                                  (pts[j][0] == pts[j - 1][0] && pts[j][1] < pts[j - 1][1])); j--) {
+            float tx = pts[j][0], ty = pts[j][1];
+            pts[j][0] = pts[j - 1][0]; pts[j][1] = pts[j - 1][1];
+            pts[j - 1][0] = tx; pts[j - 1][1] = ty;
         }
     }
-}
 
-bool shade2d_check_collision_rect_rect(Rectangle2D r1, Rectangle2D r2) {
-    // AABB collision detection
-    return (r1.x < r2.x + r2.width &&
-            r1.x + r1.width > r2.x &&
-            r1.y < r2.y + r2.height &&
-            r1.y + r1.height > r2.y);
-}
+    // Monotone chain convex hull, counter-clockwise in math orientation
+    float hull[SHAD2D_MAX_POLYGON_VERTICES * 2][2];
+    int k = 0;
+    for (int i = 0; i < count; i++) {
+        while (k >= 2 && shade2d_cross3(hull[k - 2], hull[k - 1], pts[i]) <= 0) k--;
+        hull[k][0] = pts[i][0]; hull[k][1] = pts[i][1]; k++;
+    }
+    for (int i = count - 2, t = k + 1; i >= 0; i--) {
+        while (k >= t && shade2d_cross3(hull[k - 2], hull[k - 1], pts[i]) <= 0) k--;
+        hull[k][0] = pts[i][0]; hull[k][1] = pts[i][1]; k++;
+    }
+    k--;  // Last point equals the first
+    if (k < 3) return polygon;
 
-bool shade2d_check_collision_rect_circle(Rectangle2D r, Circle2D c) {
-    // Find the closest point to the circle within the rectangle
-    float closestX = fmax(r.x, fmin(c.x, r.x + r.width));
-    float closestY = fmax(r.y, fmin(c.y, r.y + r.height));
+    // Move the origin to the area centroid so rotation happens about the center of mass
+    float area = 0, cx = 0, cy = 0;
+    for (int i = 0; i < k; i++) {
+        const float *a = hull[i];
+        const float *b = hull[(i + 1) % k];
+        float cross = a[0] * b[1] - a[1] * b[0];
+        area += cross;
+        cx += (a[0] + b[0]) * cross;
+        cy += (a[1] + b[1]) * cross;
+    }
+    if (area != 0) {
+        cx /= 3.0f * area;
+        cy /= 3.0f * area;
+    }
 
-    // Calculate the distance between the circle's center and this closest point
-    float distanceX = c.x - closestX;
-    float distanceY = c.y - closestY;
-    float distanceSquared = (distanceX * distanceX) + (distanceY * distanceY);
+    polygon.x += cx;
+    polygon.y += cy;
+    polygon.vertex_count = k;
+    for (int i = 0; i < k; i++) {
+        polygon.vertices[i][0] = hull[i][0] - cx;
+        polygon.vertices[i][1] = hull[i][1] - cy;
+    }
+    return polygon;
+}
 
-    // If the distance is less than the square of the circle's radius, an overlap occurs
-    return distanceSquared < (c.radius * c.radius);
+// Vertices actually stored; Polygon2D is public, so the count may come from anywhere
+static int shade2d_polygon_count(const Polygon2D *polygon) {
+    if (polygon->vertex_count < 0) return 0;
+    return polygon->vertex_count < SHAD2D_MAX_POLYGON_VERTICES ? polygon->vertex_count : SHAD2D_MAX_POLYGON_VERTICES;
 }
 
-bool shade2d_check_collision_circle_circle(Circle2D c1, Circle2D c2) {
-    // Calculate the distance between the centers of the two circles
-    float distanceX = c1.x - c2.x;
-    float distanceY = c1.y - c2.y;
-    float distanceSquared = (distanceX * distanceX) + (distanceY * distanceY);
+void shade2d_draw_polygon(Window2D window, Polygon2D polygon) {
+    float c = cosf(polygon.angle);
+    float s = sinf(polygon.angle);
+    float xs[SHAD2D_MAX_POLYGON_VERTICES], ys[SHAD2D_MAX_POLYGON_VERTICES];
+    int count = shade2d_polygon_count(&polygon);
+    for (int i = 0; i < count; i++) {
+        float lx = polygon.vertices[i][0];
+        float ly = polygon.vertices[i][1];
+        xs[i] = polygon.x + c * lx - s * ly;
+        ys[i] = polygon.y + s * lx + c * ly;
+    }
 
-    // Calculate the sum of the radii
-    float radiusSum = c1.radius + c2.radius;
+    Window2DState *software = shade2d_software(window);
+    if (software) {
+        shade2d_soft_fill_convex(software, xs, ys, count);
+        return;
+    }
 
-    // If the distance is less than the sum of the radii, an overlap occurs
-    return distanceSquared < (radiusSum * radiusSum);
+    glBegin(GL_TRIANGLE_FAN);
+    for (int i = 0; i < count; i++) {
+        glVertex2f(xs[i], ys[i]);
+    }
+    glEnd();
 }
 
-void shade2d_handle_collision_rect_rect(Rectangle2D *r1, Rectangle2D *r2) {
-    // Calculate new velocities based on elastic collision and mass
-    float m1 = r1->mass;
-    float m2 = r2->mass;
-    float v1x = r1->velx;
-    float v1y = r1->vely;
-    float v2x = r2->velx;
-    float v2y = r2->vely;
+// Render Layers
+//
+// A layer caches the result of its draw callback in an offscreen framebuffer
+// (or a CPU buffer for headless windows). The callback only runs again after
+// shade2d_invalidate_render_layer, every other frame is one textured quad.
 
-    // Calculate final velocities using 1D elastic collision formula
-    float v1fx = ((m1 - m2) * v1x + (2 * m2) * v2x) / (m1 + m2);
-    float v1fy = ((m1 - m2) * v1y + (2 * m2) * v2y) / (m1 + m2);
-    float v2fx = ((2 * m1) * v1x + (m2 - m1) * v2x) / (m1 + m2);
-    float v2fy = ((2 * m1) * v1y + (m2 - m1) * v2y) / (m1 + m2);
+RenderLayer2D* shade2d_create_render_layer(Window2D window, const char* name, RenderLayerDrawFn draw, void* user_data) {
+    if (!window.state) return NULL;
 
-    // Update velocities
-    r1->velx = v1fx;
-    r1->vely = v1fy;
-    r2->velx = v2fx;
-    r2->vely = v2fy;
+    RenderLayer2D *layer = calloc(1, sizeof(RenderLayer2D));
+    if (!layer) return NULL;
+    strncpy(layer->name, name ? name : "", sizeof(layer->name) - 1);
+    layer->width = window.width;
+    layer->height = window.height;
+    layer->draw = draw;
+    layer->user_data = user_data;
+    layer->dirty = true;
 
-    // Separate overlapping rectangles
-    float overlapX = fmin(r1->x + r1->width - r2->x, r2->x + r2->width - r1->x);
-    float overlapY = fmin(r1->y + r1->height - r2->y, r2->y + r2->height - r1->y);
+    if (!window.handle) {
+        layer->pixels = calloc((size_t)layer->width * layer->height, sizeof(uint32_t));
+        if (!layer->pixels) {
+            free(layer);
+            return NULL;
+        }
+    } else {
+        glGenTextures(1, &layer->texture);
+        glBindTexture(GL_TEXTURE_2D, layer->texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, layer->width, layer->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glBindTexture(GL_TEXTURE_2D, 0);
 
-    // Calculate the direction of separation
-    float sep_dir_x = 0;
-    if (r1->x < r2->x) sep_dir_x = -1; else sep_dir_x = 1;
-    float sep_dir_y = 0;
-    if (r1->y < r2->y) sep_dir_y = -1; else sep_dir_y = 1;
+        glGenFramebuffers(1, &layer->framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, layer->framebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, layer->texture, 0);
+        GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        if (status != GL_FRAMEBUFFER_COMPLETE) {
+            glDeleteFramebuffers(1, &layer->framebuffer);
+            glDeleteTextures(1, &layer->texture);
+            free(layer);
+            return NULL;
+        }
+    }
 
-    if (overlapX < overlapY) {
-        // Separate along the x-axis
-        r1->x += sep_dir_x * overlapX / 2.0f;
-        r2->x -= sep_dir_x * overlapX / 2.0f;
-    } else {
-        // Separate along the y-axis
-        r1->y += sep_dir_y * overlapY / 2.0f;
-        r2->y -= sep_dir_y * overlapY / 2.0f;
+    layer->next = window.state->layers;
+    window.state->layers = layer;
+    return layer;
+}
+
+RenderLayer2D* shade2d_get_render_layer(Window2D window, const char* name) {
+    if (!window.state || !name) return NULL;
+    for (RenderLayer2D *layer = window.state->layers; layer; layer = layer->next) {
+        if (strcmp(layer->name, name) == 0) {
+            return layer;
+        }
     }
+    return NULL;
 }
 
-void shade2d_handle_collision_rect_circle(Rectangle2D *r, Circle2D *c) {
-    // Simple elastic collision response (based on 1D collision for now)
-    // This is a simplified approach for demonstration and can be improved.
-    
-    // Calculate the direction of collision from rectangle to circle
-    float normalX = c->x - (r->x + r->width / 2.0f);
-    float normalY = c->y - (r->y + r->height / 2.0f);
-    
-    // Normalize the collision normal (avoid division by zero)
-    float magnitude = sqrtf(normalX * normalX + normalY * normalY);
-    if (magnitude > 0) {
-        normalX /= magnitude;
-        normalY /= magnitude;
+void shade2d_invalidate_render_layer(RenderLayer2D* layer) {
+    if (layer) {
+        layer->dirty = true;
     }
+}
 
-    // Calculate relative velocity
-    float relativeVelX = c->velx - r->velx;
-    float relativeVelY = c->vely - r->vely;
+static void shade2d_redraw_render_layer(Window2D window, RenderLayer2D *layer) {
+    Window2DState *st = window.state;
+    if (!window.handle) {
+        // Point the software rasterizer at the layer, starting from transparent
+        uint32_t *target = st->target;
+        int target_width = st->target_width, target_height = st->target_height;
+        uint32_t clear_color = st->clear_color, color = st->color;
+        st->target = (uint32_t *)layer->pixels;
+        st->target_width = layer->width;
+        st->target_height = layer->height;
+        shade2d_soft_clear(st, 0);
+        if (layer->draw) layer->draw(window, layer->user_data);
+        st->target = target;
+        st->target_width = target_width;
+        st->target_height = target_height;
+        st->clear_color = clear_color;
+        st->color = color;
+        return;
+    }
 
-    // Calculate velocity along the collision normal
-    float velocityAlongNormal = relativeVelX * normalX + relativeVelY * normalY;
+    glBindFramebuffer(GL_FRAMEBUFFER, layer->framebuffer);
+    glPushAttrib(GL_VIEWPORT_BIT | GL_COLOR_BUFFER_BIT | GL_CURRENT_BIT);
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
 
-    // Do not resolve if velocities are separating
-    if (velocityAlongNormal > 0) return;
+    glViewport(0, 0, layer->width, layer->height);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    shade2d_setup_projection(window);
+    if (layer->draw) layer->draw(window, layer->user_data);
 
-    // Calculate impulse scalar using elastic collision formula
-    float m1 = r->mass;
-    float m2 = c->mass;
-    float impulseScalar = -(1.0f + 1.0f) * velocityAlongNormal / (1.0f/m1 + 1.0f/m2);
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPopMatrix();
+    glPopAttrib();
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
 
-    // Apply impulse to velocities
-    r->velx -= impulseScalar * normalX / m1;
-    r->vely -= impulseScalar * normalY / m1;
-    c->velx += impulseScalar * normalX / m2;
-    c->vely += impulseScalar * normalY / m2;
+void shade2d_draw_render_layer(Window2D window, RenderLayer2D* layer) {
+    if (!layer || !window.state) return;
+    if (layer->dirty) {
+        shade2d_redraw_render_layer(window, layer);
+        layer->dirty = false;
+    }
 
-    // Separation (basic - could be improved for more accurate separation)
-    float overlap = sqrtf((c->x - (r->x + r->width/2.0f))*(c->x - (r->x + r->width/2.0f)) + (c->y - (r->y + r->height/2.0f))*(c->y - (r->y + r->height/2.0f))) - c->radius;
-    if (overlap < 0) {
-        r->x += normalX * overlap / 2.0f;
-        r->y += normalY * overlap / 2.0f;
-        c->x -= normalX * overlap / 2.0f;
-        c->y -= normalY * overlap / 2.0f;
+    Window2DState *software = shade2d_software(window);
+    if (software) {
+        // Alpha blend the layer over the current target
+        int width = layer->width < software->target_width ? layer->width : software->target_width;
+        int height = layer->height < software->target_height ? layer->height : software->target_height;
+        const uint32_t *src = (const uint32_t *)layer->pixels;
+        for (int y = 0; y < height; y++) {
+            const uint32_t *s = src + (size_t)y * layer->width;
+            uint32_t *d = software->target + (size_t)y * software->target_width;
+            for (int x = 0; x < width; x++) {
+                d[x] = shade2d_soft_blend(d[x], s[x]);
+            }
+        }
+        return;
+    }
+
+    glPushAttrib(GL_ENABLE_BIT | GL_CURRENT_BIT | GL_TEXTURE_BIT);
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, layer->texture);
+    glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+    shade2d_setup_projection(window);
+    glBegin(GL_QUADS);
+    // Rows were rendered with the same y-down projection, so the texture's top is t = 1
+    glTexCoord2f(0, 1); glVertex2f(0, 0);
+    glTexCoord2f(1, 1); glVertex2f(layer->width, 0);
+    glTexCoord2f(1, 0); glVertex2f(layer->width, layer->height);
+    glTexCoord2f(0, 0); glVertex2f(0, layer->height);
+    glEnd();
+    glPopAttrib();
+}
+
+void shade2d_destroy_render_layer(Window2D window, RenderLayer2D* layer) {
+    if (!layer || !window.state) return;
+    for (RenderLayer2D **link = &window.state->layers; *link; link = &(*link)->next) {
+        if (*link == layer) {
+            *link = layer->next;
+            break;
+        }
+    }
+    if (layer->framebuffer) glDeleteFramebuffers(1, &layer->framebuffer);
+    if (layer->texture) glDeleteTextures(1, &layer->texture);
+    free(layer->pixels);
+    free(layer);
+}
+
+// Images and Texture Atlas
+//
+// Pages are packed with a skyline: the top edge of everything placed so far,
+// stored as horizontal segments. Each image goes where its bottom lands
+// lowest, which keeps pages dense without tracking free rectangles. Pages keep
+// a CPU copy, and changed rows are uploaded in one call before drawing.
+
+#define SHAD2D_ATLAS_PADDING 1  // Transparent gap so neighbors never bleed into each other
+
+Image2D shade2d_create_image(int width, int height, const unsigned char* pixels) {
+    Image2D image;
+    image.width = width > 0 ? width : 0;
+    image.height = height > 0 ? height : 0;
+    size_t bytes = (size_t)image.width * image.height * 4;
+    image.pixels = calloc(bytes ? bytes : 1, 1);
+    if (image.pixels && pixels) {
+        memcpy(image.pixels, pixels, bytes);
+    }
+    return image;
+}
+
+void shade2d_destroy_image(Image2D image) {
+    free(image.pixels);
+}
+
+TextureAtlas2D* shade2d_create_texture_atlas(Window2D window, int page_size) {
+    TextureAtlas2D *atlas = calloc(1, sizeof(TextureAtlas2D));
+    if (!atlas) return NULL;
+    atlas->uploads = window.handle != NULL;
+    atlas->page_size = page_size > 0 ? page_size : 1024;
+    return atlas;
+}
+
+static AtlasPage2D *shade2d_add_atlas_page(TextureAtlas2D *atlas) {
+    if (atlas->page_count >= SHAD2D_ATLAS_MAX_PAGES) return NULL;
+    AtlasPage2D *page = &atlas->pages[atlas->page_count];
+    size_t size = (size_t)atlas->page_size;
+    page->pixels = calloc(size * size, 4);
+    page->skyline = malloc((size + 1) * 3 * sizeof(int));  // At most one segment per column, plus one while inserting
+    if (!page->pixels || !page->skyline) {
+        free(page->pixels);
+        free(page->skyline);
+        memset(page, 0, sizeof(*page));
+        return NULL;
+    }
+    page->skyline[0] = 0;
+    page->skyline[1] = 0;
+    page->skyline[2] = atlas->page_size;
+    page->skyline_count = 1;
+    page->dirty_top = 0;
+    page->dirty_bottom = atlas->page_size;  // Upload the cleared page once
+    atlas->page_count++;
+    return page;
+}
+
+// Lowest y a width x height rectangle can sit at starting on segment i, -1 if it doesn't fit
+static int shade2d_skyline_fit(const AtlasPage2D *page, int page_size, int i, int width, int height) {
+    int x = page->skyline[i * 3];
+    if (x + width > page_size) return -1;
+    int y = 0;
+    int remaining = width;
+    for (int j = i; remaining > 0 && j < page->skyline_count; j++) {
+        if (page->skyline[j * 3 + 1] > y) y = page->skyline[j * 3 + 1];
+        if (y + height > page_size) return -1;
+        remaining -= page->skyline[j * 3 + 2];
+    }
+    return y;
+}
+
+static bool shade2d_skyline_pack(AtlasPage2D *page, int page_size, int width, int height, int *out_x, int *out_y) {
+    int best = -1, best_y = 0, best_bottom = INT32_MAX, best_width = INT32_MAX;
+    for (int i = 0; i < page->skyline_count; i++) {
+        int y = shade2d_skyline_fit(page, page_size, i, width, height);
+        if (y < 0) continue;
+        int segment_width = page->skyline[i * 3 + 2];
+        if (y + height < best_bottom || (y + height == best_bottom && segment_width < best_width)) {
+            best = i;
+            best_y = y;
+            best_bottom = y + height;
+            best_width = segment_width;
+        }
+    }
+    if (best < 0) return false;
+
+    int x = page->skyline[best * 3];
+    int *sky = page->skyline;
+    // New segment for the placed rectangle's top edge
+    memmove(&sky[(best + 1) * 3], &sky[best * 3], (page->skyline_count - best) * 3 * sizeof(int));
+    sky[best * 3] = x;
+    sky[best * 3 + 1] = best_y + height;
+    sky[best * 3 + 2] = width;
+    page->skyline_count++;
+
+    // Trim or drop the segments it now covers
+    for (int i = best + 1; i < page->skyline_count; i++) {
+        int end = sky[(i - 1) * 3] + sky[(i - 1) * 3 + 2];
+        if (sky[i * 3] >= end) break;
+        int shrink = end - sky[i * 3];
+        sky[i * 3] += shrink;
+        sky[i * 3 + 2] -= shrink;
+        if (sky[i * 3 + 2] > 0) break;
+        memmove(&sky[i * 3], &sky[(i + 1) * 3], (page->skyline_count - i - 1) * 3 * sizeof(int));
+        page->skyline_count--;
+        i--;
+    }
+    // Merge neighbors at the same height
+    for (int i = 0; i + 1 < page->skyline_count; i++) {
+        if (sky[i * 3 + 1] == sky[(i + 1) * 3 + 1]) {
+            sky[i * 3 + 2] += sky[(i + 1) * 3 + 2];
+            memmove(&sky[(i + 1) * 3], &sky[(i + 2) * 3], (page->skyline_count - i - 2) * 3 * sizeof(int));
+            page->skyline_count--;
+            i--;
+        }
+    }
+
+    *out_x = x;
+    *out_y = best_y;
+    return true;
+}
+
+bool shade2d_add_image_to_atlas(TextureAtlas2D* atlas, Image2D image, AtlasRegion2D* region) {
+    if (!atlas || !image.pixels || image.width <= 0 || image.height <= 0) return false;
+    int width = image.width + SHAD2D_ATLAS_PADDING;
+    int height = image.height + SHAD2D_ATLAS_PADDING;
+    if (width > atlas->page_size || height > atlas->page_size) return false;
+
+    int x = 0, y = 0, p;
+    for (p = 0; p < atlas->page_count; p++) {
+        if (shade2d_skyline_pack(&atlas->pages[p], atlas->page_size, width, height, &x, &y)) break;
+    }
+    if (p == atlas->page_count) {
+        AtlasPage2D *page = shade2d_add_atlas_page(atlas);
+        if (!page || !shade2d_skyline_pack(page, atlas->page_size, width, height, &x, &y)) return false;
+    }
+
+    AtlasPage2D *page = &atlas->pages[p];
+    size_t row_bytes = (size_t)image.width * 4;
+    for (int row = 0; row < image.height; row++) {
+        memcpy(page->pixels + ((size_t)(y + row) * atlas->page_size + x) * 4, image.pixels + row * row_bytes, row_bytes);
+    }
+    if (page->dirty_top >= page->dirty_bottom) {
+        page->dirty_top = y;
+        page->dirty_bottom = y + image.height;
+    } else {
+        if (y < page->dirty_top) page->dirty_top = y;
+        if (y + image.height > page->dirty_bottom) page->dirty_bottom = y + image.height;
+    }
+
+    if (region) {
+        float scale = 1.0f / atlas->page_size;
+        region->page = p;
+        region->x = x;
+        region->y = y;
+        region->width = image.width;
+        region->height = image.height;
+        region->u0 = x * scale;
+        region->v0 = y * scale;  // Rows are uploaded top first, so v grows downward like screen y
+        region->u1 = (x + image.width) * scale;
+        region->v1 = (y + image.height) * scale;
+    }
+    return true;
+}
+
+void shade2d_upload_texture_atlas(TextureAtlas2D* atlas) {
+    if (!atlas || !atlas->uploads) return;
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (int p = 0; p < atlas->page_count; p++) {
+        AtlasPage2D *page = &atlas->pages[p];
+        if (page->dirty_top >= page->dirty_bottom) continue;
+        if (!page->texture) {
+            glGenTextures(1, &page->texture);
+            glBindTexture(GL_TEXTURE_2D, page->texture);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, atlas->page_size, atlas->page_size, 0, GL_RGBA, GL_UNSIGNED_BYTE, page->pixels);
+        } else {
+            glBindTexture(GL_TEXTURE_2D, page->texture);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, page->dirty_top, atlas->page_size, page->dirty_bottom - page->dirty_top,
+                            GL_RGBA, GL_UNSIGNED_BYTE, page->pixels + (size_t)page->dirty_top * atlas->page_size * 4);
+        }
+        page->dirty_top = page->dirty_bottom = 0;
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void shade2d_destroy_texture_atlas(TextureAtlas2D* atlas) {
+    if (!atlas) return;
+    for (int p = 0; p < atlas->page_count; p++) {
+        if (atlas->pages[p].texture) glDeleteTextures(1, &atlas->pages[p].texture);
+        free(atlas->pages[p].pixels);
+        free(atlas->pages[p].skyline);
+    }
+    free(atlas);
+}
+
+// Image Files
+//
+// Decoders for formats simple enough to need no external library: binary
+// PPM/PGM, QOI and TGA (raw or RLE). All produce tightly packed RGBA.
+
+#define SHAD2D_IMAGE_MAX_PIXELS ((size_t)1 << 28)
+
+static unsigned char *shade2d_read_file(const char *path, size_t *size) {
+    FILE *file = fopen(path, "rb");
+    if (!file) return NULL;
+    unsigned char *data = NULL;
+    if (fseek(file, 0, SEEK_END) == 0) {
+        long length = ftell(file);
+        if (length >= 0 && fseek(file, 0, SEEK_SET) == 0) {
+            data = malloc((size_t)length + 1);
+            if (data && fread(data, 1, (size_t)length, file) != (size_t)length) {
+                free(data);
+                data = NULL;
+            }
+            if (data) {
+                data[length] = 0;  // Lets text formats be parsed as a string
+                *size = (size_t)length;
+            }
+        }
+    }
+    fclose(file);
+    return data;
+}
+
+static bool shade2d_alloc_image(Image2D *image, long width, long height) {
+    if (width <= 0 || height <= 0 || width > 65535 || height > 65535 ||
+        (size_t)width * (size_t)height > SHAD2D_IMAGE_MAX_PIXELS) {
+        return false;
+    }
+    image->width = (int)width;
+    image->height = (int)height;
+    image->pixels = malloc((size_t)width * height * 4);
+    return image->pixels != NULL;
+}
+
+// Next header number, skipping whitespace and comments; -1 if there isn't one
+static long shade2d_ppm_number(const unsigned char *data, size_t size, size_t *at) {
+    while (*at < size) {
+        if (data[*at] == '#') {
+            while (*at < size && data[*at] != '\n') (*at)++;
+        } else if (data[*at] == ' ' || data[*at] == '\t' || data[*at] == '\r' || data[*at] == '\n') {
+            (*at)++;
+        } else {
+            break;
+        }
+    }
+    long value = 0;
+    size_t start = *at;
+    while (*at < size && data[*at] >= '0' && data[*at] <= '9' && value < 1000000) {
+        value = value * 10 + (data[(*at)++] - '0');
+    }
+    return *at > start ? value : -1;
+}
+
+static bool shade2d_decode_ppm(const unsigned char *data, size_t size, Image2D *image) {
+    int channels = data[1] == '6' ? 3 : 1;
+    size_t at = 2;
+    long width = shade2d_ppm_number(data, size, &at);
+    long height = shade2d_ppm_number(data, size, &at);
+    long maxval = shade2d_ppm_number(data, size, &at);
+    if (maxval <= 0 || maxval > 65535 || at >= size) return false;
+    at++;  // Single whitespace before the samples
+    int sample_bytes = maxval > 255 ? 2 : 1;
+    if (!shade2d_alloc_image(image, width, height)) return false;
+    size_t count = (size_t)width * height;
+    if ((size - at) / ((size_t)channels * sample_bytes) < count) {
+        free(image->pixels);
+        return false;
+    }
+
+    const unsigned char *in = data + at;
+    unsigned char *out = image->pixels;
+    for (size_t i = 0; i < count; i++, out += 4) {
+        for (int c = 0; c < channels; c++) {
+            unsigned value = *in++;
+            if (sample_bytes == 2) value = value << 8 | *in++;
+            out[c] = (unsigned char)(maxval == 255 ? value : value * 255 / maxval);
+        }
+        if (channels == 1) out[1] = out[2] = out[0];
+        out[3] = 255;
+    }
+    return true;
+}
+
+// Quite OK Image format, see qoiformat.org
+static bool shade2d_decode_qoi(const unsigned char *data, size_t size, Image2D *image) {
+    if (size < 14 + 8) return false;
+    long width = (long)((uint32_t)data[4] << 24 | data[5] << 16 | data[6] << 8 | data[7]);
+    long height = (long)((uint32_t)data[8] << 24 | data[9] << 16 | data[10] << 8 | data[11]);
+    if (data[12] != 3 && data[12] != 4) return false;
+    if (!shade2d_alloc_image(image, width, height)) return false;
+
+    unsigned char index[64][4];
+    memset(index, 0, sizeof(index));
+    unsigned char px[4] = { 0, 0, 0, 255 };
+    size_t at = 14, end = size - 8;  // Stream ends with an 8-byte marker
+    size_t count = (size_t)width * height;
+    unsigned char *out = image->pixels;
+    int run = 0;
+    for (size_t i = 0; i < count; i++, out += 4) {
+        if (run > 0) {
+            run--;
+        } else if (at < end) {
+            unsigned char op = data[at++];
+            if (op == 0xFE) {
+                if (end - at < 3) break;
+                px[0] = data[at];
+                px[1] = data[at + 1];
+                px[2] = data[at + 2];
+                at += 3;
+            } else if (op == 0xFF) {
+                if (end - at < 4) break;
+                memcpy(px, data + at, 4);
+                at += 4;
+            } else if ((op & 0xC0) == 0x00) {
+                memcpy(px, index[op], 4);
+            } else if ((op & 0xC0) == 0x40) {
+                px[0] += ((op >> 4) & 3) - 2;
+                px[1] += ((op >> 2) & 3) - 2;
+                px[2] += (op & 3) - 2;
+            } else if ((op & 0xC0) == 0x80) {
+                if (at >= end) break;
+                int dg = (op & 0x3F) - 32;
+                unsigned char b = data[at++];
+                px[0] += dg + ((b >> 4) & 0x0F) - 8;
+                px[1] += dg;
+                px[2] += dg + (b & 0x0F) - 8;
+            } else {
+                run = op & 0x3F;
+            }
+            memcpy(index[(px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11) % 64], px, 4);
+        } else {
+            break;
+        }
+        memcpy(out, px, 4);
+    }
+    if (out != image->pixels + count * 4) {
+        free(image->pixels);
+        return false;
+    }
+    return true;
+}
+
+// Truecolor and grayscale TGA, uncompressed or run-length encoded
+static bool shade2d_decode_tga(const unsigned char *data, size_t size, Image2D *image) {
+    if (size < 18) return false;
+    int type = data[2];
+    int depth = data[16];
+    bool rle = type == 10 || type == 11;
+    bool gray = type == 3 || type == 11;
+    if (data[1] != 0 || (type != 2 && type != 3 && type != 10 && type != 11)) return false;
+    if (gray ? depth != 8 : (depth != 24 && depth != 32)) return false;
+    long width = data[12] | data[13] << 8;
+    long height = data[14] | data[15] << 8;
+    if (!shade2d_alloc_image(image, width, height)) return false;
+
+    int bytes = depth / 8;
+    size_t at = 18 + data[0];  // Skip the image ID
+    size_t count = (size_t)width * height;
+    size_t i = 0;
+    while (i < count) {
+        size_t repeat = 1, literal = 1;
+        if (rle) {
+            if (at >= size) break;
+            unsigned char packet = data[at++];
+            if (packet & 0x80) {
+                repeat = (packet & 0x7F) + 1;
+            } else {
+                literal = (packet & 0x7F) + 1;
+            }
+        }
+        if (repeat > count - i) repeat = count - i;
+        if (literal > count - i) literal = count - i;
+        if ((size - at) / bytes < literal) break;
+        for (size_t n = 0; n < literal; n++, at += bytes) {
+            const unsigned char *in = data + at;
+            unsigned char rgba[4] = { in[0], in[0], in[0], 255 };
+            if (!gray) {
+                rgba[0] = in[2];  // Stored BGR(A)
+                rgba[1] = in[1];
+                rgba[2] = in[0];
+                if (bytes == 4) rgba[3] = in[3];
+            }
+            for (size_t r = 0; r < repeat; r++) {
+                memcpy(image->pixels + (i++) * 4, rgba, 4);
+            }
+        }
+    }
+    if (i < count) {
+        free(image->pixels);
+        return false;
+    }
+
+    // Rows are stored bottom-up unless the descriptor says otherwise
+    size_t row_bytes = (size_t)width * 4;
+    if (data[17] & 0x10) {
+        for (long y = 0; y < height; y++) {
+            unsigned char *row = image->pixels + y * row_bytes;
+            for (long x = 0; x < width / 2; x++) {
+                uint32_t t;
+                memcpy(&t, row + x * 4, 4);
+                memcpy(row + x * 4, row + (width - 1 - x) * 4, 4);
+                memcpy(row + (width - 1 - x) * 4, &t, 4);
+            }
+        }
+    }
+    if (!(data[17] & 0x20)) {
+        unsigned char *swap = malloc(row_bytes);
+        if (!swap) {
+            free(image->pixels);
+            return false;
+        }
+        for (long y = 0; y < height / 2; y++) {
+            unsigned char *top = image->pixels + y * row_bytes;
+            unsigned char *bottom = image->pixels + (height - 1 - y) * row_bytes;
+            memcpy(swap, top, row_bytes);
+            memcpy(top, bottom, row_bytes);
+            memcpy(bottom, swap, row_bytes);
+        }
+        free(swap);
+    }
+    return true;
+}
+
+bool shade2d_load_image(const char* path, Image2D* image) {
+    size_t size = 0;
+    unsigned char *data = shade2d_read_file(path, &size);
+    if (!data) return false;
+    Image2D decoded = { 0, 0, NULL };
+    bool ok;
+    if (size >= 4 && memcmp(data, "qoif", 4) == 0) {
+        ok = shade2d_decode_qoi(data, size, &decoded);
+    } else if (size >= 3 && data[0] == 'P' && (data[1] == '5' || data[1] == '6')) {
+        ok = shade2d_decode_ppm(data, size, &decoded);
+    } else {
+        ok = shade2d_decode_tga(data, size, &decoded);  // TGA has no magic number
+    }
+    free(data);
+    if (ok) *image = decoded;
+    return ok;
+}
+
+// Sprite Batches
+//
+// Sprites are collected, then counting-sorted by atlas page straight into one
+// interleaved vertex array, so each page is a single glDrawArrays call. The
+// software rasterizer sorts sprite indices the same way. Within a page sprites
+// keep their submission order; lower pages draw first.
+
+typedef struct {
+    float x, y, u, v;
+    unsigned char color[4];
+} Shade2DSpriteVertex;
+
+Sprite2D shade2d_sprite(AtlasRegion2D region, float x, float y) {
+    Sprite2D sprite;
+    sprite.x = x;
+    sprite.y = y;
+    sprite.width = (float)region.width;
+    sprite.height = (float)region.height;
+    sprite.angle = 0.0f;
+    sprite.r = sprite.g = sprite.b = sprite.a = 255;
+    sprite.region = region;
+    return sprite;
+}
+
+SpriteBatch2D* shade2d_create_sprite_batch(TextureAtlas2D* atlas, size_t capacity) {
+    SpriteBatch2D *batch = calloc(1, sizeof(SpriteBatch2D));
+    if (!batch) return NULL;
+    batch->atlas = atlas;
+    batch->capacity = capacity > 0 ? capacity : 256;
+    batch->sprites = malloc(batch->capacity * sizeof(Sprite2D));
+    if (!batch->sprites) {
+        free(batch);
+        return NULL;
+    }
+    return batch;
+}
+
+bool shade2d_add_sprite(SpriteBatch2D* batch, Sprite2D sprite) {
+    if (!batch || (unsigned)sprite.region.page >= SHAD2D_ATLAS_MAX_PAGES) return false;
+    if (batch->count == batch->capacity) {
+        Sprite2D *grown = realloc(batch->sprites, batch->capacity * 2 * sizeof(Sprite2D));
+        if (!grown) return false;
+        batch->sprites = grown;
+        batch->capacity *= 2;
+    }
+    batch->sprites[batch->count++] = sprite;
+    batch->page_counts[sprite.region.page]++;
+    return true;
+}
+
+// Grows the batch's scratch buffer to at least bytes, NULL if that fails
+static void *shade2d_sprite_scratch(SpriteBatch2D *batch, size_t bytes) {
+    if (bytes > batch->scratch_size) {
+        void *grown = realloc(batch->scratch, bytes);
+        if (!grown) return NULL;
+        batch->scratch = grown;
+        batch->scratch_size = bytes;
+    }
+    return batch->scratch;
+}
+
+// Rotated, tinted, nearest-sampled quad blended into the software target
+static void shade2d_soft_draw_sprite(Window2DState *st, const AtlasPage2D *page, int page_size, const Sprite2D *sprite) {
+    float hw = sprite->width * 0.5f, hh = sprite->height * 0.5f;
+    if (hw <= 0 || hh <= 0) return;
+    float c = cosf(sprite->angle), s = sinf(sprite->angle);
+    float ex = fabsf(c) * hw + fabsf(s) * hh;
+    float ey = fabsf(s) * hw + fabsf(c) * hh;
+    int x0 = (int)ceilf(sprite->x - ex - 0.5f), x1 = (int)ceilf(sprite->x + ex - 0.5f);
+    int y0 = (int)ceilf(sprite->y - ey - 0.5f), y1 = (int)ceilf(sprite->y + ey - 0.5f);
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x1 > st->target_width) x1 = st->target_width;
+    if (y1 > st->target_height) y1 = st->target_height;
+    if (x0 >= x1 || y0 >= y1) return;
+
+    // Texels per unit of local sprite space
+    float tu = sprite->region.width / sprite->width;
+    float tv = sprite->region.height / sprite->height;
+    bool tinted = (sprite->r & sprite->g & sprite->b & sprite->a) != 255;
+    const uint32_t *texels = (const uint32_t *)page->pixels;
+
+    for (int y = y0; y < y1; y++) {
+        float dy = y + 0.5f - sprite->y;
+        float dx = x0 + 0.5f - sprite->x;
+        // Local coordinates step by (c, -s) per pixel along the row
+        float lx = dx * c + dy * s;
+        float ly = -dx * s + dy * c;
+        uint32_t *row = st->target + (size_t)y * st->target_width;
+        for (int x = x0; x < x1; x++, lx += c, ly -= s) {
+            if (lx < -hw || lx >= hw || ly < -hh || ly >= hh) continue;
+            int tx = (int)((lx + hw) * tu);
+            int ty = (int)((ly + hh) * tv);
+            if (tx >= sprite->region.width) tx = sprite->region.width - 1;
+            if (ty >= sprite->region.height) ty = sprite->region.height - 1;
+            uint32_t texel = texels[(size_t)(sprite->region.y + ty) * page_size + sprite->region.x + tx];
+            if (tinted) {
+                texel = shade2d_pack_rgba((unsigned char)((texel & 0xFF) * sprite->r / 255),
+                                          (unsigned char)(((texel >> 8) & 0xFF) * sprite->g / 255),
+                                          (unsigned char)(((texel >> 16) & 0xFF) * sprite->b / 255),
+                                          (unsigned char)((texel >> 24) * sprite->a / 255));
+            }
+            row[x] = shade2d_soft_blend(row[x], texel);
+        }
+    }
+}
+
+void shade2d_draw_sprite_batch(Window2D window, SpriteBatch2D* batch) {
+    if (!batch || batch->count == 0 || !batch->atlas) return;
+    TextureAtlas2D *atlas = batch->atlas;
+
+    size_t first[SHAD2D_ATLAS_MAX_PAGES];
+    size_t offset = 0;
+    for (int p = 0; p < SHAD2D_ATLAS_MAX_PAGES; p++) {
+        first[p] = offset;
+        offset += batch->page_counts[p];
+    }
+
+    size_t next[SHAD2D_ATLAS_MAX_PAGES];
+    memcpy(next, first, sizeof(next));
+
+    Window2DState *software = shade2d_software(window);
+    if (software) {
+        // Same order as the OpenGL path: scatter sprite indices to their page's slot, then draw page by page
+        size_t *order = shade2d_sprite_scratch(batch, batch->count * sizeof(size_t));
+        if (!order) return;
+        for (size_t i = 0; i < batch->count; i++) {
+            order[next[batch->sprites[i].region.page]++] = i;
+        }
+        for (int p = 0; p < atlas->page_count; p++) {
+            for (size_t k = first[p]; k < first[p] + batch->page_counts[p]; k++) {
+                shade2d_soft_draw_sprite(software, &atlas->pages[p], atlas->page_size, &batch->sprites[order[k]]);
+            }
+        }
+    } else if (window.handle) {
+        // Scatter each sprite's corners to its page's slot in the vertex array
+        Shade2DSpriteVertex *vertices = shade2d_sprite_scratch(batch, batch->count * 4 * sizeof(Shade2DSpriteVertex));
+        if (!vertices) return;
+        static const float corners[4][2] = { {-1, -1}, {1, -1}, {1, 1}, {-1, 1} };
+        for (size_t i = 0; i < batch->count; i++) {
+            const Sprite2D *sprite = &batch->sprites[i];
+            Shade2DSpriteVertex *v = &vertices[next[sprite->region.page]++ * 4];
+            float hw = sprite->width * 0.5f, hh = sprite->height * 0.5f;
+            float c = 1.0f, s = 0.0f;
+            if (sprite->angle != 0.0f) {
+                c = cosf(sprite->angle);
+                s = sinf(sprite->angle);
+            }
+            for (int k = 0; k < 4; k++) {
+                float lx = corners[k][0] * hw, ly = corners[k][1] * hh;
+                v[k].x = sprite->x + lx * c - ly * s;
+                v[k].y = sprite->y + lx * s + ly * c;
+                v[k].u = corners[k][0] < 0 ? sprite->region.u0 : sprite->region.u1;
+                v[k].v = corners[k][1] < 0 ? sprite->region.v0 : sprite->region.v1;
+                v[k].color[0] = sprite->r;
+                v[k].color[1] = sprite->g;
+                v[k].color[2] = sprite->b;
+                v[k].color[3] = sprite->a;
+            }
+        }
+
+        shade2d_upload_texture_atlas(atlas);
+        glPushAttrib(GL_ENABLE_BIT | GL_CURRENT_BIT | GL_TEXTURE_BIT);
+        glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+        glEnable(GL_TEXTURE_2D);
+        glEnable(GL_BLEND);
+        shade2d_setup_projection(window);
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+        glEnableClientState(GL_COLOR_ARRAY);
+        glVertexPointer(2, GL_FLOAT, sizeof(Shade2DSpriteVertex), &vertices[0].x);
+        glTexCoordPointer(2, GL_FLOAT, sizeof(Shade2DSpriteVertex), &vertices[0].u);
+        glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Shade2DSpriteVertex), vertices[0].color);
+        for (int p = 0; p < atlas->page_count; p++) {
+            if (batch->page_counts[p] == 0) continue;
+            glBindTexture(GL_TEXTURE_2D, atlas->pages[p].texture);
+            glDrawArrays(GL_QUADS, (GLint)(first[p] * 4), (GLsizei)(batch->page_counts[p] * 4));
+        }
+        glPopClientAttrib();
+        glPopAttrib();
+    }
+
+    batch->count = 0;
+    memset(batch->page_counts, 0, sizeof(batch->page_counts));
+}
+
+void shade2d_destroy_sprite_batch(SpriteBatch2D* batch) {
+    if (!batch) return;
+    free(batch->sprites);
+    free(batch->scratch);
+    free(batch);
+}
+
+// Text
+//
+// Glyphs are rasterized once into a texture atlas as white coverage masks and
+// drawn as tinted sprites, so a string is a run of quads in the sprite batch
+// and any amount of text on a page costs one draw call.
+
+// 5x7 ASCII glyphs, one byte per row with bit 4 the leftmost column
+static const unsigned char shade2d_font_5x7[95][7] = {
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },  // ' '
+    { 0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04 },  // '!'
+    { 0x0A, 0x0A, 0x0A, 0x00, 0x00, 0x00, 0x00 },  // '"'
+    { 0x0A, 0x0A, 0x1F, 0x0A, 0x1F, 0x0A, 0x0A },  // '#'
+    { 0x04, 0x0F, 0x14, 0x0E, 0x05, 0x1E, 0x04 },  // '$'
+    { 0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03 },  // '%'
+    { 0x0C, 0x12, 0x14, 0x08, 0x15, 0x12, 0x0D },  // '&'
+    { 0x04, 0x04, 0x08, 0x00, 0x00, 0x00, 0x00 },  // '''
+    { 0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02 },  // '('
+    { 0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08 },  // ')'
+    { 0x00, 0x04, 0x15, 0x0E, 0x15, 0x04, 0x00 },  // '*'
+    { 0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00 },  // '+'
+    { 0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08 },  // ','
+    { 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00 },  // '-'
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C },  // '.'
+    { 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00 },  // '/'
+    { 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E },  // '0'
+    { 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E },  // '1'
+    { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F },  // '2'
+    { 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E },  // '3'
+    { 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 },  // '4'
+    { 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E },  // '5'
+    { 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E },  // '6'
+    { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 },  // '7'
+    { 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E },  // '8'
+    { 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C },  // '9'
+    { 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00 },  // ':'
+    { 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x04, 0x08 },  // ';'
+    { 0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02 },  // '<'
+    { 0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00 },  // '='
+    { 0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08 },  // '>'
+    { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04 },  // '?'
+    { 0x0E, 0x11, 0x01, 0x0D, 0x15, 0x15, 0x0E },  // '@'
+    { 0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 },  // 'A'
+    { 0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E },  // 'B'
+    { 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E },  // 'C'
+    { 0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C },  // 'D'
+    { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F },  // 'E'
+    { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10 },  // 'F'
+    { 0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F },  // 'G'
+    { 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 },  // 'H'
+    { 0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E },  // 'I'
+    { 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C },  // 'J'
+    { 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 },  // 'K'
+    { 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F },  // 'L'
+    { 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11 },  // 'M'
+    { 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 },  // 'N'
+    { 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E },  // 'O'
+    { 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10 },  // 'P'
+    { 0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D },  // 'Q'
+    { 0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11 },  // 'R'
+    { 0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E },  // 'S'
+    { 0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 },  // 'T'
+    { 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E },  // 'U'
+    { 0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04 },  // 'V'
+    { 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A },  // 'W'
+    { 0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11 },  // 'X'
+    { 0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04 },  // 'Y'
+    { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F },  // 'Z'
+    { 0x0E, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0E },  // '['
+    { 0x00, 0x10, 0x08, 0x04, 0x02, 0x01, 0x00 },  // backslash
+    { 0x0E, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0E },  // ']'
+    { 0x04, 0x0A, 0x11, 0x00, 0x00, 0x00, 0x00 },  // '^'
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F },  // '_'
+    { 0x08, 0x04, 0x02, 0x00, 0x00, 0x00, 0x00 },  // '`'
+    { 0x00, 0x00, 0x0E, 0x01, 0x0F, 0x11, 0x0F },  // 'a'
+    { 0x10, 0x10, 0x16, 0x19, 0x11, 0x11, 0x1E },  // 'b'
+    { 0x00, 0x00, 0x0E, 0x10, 0x10, 0x11, 0x0E },  // 'c'
+    { 0x01, 0x01, 0x0D, 0x13, 0x11, 0x11, 0x0F },  // 'd'
+    { 0x00, 0x00, 0x0E, 0x11, 0x1F, 0x10, 0x0E },  // 'e'
+    { 0x06, 0x09, 0x08, 0x1C, 0x08, 0x08, 0x08 },  // 'f'
+    { 0x00, 0x0F, 0x11, 0x11, 0x0F, 0x01, 0x0E },  // 'g'
+    { 0x10, 0x10, 0x16, 0x19, 0x11, 0x11, 0x11 },  // 'h'
+    { 0x04, 0x00, 0x0C, 0x04, 0x04, 0x04, 0x0E },  // 'i'
+    { 0x02, 0x00, 0x06, 0x02, 0x02, 0x12, 0x0C },  // 'j'
+    { 0x10, 0x10, 0x12, 0x14, 0x18, 0x14, 0x12 },  // 'k'
+    { 0x0C, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E },  // 'l'
+    { 0x00, 0x00, 0x1A, 0x15, 0x15, 0x11, 0x11 },  // 'm'
+    { 0x00, 0x00, 0x16, 0x19, 0x11, 0x11, 0x11 },  // 'n'
+    { 0x00, 0x00, 0x0E, 0x11, 0x11, 0x11, 0x0E },  // 'o'
+    { 0x00, 0x00, 0x1E, 0x11, 0x1E, 0x10, 0x10 },  // 'p'
+    { 0x00, 0x00, 0x0D, 0x13, 0x0F, 0x01, 0x01 },  // 'q'
+    { 0x00, 0x00, 0x16, 0x19, 0x10, 0x10, 0x10 },  // 'r'
+    { 0x00, 0x00, 0x0E, 0x10, 0x0E, 0x01, 0x1E },  // 's'
+    { 0x08, 0x08, 0x1C, 0x08, 0x08, 0x09, 0x06 },  // 't'
+    { 0x00, 0x00, 0x11, 0x11, 0x11, 0x13, 0x0D },  // 'u'
+    { 0x00, 0x00, 0x11, 0x11, 0x11, 0x0A, 0x04 },  // 'v'
+    { 0x00, 0x00, 0x11, 0x11, 0x15, 0x15, 0x0A },  // 'w'
+    { 0x00, 0x00, 0x11, 0x0A, 0x04, 0x0A, 0x11 },  // 'x'
+    { 0x00, 0x00, 0x11, 0x11, 0x0F, 0x01, 0x0E },  // 'y'
+    { 0x00, 0x00, 0x1F, 0x02, 0x04, 0x08, 0x1F },  // 'z'
+    { 0x02, 0x04, 0x04, 0x08, 0x04, 0x04, 0x02 },  // '{'
+    { 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 },  // '|'
+    { 0x08, 0x04, 0x04, 0x02, 0x04, 0x04, 0x08 },  // '}'
+    { 0x00, 0x00, 0x08, 0x15, 0x02, 0x00, 0x00 },  // '~'
+};
+
+// Adds a 1-bit glyph bitmap to the atlas; rows are stride bytes, most significant bit first
+static void shade2d_add_glyph(Font2D *font, Image2D *scratch, int code, const unsigned char *bits, int stride,
+                              int width, int height, int offset_x, int offset_y, int advance) {
+    FontGlyph2D *glyph = &font->glyphs[code];
+    glyph->offset_x = offset_x;
+    glyph->offset_y = offset_y;
+    glyph->advance = advance;
+    glyph->present = true;
+    if (width <= 0 || height <= 0) {
+        glyph->region.width = glyph->region.height = 0;  // Blank, like a space
+        return;
+    }
+
+    scratch->width = width;
+    scratch->height = height;
+    uint32_t *pixels = (uint32_t *)scratch->pixels;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            bool on = bits[y * stride + x / 8] & (0x80 >> (x % 8));
+            pixels[y * width + x] = on ? shade2d_pack_rgba(255, 255, 255, 255) : 0;
+        }
+    }
+    if (!shade2d_add_image_to_atlas(font->atlas, *scratch, &glyph->region)) {
+        glyph->present = false;
+    }
+}
+
+static Font2D *shade2d_new_font(TextureAtlas2D *atlas, Image2D *scratch, int max_width, int max_height) {
+    if (!atlas) return NULL;
+    Font2D *font = calloc(1, sizeof(Font2D));
+    if (!font) return NULL;
+    font->atlas = atlas;
+    *scratch = shade2d_create_image(max_width, max_height, NULL);
+    if (!scratch->pixels) {
+        free(font);
+        return NULL;
+    }
+    return font;
+}
+
+Font2D* shade2d_create_default_font(TextureAtlas2D* atlas) {
+    Image2D scratch;
+    Font2D *font = shade2d_new_font(atlas, &scratch, 5, 7);
+    if (!font) return NULL;
+    font->line_height = 8;
+    for (int c = 32; c < 127; c++) {
+        unsigned char rows[7];
+        for (int y = 0; y < 7; y++) {
+            rows[y] = (unsigned char)(shade2d_font_5x7[c - 32][y] << 3);  // Left-align to bit 7
+        }
+        bool blank = c == ' ';
+        shade2d_add_glyph(font, &scratch, c, rows, 1, blank ? 0 : 5, blank ? 0 : 7, 0, 0, 6);
+    }
+    shade2d_destroy_image(scratch);
+    return font;
+}
+
+// Decodes one UTF-8 sequence, returns bytes used or 0 if malformed
+static int shade2d_utf8_decode(const unsigned char *p, const unsigned char *end, uint32_t *code) {
+    int length = *p < 0x80 ? 1 : (*p >> 5) == 6 ? 2 : (*p >> 4) == 14 ? 3 : (*p >> 3) == 30 ? 4 : 0;
+    if (length == 0 || end - p < length) return 0;
+    *code = length == 1 ? *p : *p & (0x7F >> length);
+    for (int i = 1; i < length; i++) {
+        *code = (*code << 6) | (p[i] & 0x3F);
+    }
+    return length;
+}
+
+// PC Screen Font, versions 1 and 2, as shipped in Linux console font directories
+static Font2D *shade2d_load_psf(TextureAtlas2D *atlas, const unsigned char *data, size_t size) {
+    uint32_t glyph_count, glyph_bytes, width, height, header_size;
+    bool unicode_table;
+    bool version2 = size >= 32 && data[0] == 0x72 && data[1] == 0xB5 && data[2] == 0x4A && data[3] == 0x86;
+    if (version2) {
+        uint32_t fields[7];
+        for (int i = 0; i < 7; i++) {
+            const unsigned char *f = data + 4 + i * 4;
+            fields[i] = (uint32_t)f[0] | ((uint32_t)f[1] << 8) | ((uint32_t)f[2] << 16) | ((uint32_t)f[3] << 24);
+        }
+        header_size = fields[1];
+        unicode_table = fields[2] & 1;
+        glyph_count = fields[3];
+        glyph_bytes = fields[4];
+        height = fields[5];
+        width = fields[6];
+    } else if (size >= 4 && data[0] == 0x36 && data[1] == 0x04) {
+        header_size = 4;
+        unicode_table = data[2] & 0x06;
+        glyph_count = (data[2] & 0x01) ? 512 : 256;
+        glyph_bytes = data[3];
+        height = data[3];
+        width = 8;
+    } else {
+        return NULL;
+    }
+    uint32_t stride = (width + 7) / 8;
+    if (width == 0 || height == 0 || width > 64 || height > 64 || glyph_bytes < stride * height ||
+        header_size > size || (size - header_size) / glyph_bytes < glyph_count) {
+        return NULL;
+    }
+
+    // Map Latin-1 code points to glyph indices, straight through when there's no table
+    int map[256];
+    for (int c = 0; c < 256; c++) {
+        map[c] = c < (int)glyph_count ? c : -1;
+    }
+    if (unicode_table) {
+        for (int c = 0; c < 256; c++) map[c] = -1;
+        const unsigned char *p = data + header_size + (size_t)glyph_count * glyph_bytes;
+        const unsigned char *end = data + size;
+        for (uint32_t glyph = 0; glyph < glyph_count; glyph++) {
+            bool sequence = false;  // Combining sequences can't be drawn from one byte, skip them
+            bool terminated = false;  // Every glyph's entry ends with a terminator, a cut-off table doesn't
+            while (p < end && !terminated) {
+                uint32_t code;
+                if (version2) {
+                    if (*p == 0xFF) { p++; terminated = true; continue; }
+                    if (*p == 0xFE) { sequence = true; p++; continue; }
+                    int n = shade2d_utf8_decode(p, end, &code);
+                    if (n == 0) return NULL;
+                    p += n;
+                } else {
+                    if (end - p < 2) return NULL;
+                    code = (uint32_t)p[0] | ((uint32_t)p[1] << 8);
+                    p += 2;
+                    if (code == 0xFFFF) { terminated = true; continue; }
+                    if (code == 0xFFFE) { sequence = true; continue; }
+                }
+                if (!sequence && code < 256 && map[code] < 0) map[code] = (int)glyph;
+            }
+            if (!terminated) return NULL;
+        }
+    }
+
+    Image2D scratch;
+    Font2D *font = shade2d_new_font(atlas, &scratch, (int)width, (int)height);
+    if (!font) return NULL;
+    font->line_height = (int)height;
+    for (int c = 0; c < 256; c++) {
+        if (map[c] < 0) continue;
+        const unsigned char *bits = data + header_size + (size_t)map[c] * glyph_bytes;
+        shade2d_add_glyph(font, &scratch, c, bits, (int)stride, (int)width, (int)height, 0, 0, (int)width);
+    }
+    shade2d_destroy_image(scratch);
+    return font;
+}
+
+static int shade2d_hex_digit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static char *shade2d_next_line(char *line) {
+    char *end = strchr(line, '\n');
+    return (end && end[1]) ? end + 1 : NULL;
+}
+
+// Glyph Bitmap Distribution Format, the X11 bitmap font source format
+static Font2D *shade2d_load_bdf(TextureAtlas2D *atlas, char *text) {
+    if (strncmp(text, "STARTFONT", 9) != 0) return NULL;
+    if (!strstr(text, "\nENDFONT")) return NULL;  // Cut off, checked before any glyph goes into the atlas
+    int box_width = 0, box_height = 0, box_x = 0, box_y = 0;
+    int ascent = -1, descent = -1;
+
+    // Header first, for the cell size and baseline
+    for (char *line = text; line; line = shade2d_next_line(line)) {
+        if (strncmp(line, "FONTBOUNDINGBOX ", 16) == 0) {
+            sscanf(line + 16, "%d %d %d %d", &box_width, &box_height, &box_x, &box_y);
+        } else if (strncmp(line, "FONT_ASCENT ", 12) == 0) {
+            sscanf(line + 12, "%d", &ascent);
+        } else if (strncmp(line, "FONT_DESCENT ", 13) == 0) {
+            sscanf(line + 13, "%d", &descent);
+        } else if (strncmp(line, "CHARS ", 6) == 0) {
+            break;
+        }
+    }
+    if (box_width <= 0 || box_height <= 0 || box_width > 256 || box_height > 256) return NULL;
+    if (ascent < 0) ascent = box_height + box_y;
+    if (descent < 0) descent = -box_y;
+
+    Image2D scratch;
+    Font2D *font = shade2d_new_font(atlas, &scratch, box_width, box_height);
+    if (!font) return NULL;
+    font->line_height = ascent + descent;
+
+    int stride_max = (box_width + 7) / 8;
+    unsigned char *bits = calloc((size_t)stride_max * box_height, 1);
+    int encoding = -1, advance = box_width;
+    int width = 0, height = 0, offset_x = 0, offset_y = 0;
+    for (char *line = text; line; line = shade2d_next_line(line)) {
+        if (strncmp(line, "STARTCHAR", 9) == 0) {
+            encoding = -1;
+            advance = box_width;
+            width = height = offset_x = offset_y = 0;
+        } else if (strncmp(line, "ENCODING ", 9) == 0) {
+            sscanf(line + 9, "%d", &encoding);
+        } else if (strncmp(line, "DWIDTH ", 7) == 0) {
+            sscanf(line + 7, "%d", &advance);
+        } else if (strncmp(line, "BBX ", 4) == 0) {
+            sscanf(line + 4, "%d %d %d %d", &width, &height, &offset_x, &offset_y);
+        } else if (strncmp(line, "BITMAP", 6) == 0) {
+            if (encoding < 0 || encoding > 255 || width < 0 || height < 0 || width > box_width || height > box_height || !bits) {
+                continue;
+            }
+            int stride = (width + 7) / 8;
+            for (int row = 0; row < height; row++) {
+                line = shade2d_next_line(line);
+                if (!line) break;
+                bool valid = true;  // Stop at the first non-hex character, short rows are zero
+                for (int b = 0; b < stride; b++) {
+                    int hi = valid ? shade2d_hex_digit(line[b * 2]) : -1;
+                    int lo = hi < 0 ? -1 : shade2d_hex_digit(line[b * 2 + 1]);
+                    valid = lo >= 0;
+                    bits[row * stride + b] = valid ? (unsigned char)(hi * 16 + lo) : 0;
+                }
+            }
+            // BBX offsets are from the baseline, y up; the pen sits at the top of the line
+            shade2d_add_glyph(font, &scratch, encoding, bits, stride, width, height,
+                              offset_x, ascent - (offset_y + height), advance);
+            if (!line) break;
+        }
+    }
+    free(bits);
+    shade2d_destroy_image(scratch);
+    return font;
+}
+
+Font2D* shade2d_load_font(TextureAtlas2D* atlas, const char* path) {
+    size_t size = 0;
+    unsigned char *data = shade2d_read_file(path, &size);
+    if (!data) return NULL;
+    Font2D *font = shade2d_load_psf(atlas, data, size);
+    if (!font) {
+        font = shade2d_load_bdf(atlas, (char *)data);
+    }
+    free(data);
+    return font;
+}
+
+void shade2d_destroy_font(Font2D* font) {
+    free(font);  // Glyphs stay in the atlas until it is destroyed
+}
+
+static const FontGlyph2D *shade2d_font_glyph(const Font2D *font, unsigned char c) {
+    if (font->glyphs[c].present) return &font->glyphs[c];
+    return font->glyphs['?'].present ? &font->glyphs['?'] : NULL;
+}
+
+float shade2d_measure_text(const Font2D* font, float scale, const char* text) {
+    if (!font || !text) return 0.0f;
+    float widest = 0.0f, pen = 0.0f;
+    for (const unsigned char *p = (const unsigned char *)text; *p; p++) {
+        if (*p == '\n') {
+            pen = 0.0f;
+            continue;
+        }
+        const FontGlyph2D *glyph = shade2d_font_glyph(font, *p);
+        if (glyph) pen += glyph->advance * scale;
+        if (pen > widest) widest = pen;
+    }
+    return widest;
+}
+
+float shade2d_draw_text(SpriteBatch2D* batch, const Font2D* font, float x, float y, float scale,
+                        unsigned char r, unsigned char g, unsigned char b, const char* text) {
+    if (!batch || !font || !text) return 0.0f;
+    float widest = 0.0f, pen_x = x, pen_y = y;
+    for (const unsigned char *p = (const unsigned char *)text; *p; p++) {
+        if (*p == '\n') {
+            pen_x = x;
+            pen_y += font->line_height * scale;
+            continue;
+        }
+        const FontGlyph2D *glyph = shade2d_font_glyph(font, *p);
+        if (!glyph) continue;
+        if (glyph->region.width > 0) {
+            Sprite2D sprite;
+            sprite.width = glyph->region.width * scale;
+            sprite.height = glyph->region.height * scale;
+            sprite.x = pen_x + glyph->offset_x * scale + sprite.width * 0.5f;
+            sprite.y = pen_y + glyph->offset_y * scale + sprite.height * 0.5f;
+            sprite.angle = 0.0f;
+            sprite.r = r;
+            sprite.g = g;
+            sprite.b = b;
+            sprite.a = 255;
+            sprite.region = glyph->region;
+            shade2d_add_sprite(batch, sprite);
+        }
+        pen_x += glyph->advance * scale;
+        if (pen_x - x > widest) widest = pen_x - x;
+    }
+    return widest;
+}
+
+float shade2d_draw_textf(SpriteBatch2D* batch, const Font2D* font, float x, float y, float scale,
+                         unsigned char r, unsigned char g, unsigned char b, const char* format, ...) {
+    char buffer[1024];  // On the stack, so overlays redrawn every frame never allocate
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    return shade2d_draw_text(batch, font, x, y, scale, r, g, b, buffer);
+}
+
+// Frame Capture
+//
+// Frames are read back into a ring of pixel buffer objects, so glReadPixels
+// returns immediately and the copy finishes on the GPU. A frame is mapped one
+// frame later and handed, still mapped, to an encoder thread. Headless windows
+// copy their framebuffer into the same ring. Memory is bounded by the slot
+// count: when every slot is busy a windowed capture drops the frame rather
+// than stalling, while a headless capture waits for the encoder.
+
+typedef enum {
+    SHAD2D_CAPTURE_SLOT_FREE,
+    SHAD2D_CAPTURE_SLOT_READING,  // glReadPixels in flight
+    SHAD2D_CAPTURE_SLOT_QUEUED,   // Waiting for or being encoded
+    SHAD2D_CAPTURE_SLOT_DONE      // Encoded, PBO still needs unmapping
+} Shade2DCaptureSlotState;
+
+typedef struct {
+    Shade2DCaptureSlotState state;
+    unsigned int pbo;
+    unsigned char *pixels;  // Mapped PBO, or an owned buffer for headless windows
+    size_t frame_number;
+} Shade2DCaptureSlot;
+
+struct FrameCapture2D {
+    Window2D window;
+    CaptureFormat2D format;
+    char path[512];
+    FILE *file;
+    int width, height, fps;
+    bool bottom_up;  // OpenGL reads rows bottom to top
+
+    Shade2DCaptureSlot *slots;
+    int slot_count;
+    int next_slot;
+    int pending_read;  // Slot read last frame, mapped on the next call
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t done;
+    int *queue;  // Ring of slot indices waiting for the encoder
+    int queue_head, queue_count;
+    bool stopping;
+    bool failed;  // A write failed, later frames are dropped
+
+    size_t frames_captured;
+    size_t frames_dropped;
+    unsigned char *scratch;  // Encoder-side conversion buffer
+};
+
+static uint32_t shade2d_crc_table[256];
+static pthread_once_t shade2d_crc_once = PTHREAD_ONCE_INIT;  // Several captures can encode at once
+
+static void shade2d_crc_init(void) {
+    for (uint32_t n = 0; n < 256; n++) {
+        uint32_t c = n;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        shade2d_crc_table[n] = c;
+    }
+}
+
+static uint32_t shade2d_crc32_update(uint32_t crc, const unsigned char *data, size_t length) {
+    pthread_once(&shade2d_crc_once, shade2d_crc_init);
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc = shade2d_crc_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static void shade2d_write_be32(unsigned char *out, uint32_t value) {
+    out[0] = (unsigned char)(value >> 24);
+    out[1] = (unsigned char)(value >> 16);
+    out[2] = (unsigned char)(value >> 8);
+    out[3] = (unsigned char)value;
+}
+
+// Writes chunk bytes while keeping the running CRC
+static void shade2d_png_write(FILE *file, uint32_t *crc, const unsigned char *data, size_t length) {
+    fwrite(data, 1, length, file);
+    *crc = shade2d_crc32_update(*crc, data, length);
+}
+
+static void shade2d_png_chunk(FILE *file, const char *type, const unsigned char *data, uint32_t length) {
+    unsigned char header[4];
+    uint32_t crc = 0;
+    shade2d_write_be32(header, length);
+    fwrite(header, 1, 4, file);
+    shade2d_png_write(file, &crc, (const unsigned char *)type, 4);
+    if (length) shade2d_png_write(file, &crc, data, length);
+    shade2d_write_be32(header, crc);
+    fwrite(header, 1, 4, file);
+}
+
+// RGBA PNG using stored (uncompressed) deflate blocks, so no zlib dependency and
+// very little CPU per frame. Files are big; recompress offline if needed.
+static bool shade2d_write_png(const char *path, const unsigned char *pixels, int width, int height, bool bottom_up) {
+    FILE *file = fopen(path, "wb");
+    if (!file) return false;
+
+    static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    fwrite(signature, 1, 8, file);
+
+    unsigned char ihdr[13];
+    shade2d_write_be32(ihdr, (uint32_t)width);
+    shade2d_write_be32(ihdr + 4, (uint32_t)height);
+    ihdr[8] = 8;   // Bit depth
+    ihdr[9] = 6;   // RGBA
+    ihdr[10] = 0;  // Deflate
+    ihdr[11] = 0;  // Adaptive filtering
+    ihdr[12] = 0;  // No interlace
+    shade2d_png_chunk(file, "IHDR", ihdr, 13);
+
+    size_t row_bytes = (size_t)width * 4;
+    size_t raw_size = (row_bytes + 1) * height;  // Each row starts with filter type 0
+    size_t block_count = (raw_size + 65534) / 65535;
+    if (block_count == 0) block_count = 1;
+    size_t idat_size = 2 + block_count * 5 + raw_size + 4;
+
+    unsigned char buffer[8];
+    uint32_t crc = 0;
+    shade2d_write_be32(buffer, (uint32_t)idat_size);
+    fwrite(buffer, 1, 4, file);
+    shade2d_png_write(file, &crc, (const unsigned char *)"IDAT", 4);
+    buffer[0] = 0x78;  // zlib header, no compression
+    buffer[1] = 0x01;
+    shade2d_png_write(file, &crc, buffer, 2);
+
+    uint32_t adler_a = 1, adler_b = 0;
+    size_t block_left = 0;
+    size_t remaining = raw_size;
+    for (int y = 0; y < height; y++) {
+        const unsigned char *row = pixels + (size_t)(bottom_up ? height - 1 - y : y) * row_bytes;
+        unsigned char filter = 0;
+        // Feed the filter byte and the row through the block splitter
+        for (int part = 0; part < 2; part++) {
+            const unsigned char *data = part == 0 ? &filter : row;
+            size_t length = part == 0 ? 1 : row_bytes;
+            while (length > 0) {
+                if (block_left == 0) {
+                    block_left = remaining < 65535 ? remaining : 65535;
+                    buffer[0] = (remaining == block_left) ? 1 : 0;  // BFINAL, BTYPE = stored
+                    buffer[1] = (unsigned char)block_left;
+                    buffer[2] = (unsigned char)(block_left >> 8);
+                    buffer[3] = (unsigned char)~block_left;
+                    buffer[4] = (unsigned char)(~block_left >> 8);
+                    shade2d_png_write(file, &crc, buffer, 5);
+                }
+                size_t n = length < block_left ? length : block_left;
+                shade2d_png_write(file, &crc, data, n);
+                for (size_t i = 0; i < n; i++) {
+                    adler_a = (adler_a + data[i]) % 65521;
+                    adler_b = (adler_b + adler_a) % 65521;
+                }
+                data += n;
+                length -= n;
+                block_left -= n;
+                remaining -= n;
+            }
+        }
+    }
+    shade2d_write_be32(buffer, (adler_b << 16) | adler_a);
+    shade2d_png_write(file, &crc, buffer, 4);
+    shade2d_write_be32(buffer, crc);
+    fwrite(buffer, 1, 4, file);
+
+    shade2d_png_chunk(file, "IEND", NULL, 0);
+    bool ok = !ferror(file);
+    if (fclose(file) != 0) ok = false;  // Buffered data is only written here
+    return ok;
+}
+
+static bool shade2d_write_y4m_frame(FrameCapture2D *capture, const unsigned char *pixels) {
+    int w = capture->width, h = capture->height;
+    int cw = (w + 1) / 2, ch = (h + 1) / 2;
+    unsigned char *y_plane = capture->scratch;
+    unsigned char *u_plane = y_plane + (size_t)w * h;
+    unsigned char *v_plane = u_plane + (size_t)cw * ch;
+
+    // BT.601 full range, matching the C420jpeg tag in the header
+    for (int y = 0; y < h; y++) {
+        const unsigned char *row = pixels + (size_t)(capture->bottom_up ? h - 1 - y : y) * w * 4;
+        for (int x = 0; x < w; x++) {
+            int r = row[x * 4], g = row[x * 4 + 1], b = row[x * 4 + 2];
+            y_plane[(size_t)y * w + x] = (unsigned char)((77 * r + 150 * g + 29 * b + 128) >> 8);
+        }
+    }
+    for (int cy = 0; cy < ch; cy++) {
+        for (int cx = 0; cx < cw; cx++) {
+            int r = 0, g = 0, b = 0, n = 0;
+            for (int dy = 0; dy < 2; dy++) {
+                int y = cy * 2 + dy;
+                if (y >= h) break;
+                const unsigned char *row = pixels + (size_t)(capture->bottom_up ? h - 1 - y : y) * w * 4;
+                for (int dx = 0; dx < 2; dx++) {
+                    int x = cx * 2 + dx;
+                    if (x >= w) break;
+                    r += row[x * 4];
+                    g += row[x * 4 + 1];
+                    b += row[x * 4 + 2];
+                    n++;
+                }
+            }
+            r /= n;
+            g /= n;
+            b /= n;
+            int u = ((-43 * r - 85 * g + 128 * b + 128) >> 8) + 128;
+            int v = ((128 * r - 107 * g - 21 * b + 128) >> 8) + 128;
+            u_plane[(size_t)cy * cw + cx] = (unsigned char)(u < 0 ? 0 : u > 255 ? 255 : u);
+            v_plane[(size_t)cy * cw + cx] = (unsigned char)(v < 0 ? 0 : v > 255 ? 255 : v);
+        }
+    }
+
+    size_t bytes = (size_t)w * h + 2 * (size_t)cw * ch;
+    if (fputs("FRAME\n", capture->file) == EOF) return false;
+    return fwrite(capture->scratch, 1, bytes, capture->file) == bytes;
+}
+
+// Returns false if the frame couldn't be written
+static bool shade2d_encode_frame(FrameCapture2D *capture, const Shade2DCaptureSlot *slot) {
+    size_t row_bytes = (size_t)capture->width * 4;
+    switch (capture->format) {
+    case SHAD2D_CAPTURE_RAW:
+        if (!capture->bottom_up) {
+            size_t bytes = row_bytes * capture->height;
+            return fwrite(slot->pixels, 1, bytes, capture->file) == bytes;
+        }
+        for (int y = capture->height - 1; y >= 0; y--) {
+            if (fwrite(slot->pixels + (size_t)y * row_bytes, 1, row_bytes, capture->file) != row_bytes) return false;
+        }
+        return true;
+    case SHAD2D_CAPTURE_Y4M:
+        return shade2d_write_y4m_frame(capture, slot->pixels);
+    case SHAD2D_CAPTURE_PNG_SEQUENCE: {
+        char path[600];
+        // The pattern was checked by shade2d_capture_pattern_valid, it takes exactly one int
+        snprintf(path, sizeof(path), capture->path, (int)slot->frame_number);
+        return shade2d_write_png(path, slot->pixels, capture->width, capture->height, capture->bottom_up);
+    }
+    }
+    return false;
+}
+
+static void *shade2d_capture_thread(void *arg) {
+    FrameCapture2D *capture = arg;
+    pthread_mutex_lock(&capture->lock);
+    for (;;) {
+        while (capture->queue_count == 0 && !capture->stopping) {
+            pthread_cond_wait(&capture->wake, &capture->lock);
+        }
+        if (capture->queue_count == 0) break;  // Stopping and drained
+        int s = capture->queue[capture->queue_head];
+        capture->queue_head = (capture->queue_head + 1) % capture->slot_count;
+        capture->queue_count--;
+        bool failed = capture->failed;
+        pthread_mutex_unlock(&capture->lock);
+
+        // After a failed write the output is incomplete, so later frames are only drained
+        bool written = !failed && shade2d_encode_frame(capture, &capture->slots[s]);
+
+        pthread_mutex_lock(&capture->lock);
+        if (!written) {
+            capture->failed = true;
+            capture->frames_dropped++;
+        }
+        capture->slots[s].state = capture->window.handle ? SHAD2D_CAPTURE_SLOT_DONE : SHAD2D_CAPTURE_SLOT_FREE;
+        pthread_cond_signal(&capture->done);
+    }
+    pthread_mutex_unlock(&capture->lock);
+    return NULL;
+}
+
+// Caller holds the lock
+static void shade2d_capture_enqueue(FrameCapture2D *capture, int s) {
+    capture->slots[s].state = SHAD2D_CAPTURE_SLOT_QUEUED;
+    capture->queue[(capture->queue_head + capture->queue_count) % capture->slot_count] = s;
+    capture->queue_count++;
+    pthread_cond_signal(&capture->wake);
+}
+
+// A PNG pattern goes to snprintf with one int, so allow exactly one integer conversion and %% escapes
+static bool shade2d_capture_pattern_valid(const char *pattern) {
+    int conversions = 0;
+    for (const char *c = pattern; *c; c++) {
+        if (*c != '%') continue;
+        c++;
+        if (*c == '%') continue;
+        while (*c && strchr("-+ #0", *c)) c++;
+        while (*c >= '0' && *c <= '9') c++;
+        if (*c == '.') {
+            c++;
+            while (*c >= '0' && *c <= '9') c++;
+        }
+        if (!*c || !strchr("diouxX", *c)) return false;  // No '*', length modifiers or other types
+        conversions++;
+    }
+    return conversions == 1;
+}
+
+FrameCapture2D* shade2d_start_capture(Window2D window, const char* path, CaptureFormat2D format, int fps, int max_pending_frames) {
+    if (!path || (!window.handle && !shade2d_get_framebuffer(window))) return NULL;
+    if (strlen(path) >= sizeof(((FrameCapture2D *)NULL)->path)) return NULL;
+    if (format == SHAD2D_CAPTURE_PNG_SEQUENCE && !shade2d_capture_pattern_valid(path)) return NULL;
+
+    FrameCapture2D *capture = calloc(1, sizeof(FrameCapture2D));
+    if (!capture) return NULL;
+    capture->window = window;
+    capture->format = format;
+    strncpy(capture->path, path, sizeof(capture->path) - 1);
+    capture->width = window.width;
+    capture->height = window.height;
+    capture->fps = fps > 0 ? fps : 60;
+    capture->bottom_up = window.handle != NULL;
+    capture->slot_count = max_pending_frames >= 2 ? max_pending_frames : 3;
+    capture->pending_read = -1;
+
+    if (format != SHAD2D_CAPTURE_PNG_SEQUENCE) {
+        capture->file = fopen(path, "wb");
+        if (!capture->file) {
+            free(capture);
+            return NULL;
+        }
+        if (format == SHAD2D_CAPTURE_Y4M) {
+            if (fprintf(capture->file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", capture->width, capture->height, capture->fps) < 0) {
+                capture->failed = true;
+            }
+            size_t chroma = (size_t)((capture->width + 1) / 2) * ((capture->height + 1) / 2);
+            capture->scratch = malloc((size_t)capture->width * capture->height + 2 * chroma);
+        }
+    }
+
+    size_t frame_bytes = (size_t)capture->width * capture->height * 4;
+    capture->slots = calloc(capture->slot_count, sizeof(Shade2DCaptureSlot));
+    capture->queue = calloc(capture->slot_count, sizeof(int));
+    for (int i = 0; i < capture->slot_count; i++) {
+        if (window.handle) {
+            glGenBuffers(1, &capture->slots[i].pbo);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, capture->slots[i].pbo);
+            glBufferData(GL_PIXEL_PACK_BUFFER, frame_bytes, NULL, GL_STREAM_READ);
+        } else {
+            capture->slots[i].pixels = malloc(frame_bytes);
+        }
+    }
+    if (window.handle) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    pthread_mutex_init(&capture->lock, NULL);
+    pthread_cond_init(&capture->wake, NULL);
+    pthread_cond_init(&capture->done, NULL);
+    if (pthread_create(&capture->thread, NULL, shade2d_capture_thread, capture) != 0) {
+        capture->stopping = true;
+        shade2d_stop_capture(capture);
+        return NULL;
+    }
+    return capture;
+}
+
+void shade2d_capture_frame(FrameCapture2D* capture) {
+    if (!capture) return;
+    size_t frame_bytes = (size_t)capture->width * capture->height * 4;
+
+    pthread_mutex_lock(&capture->lock);
+    if (capture->window.handle) {
+        // Last frame's read has had a whole frame to land, map it and hand it over
+        if (capture->pending_read >= 0) {
+            Shade2DCaptureSlot *slot = &capture->slots[capture->pending_read];
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->pbo);
+            slot->pixels = glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+            if (slot->pixels) {
+                shade2d_capture_enqueue(capture, capture->pending_read);
+            } else {
+                slot->state = SHAD2D_CAPTURE_SLOT_FREE;
+                capture->frames_dropped++;
+            }
+            capture->pending_read = -1;
+        }
+        // Buffers must be unmapped on this thread before OpenGL can reuse them
+        for (int i = 0; i < capture->slot_count; i++) {
+            if (capture->slots[i].state == SHAD2D_CAPTURE_SLOT_DONE) {
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, capture->slots[i].pbo);
+                glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+                capture->slots[i].pixels = NULL;
+                capture->slots[i].state = SHAD2D_CAPTURE_SLOT_FREE;
+            }
+        }
+    }
+
+    Shade2DCaptureSlot *slot = &capture->slots[capture->next_slot];
+    // Headless rendering is offline, so waiting beats losing frames there
+    while (!capture->window.handle && slot->state != SHAD2D_CAPTURE_SLOT_FREE) {
+        pthread_cond_wait(&capture->done, &capture->lock);
+    }
+    if (slot->state != SHAD2D_CAPTURE_SLOT_FREE) {
+        capture->frames_dropped++;  // Encoder is behind, don't wait for it
+    } else {
+        slot->frame_number = capture->frames_captured++;
+        if (capture->window.handle) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->pbo);
+            glPixelStorei(GL_PACK_ALIGNMENT, 1);
+            glReadPixels(0, 0, capture->width, capture->height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+            slot->state = SHAD2D_CAPTURE_SLOT_READING;
+            capture->pending_read = capture->next_slot;
+        } else {
+            memcpy(slot->pixels, shade2d_get_framebuffer(capture->window), frame_bytes);
+            shade2d_capture_enqueue(capture, capture->next_slot);
+        }
+        capture->next_slot = (capture->next_slot + 1) % capture->slot_count;
+    }
+    if (capture->window.handle) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+    pthread_mutex_unlock(&capture->lock);
+}
+
+size_t shade2d_get_capture_frame_count(FrameCapture2D* capture) {
+    if (!capture) return 0;
+    pthread_mutex_lock(&capture->lock);
+    size_t frames = capture->frames_captured;
+    pthread_mutex_unlock(&capture->lock);
+    return frames;
+}
+
+size_t shade2d_get_capture_dropped_frames(FrameCapture2D* capture) {
+    if (!capture) return 0;
+    pthread_mutex_lock(&capture->lock);
+    size_t dropped = capture->frames_dropped;  // The encoder thread counts failed writes
+    pthread_mutex_unlock(&capture->lock);
+    return dropped;
+}
+
+bool shade2d_capture_failed(FrameCapture2D* capture) {
+    if (!capture) return false;
+    pthread_mutex_lock(&capture->lock);
+    bool failed = capture->failed;
+    pthread_mutex_unlock(&capture->lock);
+    return failed;
+}
+
+bool shade2d_stop_capture(FrameCapture2D* capture) {
+    if (!capture) return false;
+
+    pthread_mutex_lock(&capture->lock);
+    if (capture->window.handle && capture->pending_read >= 0) {
+        Shade2DCaptureSlot *slot = &capture->slots[capture->pending_read];
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->pbo);
+        slot->pixels = glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+        if (slot->pixels) {
+            shade2d_capture_enqueue(capture, capture->pending_read);
+        }
+        capture->pending_read = -1;
+    }
+    bool running = !capture->stopping;
+    capture->stopping = true;
+    pthread_cond_signal(&capture->wake);
+    pthread_mutex_unlock(&capture->lock);
+    if (running) {
+        pthread_join(capture->thread, NULL);
+    }
+
+    for (int i = 0; i < capture->slot_count; i++) {
+        if (capture->window.handle) {
+            if (capture->slots[i].pixels) {
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, capture->slots[i].pbo);
+                glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            }
+            glDeleteBuffers(1, &capture->slots[i].pbo);
+        } else {
+            free(capture->slots[i].pixels);
+        }
+    }
+    if (capture->window.handle) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    bool ok = !capture->failed;
+    if (capture->file && fclose(capture->file) != 0) ok = false;  // Flushes the last frames
+    pthread_mutex_destroy(&capture->lock);
+    pthread_cond_destroy(&capture->wake);
+    pthread_cond_destroy(&capture->done);
+    free(capture->slots);
+    free(capture->queue);
+    free(capture->scratch);
+    free(capture);
+    return ok;
+}
+
+// Input Recording and Replay
+//
+// Input is sampled once per frame in shade2d_update_window, and every input
+// function reads that sample. A recording stores one record per frame: a flags
+// byte saying what changed, then only the changes (toggled keys as varint
+// deltas, cursor movement as zigzag varints, frame time in microseconds). An
+// idle frame costs one byte.
+
+#define SHAD2D_INPUT_KEYS_CHANGED 0x01
+#define SHAD2D_INPUT_BUTTONS_CHANGED 0x02
+#define SHAD2D_INPUT_CURSOR_DELTA 0x04  // Whole-pixel movement, zigzag varints
+#define SHAD2D_INPUT_CURSOR_RAW 0x08    // Fractional positions, raw doubles
+#define SHAD2D_INPUT_DT_CHANGED 0x10
+
+static const unsigned char shade2d_input_magic[8] = { 'S', 'H', 'D', '2', 'I', 'N', 'P', '1' };
+
+// Key codes GLFW accepts, others raise GLFW_INVALID_ENUM
+static const int shade2d_key_ranges[][2] = {
+    {32, 32}, {39, 39}, {44, 57}, {59, 59}, {61, 61}, {65, 93}, {96, 96}, {161, 162},
+    {256, 269}, {280, 284}, {290, 314}, {320, 336}, {340, 348},
+};
+
+static double shade2d_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+static void shade2d_put_varint(FILE *file, uint64_t value) {
+    while (value >= 0x80) {
+        fputc((int)(value & 0x7F) | 0x80, file);
+        value >>= 7;
+    }
+    fputc((int)value, file);
+}
+
+static void shade2d_put_zigzag(FILE *file, int64_t value) {
+    shade2d_put_varint(file, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+static void shade2d_put_double(FILE *file, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    for (int i = 0; i < 8; i++) {
+        fputc((int)(bits >> (i * 8)) & 0xFF, file);
+    }
+}
+
+static bool shade2d_get_varint(Window2DState *st, uint64_t *value) {
+    *value = 0;
+    for (int shift = 0; shift < 64 && st->replay_offset < st->replay_size; shift += 7) {
+        unsigned char byte = st->replay[st->replay_offset++];
+        *value |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+static bool shade2d_get_zigzag(Window2DState *st, int64_t *value) {
+    uint64_t raw;
+    if (!shade2d_get_varint(st, &raw)) return false;
+    *value = (int64_t)(raw >> 1) ^ -(int64_t)(raw & 1);
+    return true;
+}
+
+static bool shade2d_get_double(Window2DState *st, double *value) {
+    if (st->replay_size - st->replay_offset < 8) return false;
+    uint64_t bits = 0;
+    for (int i = 0; i < 8; i++) {
+        bits |= (uint64_t)st->replay[st->replay_offset++] << (i * 8);
+    }
+    memcpy(value, &bits, sizeof(bits));
+    return true;
+}
+
+static bool shade2d_is_whole(double value) {
+    return value == floor(value) && fabs(value) < 1e15;
+}
+
+static void shade2d_poll_input(Window2D window, Shade2DInputFrame *frame) {
+    memset(frame->keys, 0, sizeof(frame->keys));
+    frame->buttons = 0;
+    size_t range_count = sizeof(shade2d_key_ranges) / sizeof(shade2d_key_ranges[0]);
+    for (size_t r = 0; r < range_count; r++) {
+        for (int key = shade2d_key_ranges[r][0]; key <= shade2d_key_ranges[r][1]; key++) {
+            if (glfwGetKey(window.handle, key) == GLFW_PRESS) {
+                frame->keys[key >> 3] |= (unsigned char)(1 << (key & 7));
+            }
+        }
+    }
+    for (int button = 0; button <= SHAD2D_MOUSE_BUTTON_LAST; button++) {
+        if (glfwGetMouseButton(window.handle, button) == GLFW_PRESS) {
+            frame->buttons |= (unsigned char)(1 << button);
+        }
+    }
+    glfwGetCursorPos(window.handle, &frame->mouse_x, &frame->mouse_y);
+}
+
+static void shade2d_record_input_frame(Window2DState *st) {
+    const Shade2DInputFrame *prev = &st->recorded;
+    const Shade2DInputFrame *cur = &st->input;
+    FILE *file = st->recording;
+
+    int toggled = 0;
+    for (size_t i = 0; i < sizeof(cur->keys); i++) {
+        unsigned char diff = cur->keys[i] ^ prev->keys[i];
+        while (diff) {
+            toggled++;
+            diff &= (unsigned char)(diff - 1);
+        }
+    }
+    bool cursor_moved = cur->mouse_x != prev->mouse_x || cur->mouse_y != prev->mouse_y;
+    bool cursor_whole = shade2d_is_whole(cur->mouse_x) && shade2d_is_whole(cur->mouse_y) &&
+                        shade2d_is_whole(prev->mouse_x) && shade2d_is_whole(prev->mouse_y);
+
+    unsigned char flags = 0;
+    if (toggled) flags |= SHAD2D_INPUT_KEYS_CHANGED;
+    if (cur->buttons != prev->buttons) flags |= SHAD2D_INPUT_BUTTONS_CHANGED;
+    if (cursor_moved) flags |= cursor_whole ? SHAD2D_INPUT_CURSOR_DELTA : SHAD2D_INPUT_CURSOR_RAW;
+    if (cur->dt_us != prev->dt_us) flags |= SHAD2D_INPUT_DT_CHANGED;
+    fputc(flags, file);
+
+    if (toggled) {
+        shade2d_put_varint(file, (uint64_t)toggled);
+        int last = 0;
+        for (int key = 0; key <= SHAD2D_KEY_LAST; key++) {
+            if ((cur->keys[key >> 3] ^ prev->keys[key >> 3]) & (1 << (key & 7))) {
+                shade2d_put_varint(file, (uint64_t)(key - last));
+                last = key;
+            }
+        }
+    }
+    if (flags & SHAD2D_INPUT_BUTTONS_CHANGED) {
+        fputc(cur->buttons, file);
+    }
+    if (flags & SHAD2D_INPUT_CURSOR_DELTA) {
+        shade2d_put_zigzag(file, (int64_t)(cur->mouse_x - prev->mouse_x));
+        shade2d_put_zigzag(file, (int64_t)(cur->mouse_y - prev->mouse_y));
+    } else if (flags & SHAD2D_INPUT_CURSOR_RAW) {
+        shade2d_put_double(file, cur->mouse_x);
+        shade2d_put_double(file, cur->mouse_y);
+    }
+    if (flags & SHAD2D_INPUT_DT_CHANGED) {
+        shade2d_put_zigzag(file, (int64_t)cur->dt_us - (int64_t)prev->dt_us);
+    }
+    st->recorded = *cur;
+}
+
+// Applies the next frame of the replay on top of the current input, false at the end
+static bool shade2d_replay_input_frame(Window2DState *st) {
+    if (st->replay_offset >= st->replay_size) return false;
+    Shade2DInputFrame next = st->input;
+    unsigned char flags = st->replay[st->replay_offset++];
+
+    if (flags & SHAD2D_INPUT_KEYS_CHANGED) {
+        uint64_t toggled, delta;
+        if (!shade2d_get_varint(st, &toggled)) return false;
+        uint64_t key = 0;
+        for (uint64_t i = 0; i < toggled; i++) {
+            if (!shade2d_get_varint(st, &delta)) return false;
+            key += delta;
+            if (key > SHAD2D_KEY_LAST) return false;
+            next.keys[key >> 3] ^= (unsigned char)(1 << (key & 7));
+        }
+    }
+    if (flags & SHAD2D_INPUT_BUTTONS_CHANGED) {
+        if (st->replay_offset >= st->replay_size) return false;
+        next.buttons = st->replay[st->replay_offset++];
+    }
+    if (flags & SHAD2D_INPUT_CURSOR_DELTA) {
+        int64_t dx, dy;
+        if (!shade2d_get_zigzag(st, &dx) || !shade2d_get_zigzag(st, &dy)) return false;
+        next.mouse_x += (double)dx;
+        next.mouse_y += (double)dy;
+    } else if (flags & SHAD2D_INPUT_CURSOR_RAW) {
+        if (!shade2d_get_double(st, &next.mouse_x) || !shade2d_get_double(st, &next.mouse_y)) return false;
+    }
+    if (flags & SHAD2D_INPUT_DT_CHANGED) {
+        int64_t delta;
+        if (!shade2d_get_zigzag(st, &delta)) return false;
+        next.dt_us = (uint32_t)((int64_t)next.dt_us + delta);
+    }
+    st->input = next;
+    return true;
+}
+
+// Samples (or replays) the input the next frame will see
+static void shade2d_begin_input_frame(Window2D window) {
+    Window2DState *st = window.state;
+    if (!st) return;
+
+    if (st->replay) {
+        if (!shade2d_replay_input_frame(st)) {
+            shade2d_close_window(window);  // End of the session
+        }
+        return;
+    }
+
+    // Frames are written as they end, so a recording holds exactly the frames that ran
+    if (st->recording) {
+        shade2d_record_input_frame(st);
+    }
+
+    double now = shade2d_now();
+    double dt = st->frame_start > 0 ? now - st->frame_start : 0.0;
+    st->frame_start = now;
+    st->input.dt_us = (uint32_t)fmin(llround(dt * 1e6), (double)UINT32_MAX);
+    if (window.handle) {
+        shade2d_poll_input(window, &st->input);
+    }
+}
+
+bool shade2d_start_input_recording(Window2D window, const char* path) {
+    if (!window.state || window.state->replay) return false;
+    shade2d_stop_input_recording(window);
+
+    FILE *file = fopen(path, "wb");
+    if (!file) return false;
+    fwrite(shade2d_input_magic, 1, sizeof(shade2d_input_magic), file);
+    window.state->recording = file;
+    memset(&window.state->recorded, 0, sizeof(window.state->recorded));  // The first frame is a delta from no input
+    return true;
+}
+
+void shade2d_stop_input_recording(Window2D window) {
+    if (window.state && window.state->recording) {
+        fclose(window.state->recording);
+        window.state->recording = NULL;
+    }
+}
+
+bool shade2d_start_input_replay(Window2D window, const char* path) {
+    if (!window.state) return false;
+    FILE *file = fopen(path, "rb");
+    if (!file) return false;
+
+    // Sessions are a few bytes per frame, read the whole stream up front
+    unsigned char *data = NULL;
+    size_t size = 0, capacity = 0;
+    for (;;) {
+        if (size == capacity) {
+            capacity = capacity ? capacity * 2 : 4096;
+            unsigned char *grown = realloc(data, capacity);
+            if (!grown) break;
+            data = grown;
+        }
+        size_t n = fread(data + size, 1, capacity - size, file);
+        size += n;
+        if (n == 0) break;
+    }
+    bool ok = !ferror(file) && size >= sizeof(shade2d_input_magic) &&
+              memcmp(data, shade2d_input_magic, sizeof(shade2d_input_magic)) == 0;
+    fclose(file);
+    if (!ok) {
+        free(data);
+        return false;
+    }
+
+    Window2DState *st = window.state;
+    shade2d_stop_input_recording(window);
+    free(st->replay);
+    st->replay = data;
+    st->replay_size = size;
+    st->replay_offset = sizeof(shade2d_input_magic);
+    memset(&st->input, 0, sizeof(st->input));
+    if (!shade2d_replay_input_frame(st)) {
+        shade2d_close_window(window);
+    }
+    return true;
+}
+
+bool shade2d_is_replaying(Window2D window) {
+    return window.state && window.state->replay;
+}
+
+float shade2d_get_delta_time(Window2D window) {
+    return window.state ? window.state->input.dt_us * 1e-6f : 0.0f;
+}
+
+void shade2d_get_mouse_position(Window2D window, double* x, double* y) {
+    *x = window.state ? window.state->input.mouse_x : 0.0;
+    *y = window.state ? window.state->input.mouse_y : 0.0;
+}
+
+bool shade2d_is_key_pressed(Window2D window, int key) {
+    if (window.state && key >= 0 && key <= SHAD2D_KEY_LAST) {
+        return window.state->input.keys[key >> 3] & (1 << (key & 7));
+    }
+    return false;
+}
+
+static bool shade2d_is_mouse_button_down(Window2D window, int button) {
+    return window.state && button >= 0 && button <= SHAD2D_MOUSE_BUTTON_LAST &&
+           (window.state->input.buttons & (1 << button));
+}
+
+bool shade2d_is_mouse_pressed_button(Window2D window, int button, Rectangle2D rectangle) {
+    if (window.state) {
+        double xpos = window.state->input.mouse_x;
+        double ypos = window.state->input.mouse_y;
+
+        bool is_inside = (xpos >= rectangle.x && xpos <= rectangle.x + rectangle.width &&
+                          ypos >= rectangle.y && ypos <= rectangle.y + rectangle.height);
+
+        return is_inside && shade2d_is_mouse_button_down(window, button);
+    }
+    return false;
+}
+
+bool shade2d_is_mouse_pressed_button_circle(Window2D window, int button, Circle2D circle) {
+    if (window.state) {
+        double mouseX = window.state->input.mouse_x;
+        double mouseY = window.state->input.mouse_y;
+        
+        // Calculate distance from mouse to circle center
+        float dx = mouseX - circle.x;
+        float dy = mouseY - circle.y;
+        float distance = sqrtf(dx * dx + dy * dy);
+        
+        bool isInside = distance <= circle.radius;
+        bool buttonPressed = shade2d_is_mouse_button_down(window, button);
+        
+        return isInside && buttonPressed;
+    }
+    return false;
+}
+
+// Utility Functions
+void shade2d_buffer_init(Window2D window) {
+    (void)window; // Mark as unused
+    // Dummy implementation - buffer concept is unclear in this context
+    // Might be related to event handling during delays or a misunderstanding
+    // of how rendering buffers work in immediate mode OpenGL.
+    // No action needed for basic functionality.
+}
+
+void shade2d_buffer_destroy(Window2D window) {
+    (void)window; // Mark as unused
+    // Dummy implementation - see shade2d_buffer_init
+    // No action needed for basic functionality.
+}
+
+void shade2d_window_delay(Window2D window, double seconds) {
+    if (window.handle) {
+        double start_time = glfwGetTime();
+        while (glfwGetTime() - start_time < seconds) {
+            glfwPollEvents(); // Poll events to keep the window responsive
+        }
+    }
+}
+
+bool shade2d_check_collision_rect_rect(Rectangle2D r1, Rectangle2D r2) {
+    // AABB collision detection
+    return (r1.x < r2.x + r2.width &&
+            r1.x + r1.width > r2.x &&
+            r1.y < r2.y + r2.height &&
+            r1.y + r1.height > r2.y);
+}
+
+bool shade2d_check_collision_rect_circle(Rectangle2D r, Circle2D c) {
+    // Find the closest point to the circle within the rectangle
+    float closestX = fmax(r.x, fmin(c.x, r.x + r.width));
+    float closestY = fmax(r.y, fmin(c.y, r.y + r.height));
+
+    // Calculate the distance between the circle's center and this closest point
+    float distanceX = c.x - closestX;
+    float distanceY = c.y - closestY;
+    float distanceSquared = (distanceX * distanceX) + (distanceY * distanceY);
+
+    // If the distance is less than the square of the circle's radius, an overlap occurs
+    return distanceSquared < (c.radius * c.radius);
+}
+
+bool shade2d_check_collision_circle_circle(Circle2D c1, Circle2D c2) {
+    // Calculate the distance between the centers of the two circles
+    float distanceX = c1.x - c2.x;
+    float distanceY = c1.y - c2.y;
+    float distanceSquared = (distanceX * distanceX) + (distanceY * distanceY);
+
+    // Calculate the sum of the radii
+    float radiusSum = c1.radius + c2.radius;
+
+    // If the distance is less than the sum of the radii, an overlap occurs
+    return distanceSquared < (radiusSum * radiusSum);
+}
+
+void shade2d_handle_collision_rect_rect(Rectangle2D *r1, Rectangle2D *r2) {
+    // Calculate new velocities based on elastic collision and mass
+    float m1 = r1->mass;
+    float m2 = r2->mass;
+    float v1x = r1->velx;
+    float v1y = r1->vely;
+    float v2x = r2->velx;
+    float v2y = r2->vely;
+
+    // Calculate final velocities using 1D elastic collision formula
+    float v1fx = ((m1 - m2) * v1x + (2 * m2) * v2x) / (m1 + m2);
+    float v1fy = ((m1 - m2) * v1y + (2 * m2) * v2y) / (m1 + m2);
+    float v2fx = ((2 * m1) * v1x + (m2 - m1) * v2x) / (m1 + m2);
+    float v2fy = ((2 * m1) * v1y + (m2 - m1) * v2y) / (m1 + m2);
+
+    // Update velocities
+    r1->velx = v1fx;
+    r1->vely = v1fy;
+    r2->velx = v2fx;
+    r2->vely = v2fy;
+
+    // Separate overlapping rectangles
+    float overlapX = fmin(r1->x + r1->width - r2->x, r2->x + r2->width - r1->x);
+    float overlapY = fmin(r1->y + r1->height - r2->y, r2->y + r2->height - r1->y);
+
+    // Calculate the direction of separation
+    float sep_dir_x = 0;
+    if (r1->x < r2->x) sep_dir_x = -1; else sep_dir_x = 1;
+    float sep_dir_y = 0;
+    if (r1->y < r2->y) sep_dir_y = -1; else sep_dir_y = 1;
+
+    if (overlapX < overlapY) {
+        // Separate along the x-axis
+        r1->x += sep_dir_x * overlapX / 2.0f;
+        r2->x -= sep_dir_x * overlapX / 2.0f;
+    } else {
+        // Separate along the y-axis
+        r1->y += sep_dir_y * overlapY / 2.0f;
+        r2->y -= sep_dir_y * overlapY / 2.0f;
+    }
+}
+
+void shade2d_handle_collision_rect_circle(Rectangle2D *r, Circle2D *c) {
+    // Simple elastic collision response (based on 1D collision for now)
+    // This is a simplified approach for demonstration and can be improved.
+    
+    // Calculate the direction of collision from rectangle to circle
+    float normalX = c->x - (r->x + r->width / 2.0f);
+    float normalY = c->y - (r->y + r->height / 2.0f);
+    
+    // Normalize the collision normal (avoid division by zero)
+    float magnitude = sqrtf(normalX * normalX + normalY * normalY);
+    if (magnitude > 0) {
+        normalX /= magnitude;
+        normalY /= magnitude;
+    }
+
+    // Calculate relative velocity
+    float relativeVelX = c->velx - r->velx;
+    float relativeVelY = c->vely - r->vely;
+
+    // Calculate velocity along the collision normal
+    float velocityAlongNormal = relativeVelX * normalX + relativeVelY * normalY;
+
+    // Do not resolve if velocities are separating
+    if (velocityAlongNormal > 0) return;
+
+    // Calculate impulse scalar using elastic collision formula
+    float m1 = r->mass;
+    float m2 = c->mass;
+    float impulseScalar = -(1.0f + 1.0f) * velocityAlongNormal / (1.0f/m1 + 1.0f/m2);
+
+    // Apply impulse to velocities
+    r->velx -= impulseScalar * normalX / m1;
+    r->vely -= impulseScalar * normalY / m1;
+    c->velx += impulseScalar * normalX / m2;
+    c->vely += impulseScalar * normalY / m2;
+
+    // Separation (basic - could be improved for more accurate separation)
+    float overlap = sqrtf((c->x - (r->x + r->width/2.0f))*(c->x - (r->x + r->width/2.0f)) + (c->y - (r->y + r->height/2.0f))*(c->y - (r->y + r->height/2.0f))) - c->radius;
+    if (overlap < 0) {
+        r->x += normalX * overlap / 2.0f;
+        r->y += normalY * overlap / 2.0f;
+        c->x -= normalX * overlap / 2.0f;
+        c->y -= normalY * overlap / 2.0f;
     }
 }
 
@@ -361,133 +2740,3449 @@ void shade2d_handle_collision_circle_circle(Circle2D *c1, Circle2D *c2) {
     float distanceY = c2->y - c1->y;
     float distance = sqrtf(distanceX * distanceX + distanceY * distanceY);
 
-    // Normalize the distance vector (collision normal)
-    float normalX = distanceX / distance;
-    float normalY = distanceY / distance;
+    // Normalize the distance vector (collision normal)
+    float normalX = distanceX / distance;
+    float normalY = distanceY / distance;
+
+    // Calculate relative velocity
+    float relativeVelX = c2->velx - c1->velx;
+    float relativeVelY = c2->vely - c1->vely;
+
+    // Calculate velocity along the collision normal
+    float velocityAlongNormal = relativeVelX * normalX + relativeVelY * normalY;
+
+    // Do not resolve if velocities are separating
+    if (velocityAlongNormal > 0) return;
+
+    // Calculate impulse scalar using elastic collision formula
+    float m1 = c1->mass;
+    float m2 = c2->mass;
+    float impulseScalar = -(1.0f + 1.0f) * velocityAlongNormal / (1.0f/m1 + 1.0f/m2);
+
+    // Apply impulse to velocities
+    c1->velx -= impulseScalar * normalX / m1;
+    c1->vely -= impulseScalar * normalY / m1;
+    c2->velx += impulseScalar * normalX / m2;
+    c2->vely += impulseScalar * normalY / m2;
+
+    // Separation (push circles apart)
+    float overlap = (c1->radius + c2->radius) - distance;
+    if (overlap > 0) {
+        c1->x -= normalX * overlap / 2.0f;
+        c1->y -= normalY * overlap / 2.0f;
+        c2->x += normalX * overlap / 2.0f;
+        c2->y += normalY * overlap / 2.0f;
+    }
+}
+
+// Narrow phase
+//
+// Shape pairs are dispatched through tables indexed by [type1][type2] instead
+// of chained type checks. Rectangles, boxes and polygons all share the hull
+// path: SAT finds the axis of least penetration, and clipping the incident face
+// against the reference face gives up to two contact points.
+
+typedef struct {
+    int count;
+    float x[SHAD2D_MAX_POLYGON_VERTICES], y[SHAD2D_MAX_POLYGON_VERTICES];
+    float nx[SHAD2D_MAX_POLYGON_VERTICES], ny[SHAD2D_MAX_POLYGON_VERTICES];
+} Shade2DHull;
+
+static void shade2d_hull_of(const Object2D *o, Shade2DHull *h) {
+    switch (o->type) {
+    case SHAD2D_RECTANGLE: {
+        const Rectangle2D *r = &o->obj.rect;
+        h->count = 4;
+        h->x[0] = r->x;            h->y[0] = r->y;             h->nx[0] = 0;  h->ny[0] = -1;
+        h->x[1] = r->x + r->width; h->y[1] = r->y;             h->nx[1] = 1;  h->ny[1] = 0;
+        h->x[2] = r->x + r->width; h->y[2] = r->y + r->height; h->nx[2] = 0;  h->ny[2] = 1;
+        h->x[3] = r->x;            h->y[3] = r->y + r->height; h->nx[3] = -1; h->ny[3] = 0;
+        break;
+    }
+    case SHAD2D_BOX: {
+        const Box2D *b = &o->obj.box;
+        float c = cosf(b->angle);
+        float s = sinf(b->angle);
+        float hw = b->width / 2.0f;
+        float hh = b->height / 2.0f;
+        static const float corners[4][2] = { {-1, -1}, {1, -1}, {1, 1}, {-1, 1} };
+        h->count = 4;
+        for (int i = 0; i < 4; i++) {
+            float lx = corners[i][0] * hw;
+            float ly = corners[i][1] * hh;
+            h->x[i] = b->x + c * lx - s * ly;
+            h->y[i] = b->y + s * lx + c * ly;
+        }
+        h->nx[0] = s;  h->ny[0] = -c;
+        h->nx[1] = c;  h->ny[1] = s;
+        h->nx[2] = -s; h->ny[2] = c;
+        h->nx[3] = -c; h->ny[3] = -s;
+        break;
+    }
+    case SHAD2D_POLYGON: {
+        const Polygon2D *p = &o->obj.polygon;
+        float c = cosf(p->angle);
+        float s = sinf(p->angle);
+        h->count = shade2d_polygon_count(p);
+        for (int i = 0; i < h->count; i++) {
+            float lx = p->vertices[i][0];
+            float ly = p->vertices[i][1];
+            h->x[i] = p->x + c * lx - s * ly;
+            h->y[i] = p->y + s * lx + c * ly;
+        }
+        for (int i = 0; i < h->count; i++) {
+            int j = (i + 1 == h->count) ? 0 : i + 1;
+            float ex = h->x[j] - h->x[i];
+            float ey = h->y[j] - h->y[i];
+            float len = sqrtf(ex * ex + ey * ey);
+            if (len > 0) {
+                ex /= len;
+                ey /= len;
+            }
+            h->nx[i] = ey;
+            h->ny[i] = -ex;
+        }
+        break;
+    }
+    default:
+        h->count = 0;
+        break;
+    }
+}
+
+// Largest signed distance of b's vertices past any face of a (> 0 means separated)
+static float shade2d_hull_max_separation(const Shade2DHull *a, const Shade2DHull *b, int *face) {
+    float best = -FLT_MAX;
+    *face = 0;
+    for (int i = 0; i < a->count; i++) {
+        float min = FLT_MAX;
+        for (int j = 0; j < b->count; j++) {
+            float d = a->nx[i] * (b->x[j] - a->x[i]) + a->ny[i] * (b->y[j] - a->y[i]);
+            if (d < min) min = d;
+        }
+        if (min > best) {
+            best = min;
+            *face = i;
+        }
+    }
+    return best;
+}
+
+// Keep the part of segment (px, py) where n . p - offset <= 0, a moved end takes the clip feature
+static bool shade2d_clip_segment(float px[2], float py[2], uint32_t feature[2], float nx, float ny, float offset, uint32_t clip) {
+    float d0 = nx * px[0] + ny * py[0] - offset;
+    float d1 = nx * px[1] + ny * py[1] - offset;
+    if (d0 > 0 && d1 > 0) return false;
+    if (d0 > 0 || d1 > 0) {
+        float t = d0 / (d0 - d1);
+        float ix = px[0] + t * (px[1] - px[0]);
+        float iy = py[0] + t * (py[1] - py[0]);
+        int k = (d0 > 0) ? 0 : 1;
+        px[k] = ix;
+        py[k] = iy;
+        feature[k] = clip;
+    }
+    return true;
+}
+
+static bool shade2d_collide_hulls(const Shade2DHull *a, const Shade2DHull *b, Manifold2D *m) {
+    int face_a, face_b;
+    float sep_a = shade2d_hull_max_separation(a, b, &face_a);
+    if (sep_a > 0) return false;
+    float sep_b = shade2d_hull_max_separation(b, a, &face_b);
+    if (sep_b > 0) return false;
+
+    // Prefer a's face unless b's is clearly better, so contacts don't flicker between frames
+    const Shade2DHull *ref = a;
+    const Shade2DHull *inc = b;
+    int ref_face = face_a;
+    bool flip = false;
+    if (sep_b > 0.95f * sep_a + 0.01f) {
+        ref = b;
+        inc = a;
+        ref_face = face_b;
+        flip = true;
+    }
+
+    float rnx = ref->nx[ref_face];
+    float rny = ref->ny[ref_face];
+
+    // Incident face is the one most anti-parallel to the reference normal
+    int inc_face = 0;
+    float min_dot = FLT_MAX;
+    for (int i = 0; i < inc->count; i++) {
+        float d = rnx * inc->nx[i] + rny * inc->ny[i];
+        if (d < min_dot) {
+            min_dot = d;
+            inc_face = i;
+        }
+    }
+    int inc_next = (inc_face + 1 == inc->count) ? 0 : inc_face + 1;
+    float cx[2] = { inc->x[inc_face], inc->x[inc_next] };
+    float cy[2] = { inc->y[inc_face], inc->y[inc_next] };
+    uint32_t inc_feature[2] = { SHAD2D_FEATURE_VERTEX | inc_face, SHAD2D_FEATURE_VERTEX | inc_next };
+
+    int ref_next = (ref_face + 1 == ref->count) ? 0 : ref_face + 1;
+    float v1x = ref->x[ref_face], v1y = ref->y[ref_face];
+    float v2x = ref->x[ref_next], v2y = ref->y[ref_next];
+    float tx = v2x - v1x;
+    float ty = v2y - v1y;
+    float len = sqrtf(tx * tx + ty * ty);
+    if (len > 0) {
+        tx /= len;
+        ty /= len;
+    }
+
+    // Clip the incident edge to the side planes of the reference face
+    if (!shade2d_clip_segment(cx, cy, inc_feature, -tx, -ty, -(tx * v1x + ty * v1y), SHAD2D_FEATURE_CLIP | ref_face)) return false;
+    if (!shade2d_clip_segment(cx, cy, inc_feature, tx, ty, tx * v2x + ty * v2y, SHAD2D_FEATURE_CLIP | ref_next)) return false;
+
+    float ref_offset = rnx * v1x + rny * v1y;
+    m->point_count = 0;
+    for (int i = 0; i < 2; i++) {
+        float sep = rnx * cx[i] + rny * cy[i] - ref_offset;
+        if (sep <= 0) {
+            ContactPoint2D *p = &m->points[m->point_count++];
+            p->x = cx[i];
+            p->y = cy[i];
+            p->depth = -sep;
+            // Low byte belongs to obj1, which is the incident hull when flipped
+            uint32_t ref_feature = SHAD2D_FEATURE_EDGE | ref_face;
+            p->feature = flip ? (inc_feature[i] | ref_feature << 8) : (ref_feature | inc_feature[i] << 8);
+        }
+    }
+    if (m->point_count == 0) return false;
+
+    m->normal_x = flip ? -rnx : rnx;
+    m->normal_y = flip ? -rny : rny;
+    return true;
+}
+
+static bool shade2d_collide_hull_circle(const Shade2DHull *h, const Circle2D *c, Manifold2D *m) {
+    float sep = -FLT_MAX;
+    int face = 0;
+    for (int i = 0; i < h->count; i++) {
+        float s = h->nx[i] * (c->x - h->x[i]) + h->ny[i] * (c->y - h->y[i]);
+        if (s > c->radius) return false;
+        if (s > sep) {
+            sep = s;
+            face = i;
+        }
+    }
+    if (h->count == 0) return false;
+
+    int next = (face + 1 == h->count) ? 0 : face + 1;
+    float v1x = h->x[face], v1y = h->y[face];
+    float v2x = h->x[next], v2y = h->y[next];
+
+    m->point_count = 1;
+    if (sep > 1e-6f) {
+        // Center outside: the closest feature may be a vertex rather than the face
+        float u1 = (c->x - v1x) * (v2x - v1x) + (c->y - v1y) * (v2y - v1y);
+        float u2 = (c->x - v2x) * (v1x - v2x) + (c->y - v2y) * (v1y - v2y);
+        if (u1 <= 0 || u2 <= 0) {
+            float px = (u1 <= 0) ? v1x : v2x;
+            float py = (u1 <= 0) ? v1y : v2y;
+            float dx = c->x - px;
+            float dy = c->y - py;
+            float dist2 = dx * dx + dy * dy;
+            if (dist2 >= c->radius * c->radius) return false;
+            float dist = sqrtf(dist2);
+            m->normal_x = dx / dist;
+            m->normal_y = dy / dist;
+            m->points[0].x = px;
+            m->points[0].y = py;
+            m->points[0].depth = c->radius - dist;
+            m->points[0].feature = 0;
+            return true;
+        }
+    }
+
+    m->normal_x = h->nx[face];
+    m->normal_y = h->ny[face];
+    m->points[0].x = c->x - h->nx[face] * sep;
+    m->points[0].y = c->y - h->ny[face] * sep;
+    m->points[0].depth = c->radius - sep;
+    m->points[0].feature = 0;
+    return true;
+}
+
+typedef bool (*Shade2DManifoldFn)(const Object2D *obj1, const Object2D *obj2, Manifold2D *manifold);
+
+// Exchange the two objects' feature bytes
+static uint32_t shade2d_feature_swap(uint32_t feature) {
+    return ((feature & 0xFFu) << 8) | ((feature >> 8) & 0xFFu);
+}
+typedef bool (*Shade2DOverlapFn)(const Object2D *obj1, const Object2D *obj2);
+
+static bool shade2d_manifold_rect_rect(const Object2D *obj1, const Object2D *obj2, Manifold2D *m) {
+    const Rectangle2D *a = &obj1->obj.rect;
+    const Rectangle2D *b = &obj2->obj.rect;
+    float left = fmaxf(a->x, b->x);
+    float right = fminf(a->x + a->width, b->x + b->width);
+    float top = fmaxf(a->y, b->y);
+    float bottom = fminf(a->y + a->height, b->y + b->height);
+    float overlapX = right - left;
+    float overlapY = bottom - top;
+    if (overlapX <= 0 || overlapY <= 0) return false;
+
+    m->point_count = 2;
+    if (overlapX < overlapY) {
+        float mid = (left + right) / 2.0f;
+        m->normal_x = (a->x + a->width / 2.0f < b->x + b->width / 2.0f) ? 1.0f : -1.0f;
+        m->normal_y = 0;
+        // Same feature byte on both sides, the result doesn't depend on argument order
+        m->points[0] = (ContactPoint2D){ mid, top, overlapX, 0x0000u };
+        m->points[1] = (ContactPoint2D){ mid, bottom, overlapX, 0x0101u };
+    } else {
+        float mid = (top + bottom) / 2.0f;
+        m->normal_x = 0;
+        m->normal_y = (a->y + a->height / 2.0f < b->y + b->height / 2.0f) ? 1.0f : -1.0f;
+        m->points[0] = (ContactPoint2D){ left, mid, overlapY, 0x0202u };
+        m->points[1] = (ContactPoint2D){ right, mid, overlapY, 0x0303u };
+    }
+    return true;
+}
+
+static bool shade2d_manifold_rect_circle(const Object2D *obj1, const Object2D *obj2, Manifold2D *m) {
+    const Rectangle2D *r = &obj1->obj.rect;
+    const Circle2D *c = &obj2->obj.circle;
+    float closestX = fmaxf(r->x, fminf(c->x, r->x + r->width));
+    float closestY = fmaxf(r->y, fminf(c->y, r->y + r->height));
+    float dx = c->x - closestX;
+    float dy = c->y - closestY;
+    float dist2 = dx * dx + dy * dy;
+    if (dist2 >= c->radius * c->radius) return false;
+
+    m->point_count = 1;
+    if (dist2 > 0) {
+        float dist = sqrtf(dist2);
+        m->normal_x = dx / dist;
+        m->normal_y = dy / dist;
+        m->points[0] = (ContactPoint2D){ closestX, closestY, c->radius - dist, 0 };
+        return true;
+    }
+
+    // Center inside the rectangle: push out through the nearest face
+    float min = c->x - r->x;
+    m->normal_x = -1;
+    m->normal_y = 0;
+    if (r->x + r->width - c->x < min) { min = r->x + r->width - c->x; m->normal_x = 1; m->normal_y = 0; }
+    if (c->y - r->y < min) { min = c->y - r->y; m->normal_x = 0; m->normal_y = -1; }
+    if (r->y + r->height - c->y < min) { min = r->y + r->height - c->y; m->normal_x = 0; m->normal_y = 1; }
+    m->points[0] = (ContactPoint2D){ c->x + m->normal_x * min, c->y + m->normal_y * min, c->radius + min, 0 };
+    return true;
+}
+
+static bool shade2d_manifold_circle_circle(const Object2D *obj1, const Object2D *obj2, Manifold2D *m) {
+    const Circle2D *c1 = &obj1->obj.circle;
+    const Circle2D *c2 = &obj2->obj.circle;
+    float dx = c2->x - c1->x;
+    float dy = c2->y - c1->y;
+    float dist2 = dx * dx + dy * dy;
+    float radiusSum = c1->radius + c2->radius;
+    if (dist2 >= radiusSum * radiusSum) return false;
+
+    float dist = sqrtf(dist2);
+    m->normal_x = (dist > 0) ? dx / dist : 1.0f;
+    m->normal_y = (dist > 0) ? dy / dist : 0.0f;
+    m->point_count = 1;
+    float depth = radiusSum - dist;
+    m->points[0].x = c1->x + m->normal_x * (c1->radius - depth / 2.0f);
+    m->points[0].y = c1->y + m->normal_y * (c1->radius - depth / 2.0f);
+    m->points[0].depth = depth;
+    m->points[0].feature = 0;
+    return true;
+}
+
+static bool shade2d_manifold_hull_hull(const Object2D *obj1, const Object2D *obj2, Manifold2D *m) {
+    Shade2DHull a, b;
+    shade2d_hull_of(obj1, &a);
+    shade2d_hull_of(obj2, &b);
+    return shade2d_collide_hulls(&a, &b, m);
+}
+
+static bool shade2d_manifold_hull_circle(const Object2D *obj1, const Object2D *obj2, Manifold2D *m) {
+    Shade2DHull h;
+    shade2d_hull_of(obj1, &h);
+    return shade2d_collide_hull_circle(&h, &obj2->obj.circle, m);
+}
+
+typedef struct {
+    Shade2DManifoldFn fn;
+    bool swap;  // Call fn with the objects swapped and flip the normal back
+} Shade2DCollider;
+
+static const Shade2DCollider shade2d_collider_table[SHAD2D_SHAPE_COUNT][SHAD2D_SHAPE_COUNT] = {
+    [SHAD2D_RECTANGLE] = {
+        [SHAD2D_RECTANGLE] = { shade2d_manifold_rect_rect, false },
+        [SHAD2D_CIRCLE] = { shade2d_manifold_rect_circle, false },
+        [SHAD2D_BOX] = { shade2d_manifold_hull_hull, false },
+        [SHAD2D_POLYGON] = { shade2d_manifold_hull_hull, false },
+    },
+    [SHAD2D_CIRCLE] = {
+        [SHAD2D_RECTANGLE] = { shade2d_manifold_rect_circle, true },
+        [SHAD2D_CIRCLE] = { shade2d_manifold_circle_circle, false },
+        [SHAD2D_BOX] = { shade2d_manifold_hull_circle, true },
+        [SHAD2D_POLYGON] = { shade2d_manifold_hull_circle, true },
+    },
+    [SHAD2D_BOX] = {
+        [SHAD2D_RECTANGLE] = { shade2d_manifold_hull_hull, false },
+        [SHAD2D_CIRCLE] = { shade2d_manifold_hull_circle, false },
+        [SHAD2D_BOX] = { shade2d_manifold_hull_hull, false },
+        [SHAD2D_POLYGON] = { shade2d_manifold_hull_hull, false },
+    },
+    [SHAD2D_POLYGON] = {
+        [SHAD2D_RECTANGLE] = { shade2d_manifold_hull_hull, false },
+        [SHAD2D_CIRCLE] = { shade2d_manifold_hull_circle, false },
+        [SHAD2D_BOX] = { shade2d_manifold_hull_hull, false },
+        [SHAD2D_POLYGON] = { shade2d_manifold_hull_hull, false },
+    },
+};
+
+static bool shade2d_overlap_rect_rect(const Object2D *obj1, const Object2D *obj2) {
+    return shade2d_check_collision_rect_rect(obj1->obj.rect, obj2->obj.rect);
+}
+
+static bool shade2d_overlap_rect_circle(const Object2D *obj1, const Object2D *obj2) {
+    return shade2d_check_collision_rect_circle(obj1->obj.rect, obj2->obj.circle);
+}
+
+static bool shade2d_overlap_circle_rect(const Object2D *obj1, const Object2D *obj2) {
+    return shade2d_check_collision_rect_circle(obj2->obj.rect, obj1->obj.circle);
+}
+
+static bool shade2d_overlap_circle_circle(const Object2D *obj1, const Object2D *obj2) {
+    return shade2d_check_collision_circle_circle(obj1->obj.circle, obj2->obj.circle);
+}
+
+static bool shade2d_overlap_hull_hull(const Object2D *obj1, const Object2D *obj2) {
+    // Separating axis test only, no clipping needed for a yes/no answer
+    Shade2DHull a, b;
+    int face;
+    shade2d_hull_of(obj1, &a);
+    shade2d_hull_of(obj2, &b);
+    return shade2d_hull_max_separation(&a, &b, &face) <= 0 &&
+           shade2d_hull_max_separation(&b, &a, &face) <= 0;
+}
+
+static bool shade2d_overlap_hull_circle(const Object2D *obj1, const Object2D *obj2) {
+    Manifold2D m;
+    return shade2d_manifold_hull_circle(obj1, obj2, &m);
+}
+
+static bool shade2d_overlap_circle_hull(const Object2D *obj1, const Object2D *obj2) {
+    Manifold2D m;
+    return shade2d_manifold_hull_circle(obj2, obj1, &m);
+}
+
+static const Shade2DOverlapFn shade2d_overlap_table[SHAD2D_SHAPE_COUNT][SHAD2D_SHAPE_COUNT] = {
+    [SHAD2D_RECTANGLE] = {
+        shade2d_overlap_rect_rect, shade2d_overlap_rect_circle, shade2d_overlap_hull_hull, shade2d_overlap_hull_hull
+    },
+    [SHAD2D_CIRCLE] = {
+        shade2d_overlap_circle_rect, shade2d_overlap_circle_circle, shade2d_overlap_circle_hull, shade2d_overlap_circle_hull
+    },
+    [SHAD2D_BOX] = {
+        shade2d_overlap_hull_hull, shade2d_overlap_hull_circle, shade2d_overlap_hull_hull, shade2d_overlap_hull_hull
+    },
+    [SHAD2D_POLYGON] = {
+        shade2d_overlap_hull_hull, shade2d_overlap_hull_circle, shade2d_overlap_hull_hull, shade2d_overlap_hull_hull
+    },
+};
+
+static bool shade2d_overlap(const Object2D *obj1, const Object2D *obj2) {
+    if ((unsigned)obj1->type >= SHAD2D_SHAPE_COUNT || (unsigned)obj2->type >= SHAD2D_SHAPE_COUNT) {
+        return false;
+    }
+    return shade2d_overlap_table[obj1->type][obj2->type](obj1, obj2);
+}
+
+bool shade2d_check_collision(Object2D obj1, Object2D obj2) {
+    return shade2d_overlap(&obj1, &obj2);
+}
+
+bool shade2d_collide(const Object2D *obj1, const Object2D *obj2, Manifold2D *manifold) {
+    if ((unsigned)obj1->type >= SHAD2D_SHAPE_COUNT || (unsigned)obj2->type >= SHAD2D_SHAPE_COUNT) {
+        return false;
+    }
+    const Shade2DCollider *collider = &shade2d_collider_table[obj1->type][obj2->type];
+    if (!collider->swap) {
+        return collider->fn(obj1, obj2, manifold);
+    }
+    if (!collider->fn(obj2, obj1, manifold)) return false;
+    manifold->normal_x = -manifold->normal_x;
+    manifold->normal_y = -manifold->normal_y;
+    for (int i = 0; i < manifold->point_count; i++) {
+        manifold->points[i].feature = shade2d_feature_swap(manifold->points[i].feature);
+    }
+    return true;
+}
+
+// Uniform view over the fields every shape shares, plus rotation for the shapes that have it
+typedef struct {
+    float *x, *y;
+    float *velx, *vely;
+    float *angvel;  // NULL for shapes that don't rotate
+    float inv_mass;
+    float inv_inertia;
+} Shade2DBody;
+
+static Shade2DBody shade2d_body_of(Object2D *o) {
+    Shade2DBody b;
+    float mass;
+    float inertia = 0;
+    b.angvel = NULL;
+    switch (o->type) {
+    case SHAD2D_RECTANGLE:
+        b.x = &o->obj.rect.x; b.y = &o->obj.rect.y;
+        b.velx = &o->obj.rect.velx; b.vely = &o->obj.rect.vely;
+        mass = o->obj.rect.mass;
+        break;
+    case SHAD2D_CIRCLE:
+        b.x = &o->obj.circle.x; b.y = &o->obj.circle.y;
+        b.velx = &o->obj.circle.velx; b.vely = &o->obj.circle.vely;
+        mass = o->obj.circle.mass;
+        break;
+    case SHAD2D_BOX: {
+        Box2D *box = &o->obj.box;
+        b.x = &box->x; b.y = &box->y;
+        b.velx = &box->velx; b.vely = &box->vely;
+        b.angvel = &box->angvel;
+        mass = box->mass;
+        inertia = mass * (box->width * box->width + box->height * box->height) / 12.0f;
+        break;
+    }
+    default: {
+        Polygon2D *p = &o->obj.polygon;
+        b.x = &p->x; b.y = &p->y;
+        b.velx = &p->velx; b.vely = &p->vely;
+        b.angvel = &p->angvel;
+        mass = p->mass;
+        // Polygon inertia about the centroid, which shade2d_polygon keeps at the origin
+        float num = 0, den = 0;
+        int count = shade2d_polygon_count(p);
+        for (int i = 0; i < count; i++) {
+            const float *v1 = p->vertices[i];
+            const float *v2 = p->vertices[(i + 1) % count];
+            float cross = fabsf(v1[0] * v2[1] - v1[1] * v2[0]);
+            num += cross * (v1[0] * v1[0] + v1[1] * v1[1] + v1[0] * v2[0] + v1[1] * v2[1] +
+                            v2[0] * v2[0] + v2[1] * v2[1]);
+            den += cross;
+        }
+        if (den > 0) inertia = mass * num / (6.0f * den);
+        break;
+    }
+    }
+    b.inv_mass = (mass > 0) ? 1.0f / mass : 0.0f;
+    b.inv_inertia = (inertia > 0) ? 1.0f / inertia : 0.0f;
+    return b;
+}
+
+void shade2d_resolve_manifold(Object2D *obj1, Object2D *obj2, const Manifold2D *manifold) {
+    if (manifold->point_count <= 0) return;
+
+    Shade2DBody a = shade2d_body_of(obj1);
+    Shade2DBody b = shade2d_body_of(obj2);
+    float nx = manifold->normal_x;
+    float ny = manifold->normal_y;
+
+    // A single impulse through the average contact point
+    float px = 0, py = 0, depth = 0;
+    for (int i = 0; i < manifold->point_count; i++) {
+        px += manifold->points[i].x;
+        py += manifold->points[i].y;
+        depth = fmaxf(depth, manifold->points[i].depth);
+    }
+    px /= manifold->point_count;
+    py /= manifold->point_count;
+
+    float rax = px - *a.x, ray = py - *a.y;
+    float rbx = px - *b.x, rby = py - *b.y;
+    float wa = a.angvel ? *a.angvel : 0.0f;
+    float wb = b.angvel ? *b.angvel : 0.0f;
+
+    float relativeVelX = (*b.velx - wb * rby) - (*a.velx - wa * ray);
+    float relativeVelY = (*b.vely + wb * rbx) - (*a.vely + wa * rax);
+    float velocityAlongNormal = relativeVelX * nx + relativeVelY * ny;
+
+    if (velocityAlongNormal < 0) {
+        float raCrossN = rax * ny - ray * nx;
+        float rbCrossN = rbx * ny - rby * nx;
+        float k = a.inv_mass + b.inv_mass +
+                  raCrossN * raCrossN * a.inv_inertia + rbCrossN * rbCrossN * b.inv_inertia;
+        if (k > 0) {
+            // Same elastic response as the built-in handlers
+            float impulseScalar = -(1.0f + 1.0f) * velocityAlongNormal / k;
+            *a.velx -= impulseScalar * nx * a.inv_mass;
+            *a.vely -= impulseScalar * ny * a.inv_mass;
+            *b.velx += impulseScalar * nx * b.inv_mass;
+            *b.vely += impulseScalar * ny * b.inv_mass;
+            if (a.angvel) *a.angvel -= raCrossN * impulseScalar * a.inv_inertia;
+            if (b.angvel) *b.angvel += rbCrossN * impulseScalar * b.inv_inertia;
+        }
+    }
+
+    // Separation, split by inverse mass so immovable (mass 0) objects stay put
+    float totalInvMass = a.inv_mass + b.inv_mass;
+    if (depth > 0 && totalInvMass > 0) {
+        float share = depth / totalInvMass;
+        *a.x -= nx * share * a.inv_mass;
+        *a.y -= ny * share * a.inv_mass;
+        *b.x += nx * share * b.inv_mass;
+        *b.y += ny * share * b.inv_mass;
+    }
+}
+
+static void shade2d_object_bounds(const Object2D *o, float *minx, float *miny, float *maxx, float *maxy) {
+    switch (o->type) {
+    case SHAD2D_RECTANGLE:
+        *minx = o->obj.rect.x;
+        *miny = o->obj.rect.y;
+        *maxx = o->obj.rect.x + o->obj.rect.width;
+        *maxy = o->obj.rect.y + o->obj.rect.height;
+        break;
+    case SHAD2D_CIRCLE:
+        *minx = o->obj.circle.x - o->obj.circle.radius;
+        *miny = o->obj.circle.y - o->obj.circle.radius;
+        *maxx = o->obj.circle.x + o->obj.circle.radius;
+        *maxy = o->obj.circle.y + o->obj.circle.radius;
+        break;
+    case SHAD2D_BOX: {
+        const Box2D *b = &o->obj.box;
+        float c = fabsf(cosf(b->angle));
+        float s = fabsf(sinf(b->angle));
+        float ex = (c * b->width + s * b->height) / 2.0f;
+        float ey = (s * b->width + c * b->height) / 2.0f;
+        *minx = b->x - ex;
+        *miny = b->y - ey;
+        *maxx = b->x + ex;
+        *maxy = b->y + ey;
+        break;
+    }
+    case SHAD2D_POLYGON: {
+        Shade2DHull h;
+        shade2d_hull_of(o, &h);
+        *minx = *miny = FLT_MAX;
+        *maxx = *maxy = -FLT_MAX;
+        for (int i = 0; i < h.count; i++) {
+            *minx = fminf(*minx, h.x[i]);
+            *miny = fminf(*miny, h.y[i]);
+            *maxx = fmaxf(*maxx, h.x[i]);
+            *maxy = fmaxf(*maxy, h.y[i]);
+        }
+        break;
+    }
+    default:
+        *minx = *miny = FLT_MAX;
+        *maxx = *maxy = -FLT_MAX;
+        break;
+    }
+}
+
+// Broad phase
+//
+// The contact solver buckets candidate pairs by their (lower type, higher type)
+// pair so each bucket runs one collider over all of its pairs without
+// re-checking types. The scratch lives in the solver, so solvers on different
+// threads don't share it.
+
+#define SHAD2D_PAIR_BUCKETS (SHAD2D_SHAPE_COUNT * SHAD2D_SHAPE_COUNT)
+
+typedef struct {
+    size_t a, b;  // Indices into the object list, a holds the lower shape type
+} Shade2DPair;
+
+typedef struct {
+    float *minx, *miny, *maxx, *maxy;
+    size_t bounds_capacity;
+    Shade2DPair *pairs[SHAD2D_PAIR_BUCKETS];
+    size_t pair_count[SHAD2D_PAIR_BUCKETS];
+    size_t pair_capacity[SHAD2D_PAIR_BUCKETS];
+} Shade2DBroadphase;
+
+// Resolves a pair if it touches, a holding the lower shape type; true if anything moved
+typedef bool (*Shade2DPairKernel)(Object2D *a, Object2D *b);
+
+static void shade2d_broadphase_push(Shade2DBroadphase *broadphase, int bucket, size_t a, size_t b) {
+    if (broadphase->pair_count[bucket] >= broadphase->pair_capacity[bucket]) {
+        size_t capacity = broadphase->pair_capacity[bucket] ? broadphase->pair_capacity[bucket] * 2 : 64;
+        broadphase->pairs[bucket] = realloc(broadphase->pairs[bucket], capacity * sizeof(Shade2DPair));
+        broadphase->pair_capacity[bucket] = capacity;
+    }
+    Shade2DPair *pair = &broadphase->pairs[bucket][broadphase->pair_count[bucket]++];
+    pair->a = a;
+    pair->b = b;
+}
+
+static void shade2d_broadphase_free(Shade2DBroadphase *broadphase) {
+    free(broadphase->minx);
+    for (int bucket = 0; bucket < SHAD2D_PAIR_BUCKETS; bucket++) {
+        free(broadphase->pairs[bucket]);
+    }
+    memset(broadphase, 0, sizeof(*broadphase));
+}
+
+// Index of the lowest set bit, the last layer for an empty category
+static int shade2d_lowest_layer(uint32_t category) {
+    if (!category) return SHAD2D_COLLISION_LAYERS - 1;
+#if defined(__GNUC__)
+    return __builtin_ctz(category);
+#else
+    int layer = 0;
+    while (!(category & 1u)) {
+        category >>= 1;
+        layer++;
+    }
+    return layer;
+#endif
+}
+
+// True if each object's category is in the other's mask
+static bool shade2d_layers_interact(ObjectList2D objects, size_t a, size_t b) {
+    return (objects.categories[a] & objects.masks[b]) && (objects.categories[b] & objects.masks[a]);
+}
+
+static void shade2d_count_narrow_phase(CollisionStats2D *stats, int li, uint32_t category) {
+    int lj = shade2d_lowest_layer(category);
+    stats->layer_pairs[li < lj ? li : lj][li < lj ? lj : li]++;
+    stats->narrow_phase++;
+}
+
+// Sizes the bounds arrays for the list and fills them; false if they couldn't be allocated
+static bool shade2d_broadphase_bounds(Shade2DBroadphase *broadphase, ObjectList2D objects) {
+    if (objects.size > broadphase->bounds_capacity) {
+        size_t capacity = objects.size;
+        float *bounds = realloc(broadphase->minx, 4 * capacity * sizeof(float));
+        if (!bounds) return false;
+        broadphase->minx = bounds;
+        broadphase->miny = bounds + capacity;
+        broadphase->maxx = bounds + 2 * capacity;
+        broadphase->maxy = bounds + 3 * capacity;
+        broadphase->bounds_capacity = capacity;
+    }
+    for (size_t i = 0; i < objects.size; i++) {
+        shade2d_object_bounds(&objects.objects[i], &broadphase->minx[i], &broadphase->miny[i],
+                              &broadphase->maxx[i], &broadphase->maxy[i]);
+    }
+    return true;
+}
+
+static void shade2d_broadphase_build(Shade2DBroadphase *broadphase, ObjectList2D objects, CollisionStats2D *stats) {
+    memset(broadphase->pair_count, 0, sizeof(broadphase->pair_count));
+    memset(stats, 0, sizeof(*stats));
+    if (!shade2d_broadphase_bounds(broadphase, objects)) return;
+
+    const float *minx = broadphase->minx, *miny = broadphase->miny;
+    const float *maxx = broadphase->maxx, *maxy = broadphase->maxy;
+    const uint32_t *categories = objects.categories, *masks = objects.masks;
+    size_t filtered = 0;
+    for (size_t i = 0; i < objects.size; i++) {
+        int ti = objects.objects[i].type;
+        if ((unsigned)ti >= SHAD2D_SHAPE_COUNT) continue;
+        uint32_t category = categories[i], mask = masks[i];
+        int li = shade2d_lowest_layer(category);
+        float x0 = minx[i], y0 = miny[i], x1 = maxx[i], y1 = maxy[i];
+        for (size_t j = i + 1; j < objects.size; j++) {
+            // Layer and bounds tests are combined without branches, so rejecting a pair costs one branch
+            bool layers = ((category & masks[j]) != 0) & ((categories[j] & mask) != 0);
+            bool overlap = (x0 <= maxx[j]) & (minx[j] <= x1) & (y0 <= maxy[j]) & (miny[j] <= y1);
+            filtered += !layers;
+            if (!(layers & overlap)) continue;
+            int tj = objects.objects[j].type;
+            if ((unsigned)tj >= SHAD2D_SHAPE_COUNT) continue;
+            shade2d_count_narrow_phase(stats, li, categories[j]);
+            if (ti <= tj) {
+                shade2d_broadphase_push(broadphase, ti * SHAD2D_SHAPE_COUNT + tj, i, j);
+            } else {
+                shade2d_broadphase_push(broadphase, tj * SHAD2D_SHAPE_COUNT + ti, j, i);
+            }
+        }
+    }
+    stats->filtered = filtered;
+}
+
+static bool shade2d_kernel_rect_rect(Object2D *a, Object2D *b) {
+    if (!shade2d_check_collision_rect_rect(a->obj.rect, b->obj.rect)) return false;
+    shade2d_handle_collision_rect_rect(&a->obj.rect, &b->obj.rect);
+    return true;
+}
+
+static bool shade2d_kernel_rect_circle(Object2D *a, Object2D *b) {
+    if (!shade2d_check_collision_rect_circle(a->obj.rect, b->obj.circle)) return false;
+    shade2d_handle_collision_rect_circle(&a->obj.rect, &b->obj.circle);
+    return true;
+}
+
+static bool shade2d_kernel_circle_circle(Object2D *a, Object2D *b) {
+    if (!shade2d_check_collision_circle_circle(a->obj.circle, b->obj.circle)) return false;
+    shade2d_handle_collision_circle_circle(&a->obj.circle, &b->obj.circle);
+    return true;
+}
+
+static bool shade2d_kernel_manifold(Object2D *a, Object2D *b) {
+    const Shade2DCollider *collider = &shade2d_collider_table[a->type][b->type];
+    if (collider->swap) {
+        Object2D *t = a;
+        a = b;
+        b = t;
+    }
+    Manifold2D manifold;
+    if (!collider->fn(a, b, &manifold)) return false;
+    shade2d_resolve_manifold(a, b, &manifold);
+    return true;
+}
+
+static const Shade2DPairKernel shade2d_pair_kernels[SHAD2D_PAIR_BUCKETS] = {
+    [SHAD2D_RECTANGLE * SHAD2D_SHAPE_COUNT + SHAD2D_RECTANGLE] = shade2d_kernel_rect_rect,
+    [SHAD2D_RECTANGLE * SHAD2D_SHAPE_COUNT + SHAD2D_CIRCLE] = shade2d_kernel_rect_circle,
+    [SHAD2D_CIRCLE * SHAD2D_SHAPE_COUNT + SHAD2D_CIRCLE] = shade2d_kernel_circle_circle,
+};
+
+// Implementation of ObjectList2D functions
+
+ObjectList2D shade2d_create_object_list() {
+    ObjectList2D list;
+    list.objects = malloc(10 * sizeof(Object2D));  // Initial capacity of 10
+    list.ids = malloc(10 * sizeof(ObjectID));
+    list.materials = malloc(10 * sizeof(Material2D));
+    list.categories = malloc(10 * sizeof(uint32_t));
+    list.masks = malloc(10 * sizeof(uint32_t));
+    list.size = 0;
+    list.capacity = 10;
+    list.grid = NULL;
+    list.mapping = NULL;
+    list.mapping_size = 0;
+    return list;
+}
+
+// True if the array points into the list's snapshot mapping rather than the heap
+static bool shade2d_is_mapped(const ObjectList2D *objects, const void *array) {
+    const char *p = array;
+    const char *base = objects->mapping;
+    return base && p >= base && p < base + objects->mapping_size;
+}
+
+// realloc that moves arrays out of a snapshot mapping on first growth
+static void *shade2d_list_realloc(const ObjectList2D *objects, void *array, size_t count, size_t element_size) {
+    if (!shade2d_is_mapped(objects, array)) {
+        return realloc(array, count * element_size);
+    }
+    void *copy = malloc(count * element_size);
+    if (copy) memcpy(copy, array, objects->size * element_size);
+    return copy;
+}
+
+void shade2d_reserve_object_list(ObjectList2D *objects, size_t capacity) {
+    if (capacity <= objects->capacity) return;
+    objects->objects = shade2d_list_realloc(objects, objects->objects, capacity, sizeof(Object2D));
+    objects->ids = shade2d_list_realloc(objects, objects->ids, capacity, sizeof(ObjectID));
+    objects->materials = shade2d_list_realloc(objects, objects->materials, capacity, sizeof(Material2D));
+    objects->categories = shade2d_list_realloc(objects, objects->categories, capacity, sizeof(uint32_t));
+    objects->masks = shade2d_list_realloc(objects, objects->masks, capacity, sizeof(uint32_t));
+    objects->capacity = capacity;
+}
+
+void shade2d_add_object_to_list(ObjectList2D *objects, Object2D obj, ObjectID id) {
+    if (objects->size >= objects->capacity) {
+        shade2d_reserve_object_list(objects, objects->capacity ? objects->capacity * 2 : 10);
+    }
+    objects->objects[objects->size] = obj;  // Store the object
+    objects->ids[objects->size] = id;
+    objects->materials[objects->size].restitution = 1.0f;  // Elastic, like the built-in handlers
+    objects->materials[objects->size].friction = 0.0f;
+    objects->categories[objects->size] = SHAD2D_CATEGORY_DEFAULT;
+    objects->masks[objects->size] = SHAD2D_MASK_ALL;
+    objects->size++;
+}
+
+size_t shade2d_get_object_list_size(ObjectList2D objects) {
+    return objects.size;
+}
+
+Object2D* shade2d_get_object_by_id(ObjectList2D objects, size_t index) {  // Treating index as ID for now
+    if (index < objects.size) {
+        return &objects.objects[index];
+    }
+    return NULL;  // Or handle error
+}
+
+bool shade2d_check_collisions_object_list(ObjectList2D objects) {
+    for (size_t i = 0; i < objects.size; i++) {
+        for (size_t j = i + 1; j < objects.size; j++) {
+            if (!shade2d_layers_interact(objects, i, j)) continue;
+            if (shade2d_overlap(&objects.objects[i], &objects.objects[j])) {
+                return true;  // Collision found
+            }
+        }
+    }
+    return false;
+}
+
+void shade2d_handle_collisions_object_list(ObjectList2D objects) {
+    shade2d_handle_collisions_object_list_stats(objects, NULL);
+}
+
+// Pairs are resolved in (i, j) order against live positions, as each one moves
+// objects later pairs see. Bounds are refreshed for the two objects of every
+// resolved pair, so the prefilter never rejects a pair that now touches.
+void shade2d_handle_collisions_object_list_stats(ObjectList2D objects, CollisionStats2D *stats) {
+    if (stats) memset(stats, 0, sizeof(*stats));
+    Shade2DBroadphase broadphase;
+    memset(&broadphase, 0, sizeof(broadphase));
+    if (!shade2d_broadphase_bounds(&broadphase, objects)) return;
+
+    float *minx = broadphase.minx, *miny = broadphase.miny;
+    float *maxx = broadphase.maxx, *maxy = broadphase.maxy;
+    const uint32_t *categories = objects.categories, *masks = objects.masks;
+    size_t filtered = 0;
+    for (size_t i = 0; i < objects.size; i++) {
+        int ti = objects.objects[i].type;
+        if ((unsigned)ti >= SHAD2D_SHAPE_COUNT) continue;
+        uint32_t category = categories[i], mask = masks[i];
+        int li = shade2d_lowest_layer(category);
+        for (size_t j = i + 1; j < objects.size; j++) {
+            bool layers = ((category & masks[j]) != 0) & ((categories[j] & mask) != 0);
+            bool overlap = (minx[i] <= maxx[j]) & (minx[j] <= maxx[i]) & (miny[i] <= maxy[j]) & (miny[j] <= maxy[i]);
+            filtered += !layers;
+            if (!(layers & overlap)) continue;
+            int tj = objects.objects[j].type;
+            if ((unsigned)tj >= SHAD2D_SHAPE_COUNT) continue;
+            if (stats) shade2d_count_narrow_phase(stats, li, categories[j]);
+            int bucket = ti <= tj ? ti * SHAD2D_SHAPE_COUNT + tj : tj * SHAD2D_SHAPE_COUNT + ti;
+            Shade2DPairKernel kernel = shade2d_pair_kernels[bucket] ? shade2d_pair_kernels[bucket] : shade2d_kernel_manifold;
+            Object2D *a = &objects.objects[ti <= tj ? i : j];
+            Object2D *b = &objects.objects[ti <= tj ? j : i];
+            if (kernel(a, b)) {
+                shade2d_object_bounds(&objects.objects[i], &minx[i], &miny[i], &maxx[i], &maxy[i]);
+                shade2d_object_bounds(&objects.objects[j], &minx[j], &miny[j], &maxx[j], &maxy[j]);
+            }
+        }
+    }
+    if (stats) stats->filtered = filtered;
+    shade2d_broadphase_free(&broadphase);
+}
+
+void shade2d_draw_object_list(Window2D window, ObjectList2D objects) {
+    for (size_t i = 0; i < objects.size; i++) {
+        switch (objects.objects[i].type) {
+        case SHAD2D_CIRCLE:
+            shade2d_draw_circle(window, objects.objects[i].obj.circle);
+            break;
+        case SHAD2D_RECTANGLE:
+            shade2d_draw_rectangle(window, objects.objects[i].obj.rect);
+            break;
+        case SHAD2D_BOX:
+            shade2d_draw_box(window, objects.objects[i].obj.box);
+            break;
+        case SHAD2D_POLYGON:
+            shade2d_draw_polygon(window, objects.objects[i].obj.polygon);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void shade2d_destroy_object_list(ObjectList2D objects) {
+    if (!shade2d_is_mapped(&objects, objects.objects)) free(objects.objects);  // Free the allocated array
+    if (!shade2d_is_mapped(&objects, objects.ids)) free(objects.ids);
+    if (!shade2d_is_mapped(&objects, objects.materials)) free(objects.materials);
+    if (!shade2d_is_mapped(&objects, objects.categories)) free(objects.categories);
+    if (!shade2d_is_mapped(&objects, objects.masks)) free(objects.masks);
+    shade2d_clear_object_list_grid(&objects);
+    if (objects.mapping) {
+        munmap(objects.mapping, objects.mapping_size);
+    }
+}
+
+ObjectID shade2d_create_object_id() {
+    static ObjectID next_id = 0;  // Static to maintain state
+    return next_id++;
+}
+
+ObjectID shade2d_get_object_id(ObjectList2D objects, size_t index) {
+    if (index < objects.size) {
+        return objects.ids[index];
+    }
+    return (ObjectID)-1;
+}
+
+void shade2d_set_object_material(ObjectList2D *objects, size_t index, float restitution, float friction) {
+    if (index < objects->size) {
+        objects->materials[index].restitution = restitution;
+        objects->materials[index].friction = friction;
+    }
+}
+
+void shade2d_set_object_collision_filter(ObjectList2D *objects, size_t index, uint32_t category, uint32_t mask) {
+    if (index < objects->size) {
+        objects->categories[index] = category;
+        objects->masks[index] = mask;
+    }
+}
+
+// Spatial Grid
+
+void shade2d_clear_object_list_grid(ObjectList2D *objects) {
+    if (objects->grid) {
+        if (!shade2d_is_mapped(objects, objects->grid->cell_start)) free(objects->grid->cell_start);
+        if (!shade2d_is_mapped(objects, objects->grid->items)) free(objects->grid->items);
+        free(objects->grid);
+        objects->grid = NULL;
+    }
+}
+
+void shade2d_build_object_list_grid(ObjectList2D *objects, float cell_size) {
+    if (!objects->grid) {
+        objects->grid = calloc(1, sizeof(SpatialGrid2D));
+    }
+    SpatialGrid2D *grid = objects->grid;
+    size_t n = objects->size;
+    grid->object_count = n;
+    if (shade2d_is_mapped(objects, grid->cell_start)) grid->cell_start = NULL;  // Rebuilt on the heap
+    if (shade2d_is_mapped(objects, grid->items)) grid->items = NULL;
+
+    float *bounds = malloc((4 * n + 1) * sizeof(float));
+    float minx = FLT_MAX, miny = FLT_MAX, maxx = -FLT_MAX, maxy = -FLT_MAX;
+    double extent = 0;
+    size_t counted = 0;
+    for (size_t i = 0; i < n; i++) {
+        float *b = &bounds[i * 4];
+        if ((unsigned)objects->objects[i].type < SHAD2D_SHAPE_COUNT) {
+            shade2d_object_bounds(&objects->objects[i], &b[0], &b[1], &b[2], &b[3]);
+        }
+        // NaN or infinite coordinates would wreck the cell size, and no query can hit them anyway
+        if ((unsigned)objects->objects[i].type >= SHAD2D_SHAPE_COUNT ||
+            !isfinite(b[0]) || !isfinite(b[1]) || !isfinite(b[2]) || !isfinite(b[3])) {
+            b[0] = 1;  // Empty bounds, never inserted
+            b[2] = 0;
+            continue;
+        }
+        counted++;
+        minx = fminf(minx, b[0]);
+        miny = fminf(miny, b[1]);
+        maxx = fmaxf(maxx, b[2]);
+        maxy = fmaxf(maxy, b[3]);
+        extent += fmax((double)b[2] - b[0], (double)b[3] - b[1]);
+    }
+    if (counted == 0) {
+        minx = miny = 0;
+        maxx = maxy = 1;
+    }
+
+    // Cells about twice the average object size keep most objects in one to four cells.
+    // Spans are in double, two finite floats can still be more than FLT_MAX apart.
+    double size = cell_size;
+    if (!(size > 0) || !isfinite(size)) {
+        size = (counted > 0 && extent > 0) ? 2.0 * extent / counted : 64.0;
+    }
+    double spanx = (double)maxx - minx;
+    double spany = (double)maxy - miny;
+    const double max_cells = 1 << 22;
+    while (ceil(spanx / size) * ceil(spany / size) > max_cells) {
+        size *= 2.0;
+    }
+    cell_size = (float)size;
+
+    grid->cell_size = cell_size;
+    grid->origin_x = minx;
+    grid->origin_y = miny;
+    grid->columns = (int)ceil(spanx / size);
+    grid->rows = (int)ceil(spany / size);
+    if (grid->columns < 1) grid->columns = 1;
+    if (grid->rows < 1) grid->rows = 1;
+    size_t cells = (size_t)grid->columns * grid->rows;
+
+    grid->cell_start = realloc(grid->cell_start, (cells + 1) * sizeof(size_t));
+    memset(grid->cell_start, 0, (cells + 1) * sizeof(size_t));
+
+    // Count, prefix sum, then fill: items end up grouped by cell with no per-cell allocations
+    for (int pass = 0; pass < 2; pass++) {
+        for (size_t i = 0; i < n; i++) {
+            const float *b = &bounds[i * 4];
+            if (b[0] > b[2]) continue;
+            int x0 = (int)(((double)b[0] - minx) / size), y0 = (int)(((double)b[1] - miny) / size);
+            int x1 = (int)(((double)b[2] - minx) / size), y1 = (int)(((double)b[3] - miny) / size);
+            if (x1 >= grid->columns) x1 = grid->columns - 1;
+            if (y1 >= grid->rows) y1 = grid->rows - 1;
+            for (int y = y0; y <= y1; y++) {
+                for (int x = x0; x <= x1; x++) {
+                    size_t cell = (size_t)y * grid->columns + x;
+                    if (pass == 0) {
+                        grid->cell_start[cell + 1]++;
+                    } else {
+                        grid->items[grid->cell_start[cell]++] = i;
+                    }
+                }
+            }
+        }
+        if (pass == 0) {
+            for (size_t c = 0; c < cells; c++) {
+                grid->cell_start[c + 1] += grid->cell_start[c];
+            }
+            grid->item_count = grid->cell_start[cells];
+            grid->items = realloc(grid->items, (grid->item_count + 1) * sizeof(size_t));
+        }
+    }
+    // The fill pass advanced each start to the next cell's start, shift back
+    memmove(grid->cell_start + 1, grid->cell_start, cells * sizeof(size_t));
+    grid->cell_start[0] = 0;
+
+    free(bounds);
+}
+
+// Snapshots
+//
+// The file is the list's arrays as they sit in memory, behind a fixed header,
+// with every array starting on a 64-byte boundary. Loading maps the file
+// copy-on-write and points the list at it, so a million objects load in the
+// time it takes to fault their pages in and can still be simulated in place.
+// The layout is native: a file only loads on a build with the same Object2D
+// layout, size_t width and byte order. Shape types, polygon vertex counts and the
+// grid's offsets and indices are checked on load, so a corrupt or half-written
+// file is rejected instead of being indexed out of bounds.
+
+#define SHAD2D_SNAPSHOT_ALIGN 64
+
+typedef struct {
+    char magic[8];  // "SHD2SNAP"
+    uint32_t version;
+    uint32_t byte_order;  // 0x01020304 as written by the saving machine
+    uint32_t object_size;
+    uint32_t index_size;  // sizeof(size_t), the grid's index type
+    uint64_t file_size;
+    uint64_t count;
+    uint64_t objects_offset;
+    uint64_t ids_offset;
+    uint64_t materials_offset;
+    uint64_t categories_offset;
+    uint64_t masks_offset;
+    // Grid, offsets are zero when the list had none
+    uint64_t cell_start_offset;
+    uint64_t items_offset;
+    uint64_t item_count;
+    uint64_t grid_object_count;
+    int32_t columns, rows;
+    float cell_size;
+    float origin_x, origin_y;
+    uint32_t reserved;
+} Shade2DSnapshotHeader;
+
+static uint64_t shade2d_snapshot_align(uint64_t offset) {
+    return (offset + SHAD2D_SNAPSHOT_ALIGN - 1) & ~(uint64_t)(SHAD2D_SNAPSHOT_ALIGN - 1);
+}
+
+// Writes one array at its aligned offset, padding from the current position
+static bool shade2d_snapshot_write(FILE *file, uint64_t *position, uint64_t offset, const void *data, size_t bytes) {
+    static const char zeros[SHAD2D_SNAPSHOT_ALIGN] = {0};
+    if (offset > *position && fwrite(zeros, 1, offset - *position, file) != offset - *position) return false;
+    if (bytes && fwrite(data, 1, bytes, file) != bytes) return false;
+    *position = offset + bytes;
+    return true;
+}
+
+bool shade2d_save_object_list(ObjectList2D objects, const char *path) {
+    Shade2DSnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "SHD2SNAP", 8);
+    header.version = SHAD2D_SNAPSHOT_VERSION;
+    header.byte_order = 0x01020304;
+    header.object_size = sizeof(Object2D);
+    header.index_size = sizeof(size_t);
+    header.count = objects.size;
+
+    uint64_t end = sizeof(header);
+    header.objects_offset = shade2d_snapshot_align(end);
+    end = header.objects_offset + objects.size * sizeof(Object2D);
+    header.ids_offset = shade2d_snapshot_align(end);
+    end = header.ids_offset + objects.size * sizeof(ObjectID);
+    header.materials_offset = shade2d_snapshot_align(end);
+    end = header.materials_offset + objects.size * sizeof(Material2D);
+    header.categories_offset = shade2d_snapshot_align(end);
+    end = header.categories_offset + objects.size * sizeof(uint32_t);
+    header.masks_offset = shade2d_snapshot_align(end);
+    end = header.masks_offset + objects.size * sizeof(uint32_t);
+
+    const SpatialGrid2D *grid = objects.grid;
+    size_t cells = 0;
+    if (grid) {
+        cells = (size_t)grid->columns * grid->rows;
+        header.columns = grid->columns;
+        header.rows = grid->rows;
+        header.cell_size = grid->cell_size;
+        header.origin_x = grid->origin_x;
+        header.origin_y = grid->origin_y;
+        header.item_count = grid->item_count;
+        header.grid_object_count = grid->object_count;
+        header.cell_start_offset = shade2d_snapshot_align(end);
+        end = header.cell_start_offset + (cells + 1) * sizeof(size_t);
+        header.items_offset = shade2d_snapshot_align(end);
+        end = header.items_offset + grid->item_count * sizeof(size_t);
+    }
+    header.file_size = end;
+
+    // Write beside the target and rename, so lists still mapping the old file keep working
+    char temp_path[4096];
+    if (snprintf(temp_path, sizeof(temp_path), "%s.tmp", path) >= (int)sizeof(temp_path)) return false;
+    FILE *file = fopen(temp_path, "wb");
+    if (!file) return false;
+
+    uint64_t position = 0;
+    bool ok = shade2d_snapshot_write(file, &position, 0, &header, sizeof(header)) &&
+              shade2d_snapshot_write(file, &position, header.objects_offset, objects.objects, objects.size * sizeof(Object2D)) &&
+              shade2d_snapshot_write(file, &position, header.ids_offset, objects.ids, objects.size * sizeof(ObjectID)) &&
+              shade2d_snapshot_write(file, &position, header.materials_offset, objects.materials, objects.size * sizeof(Material2D)) &&
+              shade2d_snapshot_write(file, &position, header.categories_offset, objects.categories, objects.size * sizeof(uint32_t)) &&
+              shade2d_snapshot_write(file, &position, header.masks_offset, objects.masks, objects.size * sizeof(uint32_t));
+    if (ok && grid) {
+        ok = shade2d_snapshot_write(file, &position, header.cell_start_offset, grid->cell_start, (cells + 1) * sizeof(size_t)) &&
+             shade2d_snapshot_write(file, &position, header.items_offset, grid->items, grid->item_count * sizeof(size_t));
+    }
+    ok = (fclose(file) == 0) && ok;
+    if (!ok || rename(temp_path, path) != 0) {
+        remove(temp_path);
+        return false;
+    }
+    return true;
+}
+
+// An array must start aligned and end inside the file
+static bool shade2d_snapshot_range(const Shade2DSnapshotHeader *header, uint64_t offset, uint64_t count, size_t element_size) {
+    if (offset % SHAD2D_SNAPSHOT_ALIGN != 0 || offset < sizeof(*header) || offset > header->file_size) return false;
+    return count <= (header->file_size - offset) / element_size;
+}
+
+// A truncated or corrupt file can pass the header checks, so check everything later code indexes with
+static bool shade2d_snapshot_contents_valid(const Shade2DSnapshotHeader *header, const char *base, size_t cells) {
+    const Object2D *list = (const Object2D *)(base + header->objects_offset);
+    for (uint64_t i = 0; i < header->count; i++) {
+        if ((unsigned)list[i].type >= SHAD2D_SHAPE_COUNT) return false;
+        if (list[i].type == SHAD2D_POLYGON &&
+            (list[i].obj.polygon.vertex_count < 0 || list[i].obj.polygon.vertex_count > SHAD2D_MAX_POLYGON_VERTICES)) {
+            return false;
+        }
+    }
+    if (header->cell_start_offset == 0) return true;
+
+    if (!(header->cell_size > 0) || !isfinite(header->cell_size)) return false;
+    const size_t *cell_start = (const size_t *)(base + header->cell_start_offset);
+    if (cell_start[0] != 0 || cell_start[cells] != header->item_count) return false;
+    for (size_t c = 0; c < cells; c++) {
+        if (cell_start[c] > cell_start[c + 1]) return false;
+    }
+    const size_t *items = (const size_t *)(base + header->items_offset);
+    for (uint64_t k = 0; k < header->item_count; k++) {
+        if (items[k] >= header->grid_object_count) return false;
+    }
+    return true;
+}
+
+bool shade2d_load_object_list(ObjectList2D *objects, const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(Shade2DSnapshotHeader)) {
+        close(fd);
+        return false;
+    }
+    size_t size = (size_t)info.st_size;
+    // Private and writable: objects can be simulated in place without touching the file
+    void *mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) return false;
+
+    const Shade2DSnapshotHeader *header = mapping;
+    bool valid = memcmp(header->magic, "SHD2SNAP", 8) == 0 &&
+                 header->version == SHAD2D_SNAPSHOT_VERSION &&
+                 header->byte_order == 0x01020304 &&
+                 header->object_size == sizeof(Object2D) &&
+                 header->index_size == sizeof(size_t) &&
+                 header->file_size == size &&
+                 shade2d_snapshot_range(header, header->objects_offset, header->count, sizeof(Object2D)) &&
+                 shade2d_snapshot_range(header, header->ids_offset, header->count, sizeof(ObjectID)) &&
+                 shade2d_snapshot_range(header, header->materials_offset, header->count, sizeof(Material2D)) &&
+                 shade2d_snapshot_range(header, header->categories_offset, header->count, sizeof(uint32_t)) &&
+                 shade2d_snapshot_range(header, header->masks_offset, header->count, sizeof(uint32_t));
+    bool has_grid = header->cell_start_offset != 0;
+    size_t cells = 0;
+    if (valid && has_grid) {
+        cells = (size_t)header->columns * header->rows;
+        valid = header->columns > 0 && header->rows > 0 &&
+                header->grid_object_count <= header->count &&
+                shade2d_snapshot_range(header, header->cell_start_offset, cells + 1, sizeof(size_t)) &&
+                shade2d_snapshot_range(header, header->items_offset, header->item_count, sizeof(size_t));
+    }
+    valid = valid && shade2d_snapshot_contents_valid(header, mapping, cells);
+    SpatialGrid2D *grid = NULL;
+    if (valid && has_grid) {
+        grid = calloc(1, sizeof(SpatialGrid2D));
+        valid = grid != NULL;
+    }
+    if (!valid) {
+        munmap(mapping, size);
+        return false;
+    }
+
+    char *base = mapping;
+    objects->objects = (Object2D *)(base + header->objects_offset);
+    objects->ids = (ObjectID *)(base + header->ids_offset);
+    objects->materials = (Material2D *)(base + header->materials_offset);
+    objects->categories = (uint32_t *)(base + header->categories_offset);
+    objects->masks = (uint32_t *)(base + header->masks_offset);
+    objects->size = header->count;
+    objects->capacity = header->count;  // Growing copies the arrays to the heap
+    objects->grid = grid;
+    objects->mapping = mapping;
+    objects->mapping_size = size;
+    if (grid) {
+        grid->cell_size = header->cell_size;
+        grid->origin_x = header->origin_x;
+        grid->origin_y = header->origin_y;
+        grid->columns = header->columns;
+        grid->rows = header->rows;
+        grid->cell_start = (size_t *)(base + header->cell_start_offset);
+        grid->items = (size_t *)(base + header->items_offset);
+        grid->item_count = header->item_count;
+        grid->object_count = header->grid_object_count;
+    }
+    return true;
+}
+
+// Ray and Shape Queries
+//
+// Rays that start inside an object don't report it, so an agent can cast from
+// its own center. A nonzero radius sweeps a circle, which is the same as
+// casting a ray against the object grown by that radius.
+
+Ray2D shade2d_ray(float x, float y, float dx, float dy, float length) {
+    return shade2d_circle_cast(x, y, dx, dy, length, 0.0f);
+}
+
+Ray2D shade2d_segment(float x1, float y1, float x2, float y2) {
+    float dx = x2 - x1;
+    float dy = y2 - y1;
+    return shade2d_circle_cast(x1, y1, dx, dy, sqrtf(dx * dx + dy * dy), 0.0f);
+}
+
+Ray2D shade2d_circle_cast(float x, float y, float dx, float dy, float length, float radius) {
+    Ray2D ray;
+    float len = sqrtf(dx * dx + dy * dy);
+    ray.x = x;
+    ray.y = y;
+    ray.dx = (len > 0) ? dx / len : 1.0f;
+    ray.dy = (len > 0) ? dy / len : 0.0f;
+    ray.length = length;
+    ray.radius = radius;
+    ray.ignore = 0;
+    return ray;
+}
+
+// Distance along the ray to a circle of radius r around (cx, cy), -1 for a miss or a start inside
+static float shade2d_ray_circle_distance(const Ray2D *ray, float cx, float cy, float r) {
+    float mx = ray->x - cx;
+    float my = ray->y - cy;
+    float b = mx * ray->dx + my * ray->dy;
+    float c = mx * mx + my * my - r * r;
+    if (c <= 0 || b > 0) return -1.0f;
+    float disc = b * b - c;
+    if (disc < 0) return -1.0f;
+    return -b - sqrtf(disc);
+}
+
+typedef bool (*Shade2DRayFn)(const Object2D *obj, const Ray2D *ray, float max_distance, RayHit2D *hit);
+
+static bool shade2d_ray_circle(const Object2D *obj, const Ray2D *ray, float max_distance, RayHit2D *hit) {
+    const Circle2D *c = &obj->obj.circle;
+    float r = c->radius + ray->radius;
+    float t = shade2d_ray_circle_distance(ray, c->x, c->y, r);
+    if (t < 0 || t > max_distance) return false;
+    hit->distance = t;
+    hit->normal_x = (ray->x + ray->dx * t - c->x) / r;
+    hit->normal_y = (ray->y + ray->dy * t - c->y) / r;
+    hit->x = c->x + hit->normal_x * c->radius;
+    hit->y = c->y + hit->normal_y * c->radius;
+    return true;
+}
+
+static bool shade2d_ray_hull_shape(const Shade2DHull *h, const Ray2D *ray, float max_distance, RayHit2D *hit) {
+    float r = ray->radius;
+    if (r > 0) {
+        // Starting inside the grown shape counts as inside
+        Circle2D probe = { ray->x, ray->y, 0, 0, 0, r };
+        Manifold2D m;
+        if (shade2d_collide_hull_circle(h, &probe, &m)) return false;
+    }
+
+    float best = max_distance;
+    bool found = false;
+    for (int i = 0; i < h->count; i++) {
+        float nx = h->nx[i];
+        float ny = h->ny[i];
+        float denom = nx * ray->dx + ny * ray->dy;
+        if (denom >= 0) continue;  // Only faces the ray moves towards
+
+        // Face pushed out by the radius
+        int j = (i + 1 == h->count) ? 0 : i + 1;
+        float px = h->x[i] + nx * r, py = h->y[i] + ny * r;
+        float ex = h->x[j] - h->x[i], ey = h->y[j] - h->y[i];
+        float t = (nx * (px - ray->x) + ny * (py - ray->y)) / denom;
+        if (t < 0 || t > best) continue;
+
+        float u = ((ray->x + ray->dx * t - px) * ex + (ray->y + ray->dy * t - py) * ey) / (ex * ex + ey * ey);
+        if (u < 0 || u > 1) continue;
+        best = t;
+        found = true;
+        hit->normal_x = nx;
+        hit->normal_y = ny;
+        hit->x = ray->x + ray->dx * t - nx * r;
+        hit->y = ray->y + ray->dy * t - ny * r;
+    }
+
+    // Rounded corners of the grown shape
+    if (r > 0) {
+        for (int i = 0; i < h->count; i++) {
+            float t = shade2d_ray_circle_distance(ray, h->x[i], h->y[i], r);
+            if (t < 0 || t > best) continue;
+            best = t;
+            found = true;
+            hit->normal_x = (ray->x + ray->dx * t - h->x[i]) / r;
+            hit->normal_y = (ray->y + ray->dy * t - h->y[i]) / r;
+            hit->x = h->x[i];
+            hit->y = h->y[i];
+        }
+    }
+
+    if (found) hit->distance = best;
+    return found;
+}
+
+static bool shade2d_ray_hull(const Object2D *obj, const Ray2D *ray, float max_distance, RayHit2D *hit) {
+    Shade2DHull h;
+    shade2d_hull_of(obj, &h);
+    return shade2d_ray_hull_shape(&h, ray, max_distance, hit);
+}
+
+static bool shade2d_ray_rect(const Object2D *obj, const Ray2D *ray, float max_distance, RayHit2D *hit) {
+    if (ray->radius > 0) return shade2d_ray_hull(obj, ray, max_distance, hit);
+
+    // Slab test
+    const Rectangle2D *rect = &obj->obj.rect;
+    float tmin = -FLT_MAX, tmax = FLT_MAX;
+    float nx = 0, ny = 0;
+    if (ray->dx != 0) {
+        float t1 = (rect->x - ray->x) / ray->dx;
+        float t2 = (rect->x + rect->width - ray->x) / ray->dx;
+        float sign = -1.0f;
+        if (t1 > t2) { float t = t1; t1 = t2; t2 = t; sign = 1.0f; }
+        tmin = t1;
+        tmax = t2;
+        nx = sign;
+    } else if (ray->x < rect->x || ray->x > rect->x + rect->width) {
+        return false;
+    }
+    if (ray->dy != 0) {
+        float t1 = (rect->y - ray->y) / ray->dy;
+        float t2 = (rect->y + rect->height - ray->y) / ray->dy;
+        float sign = -1.0f;
+        if (t1 > t2) { float t = t1; t1 = t2; t2 = t; sign = 1.0f; }
+        if (t1 > tmin) {
+            tmin = t1;
+            nx = 0;
+            ny = sign;
+        }
+        tmax = fminf(tmax, t2);
+    } else if (ray->y < rect->y || ray->y > rect->y + rect->height) {
+        return false;
+    }
+    if (tmin > tmax || tmin < 0 || tmin > max_distance) return false;
+
+    hit->distance = tmin;
+    hit->x = ray->x + ray->dx * tmin;
+    hit->y = ray->y + ray->dy * tmin;
+    hit->normal_x = nx;
+    hit->normal_y = ny;
+    return true;
+}
+
+static const Shade2DRayFn shade2d_ray_table[SHAD2D_SHAPE_COUNT] = {
+    [SHAD2D_RECTANGLE] = shade2d_ray_rect,
+    [SHAD2D_CIRCLE] = shade2d_ray_circle,
+    [SHAD2D_BOX] = shade2d_ray_hull,
+    [SHAD2D_POLYGON] = shade2d_ray_hull,
+};
+
+typedef enum {
+    SHAD2D_RAY_QUERY_FIRST,
+    SHAD2D_RAY_QUERY_ANY,
+    SHAD2D_RAY_QUERY_ALL
+} Shade2DRayQueryMode;
+
+typedef struct {
+    Shade2DRayQueryMode mode;
+    bool found;
+    RayHit2D best;
+    RayHit2D *hits;        // SHAD2D_RAY_QUERY_ALL only
+    size_t max_hits;
+    size_t hit_count;
+    unsigned char *visited;  // SHAD2D_RAY_QUERY_ALL only, one flag per object
+} Shade2DRayQuery;
+
+// Tests one object, returns true when the query can stop early
+static bool shade2d_ray_visit(ObjectList2D objects, size_t index, const Ray2D *ray, Shade2DRayQuery *q) {
+    const Object2D *obj = &objects.objects[index];
+    if ((unsigned)obj->type >= SHAD2D_SHAPE_COUNT || !(objects.categories[index] & ~ray->ignore)) return false;
+    if (q->visited) {
+        if (q->visited[index]) return false;
+        q->visited[index] = 1;
+    }
+
+    float max_distance = (q->mode == SHAD2D_RAY_QUERY_FIRST && q->found) ? q->best.distance : ray->length;
+    RayHit2D hit;
+    if (!shade2d_ray_table[obj->type](obj, ray, max_distance, &hit)) return false;
+    hit.index = index;
+    hit.id = objects.ids[index];
+
+    switch (q->mode) {
+    case SHAD2D_RAY_QUERY_ANY:
+        q->found = true;
+        q->best = hit;
+        return true;
+    case SHAD2D_RAY_QUERY_FIRST:
+        q->found = true;
+        q->best = hit;
+        return false;
+    default:
+        q->found = true;
+        if (q->hit_count < q->max_hits) {
+            // Keep the written hits sorted by distance
+            size_t k = q->hit_count;
+            while (k > 0 && q->hits[k - 1].distance > hit.distance) {
+                q->hits[k] = q->hits[k - 1];
+                k--;
+            }
+            q->hits[k] = hit;
+        } else if (q->max_hits > 0 && hit.distance < q->hits[q->max_hits - 1].distance) {
+            size_t k = q->max_hits - 1;
+            while (k > 0 && q->hits[k - 1].distance > hit.distance) {
+                q->hits[k] = q->hits[k - 1];
+                k--;
+            }
+            q->hits[k] = hit;
+        }
+        q->hit_count++;
+        return false;
+    }
+}
+
+static void shade2d_ray_query(ObjectList2D objects, const Ray2D *ray, Shade2DRayQuery *q) {
+    const SpatialGrid2D *grid = objects.grid;
+    size_t indexed = grid ? grid->object_count : 0;
+    if (indexed > objects.size) indexed = objects.size;
+
+    // Objects added after the grid was built are checked directly
+    for (size_t i = indexed; i < objects.size; i++) {
+        if (shade2d_ray_visit(objects, i, ray, q)) return;
+    }
+    if (!grid || indexed == 0) return;
+
+    // Walk the cells under the ray (Amanatides & Woo). For swept circles also visit
+    // the cells within the radius on either side of the center line.
+    float cs = grid->cell_size;
+    int ring = (ray->radius > 0) ? (int)ceilf(ray->radius / cs) : 0;
+    float pad = ring * cs;
+    float minx = grid->origin_x - pad, maxx = grid->origin_x + grid->columns * cs + pad;
+    float miny = grid->origin_y - pad, maxy = grid->origin_y + grid->rows * cs + pad;
+
+    float t0 = 0, t1 = ray->length;
+    if (ray->dx != 0) {
+        float a = (minx - ray->x) / ray->dx, b = (maxx - ray->x) / ray->dx;
+        t0 = fmaxf(t0, fminf(a, b));
+        t1 = fminf(t1, fmaxf(a, b));
+    } else if (ray->x < minx || ray->x > maxx) {
+        return;
+    }
+    if (ray->dy != 0) {
+        float a = (miny - ray->y) / ray->dy, b = (maxy - ray->y) / ray->dy;
+        t0 = fmaxf(t0, fminf(a, b));
+        t1 = fminf(t1, fmaxf(a, b));
+    } else if (ray->y < miny || ray->y > maxy) {
+        return;
+    }
+    if (t0 > t1) return;
+
+    float sx = (ray->x + ray->dx * t0 - grid->origin_x) / cs;
+    float sy = (ray->y + ray->dy * t0 - grid->origin_y) / cs;
+    int cx = (int)floorf(sx);
+    int cy = (int)floorf(sy);
+    int stepx = (ray->dx > 0) ? 1 : -1;
+    int stepy = (ray->dy > 0) ? 1 : -1;
+    float deltax = (ray->dx != 0) ? fabsf(cs / ray->dx) : FLT_MAX;
+    float deltay = (ray->dy != 0) ? fabsf(cs / ray->dy) : FLT_MAX;
+    float nextx = (ray->dx != 0) ? t0 + ((ray->dx > 0 ? (cx + 1) - sx : sx - cx) * deltax) : FLT_MAX;
+    float nexty = (ray->dy != 0) ? t0 + ((ray->dy > 0 ? (cy + 1) - sy : sy - cy) * deltay) : FLT_MAX;
+    float t = t0;
+
+    while (t <= t1) {
+        // Cells further along than the best hit can't hold anything closer
+        if (q->mode == SHAD2D_RAY_QUERY_FIRST && q->found && t > q->best.distance) return;
+
+        int x0 = cx - ring < 0 ? 0 : cx - ring;
+        int x1 = cx + ring >= grid->columns ? grid->columns - 1 : cx + ring;
+        int y0 = cy - ring < 0 ? 0 : cy - ring;
+        int y1 = cy + ring >= grid->rows ? grid->rows - 1 : cy + ring;
+        for (int y = y0; y <= y1; y++) {
+            for (int x = x0; x <= x1; x++) {
+                size_t cell = (size_t)y * grid->columns + x;
+                for (size_t k = grid->cell_start[cell]; k < grid->cell_start[cell + 1]; k++) {
+                    if (shade2d_ray_visit(objects, grid->items[k], ray, q)) return;
+                }
+            }
+        }
+
+        if (nextx < nexty) {
+            t = nextx;
+            nextx += deltax;
+            cx += stepx;
+        } else {
+            t = nexty;
+            nexty += deltay;
+            cy += stepy;
+        }
+        if (cx < -ring || cx >= grid->columns + ring || cy < -ring || cy >= grid->rows + ring) return;
+    }
+}
+
+static Ray2D shade2d_ray_normalized(Ray2D ray) {
+    Ray2D normalized = shade2d_circle_cast(ray.x, ray.y, ray.dx, ray.dy, ray.length, ray.radius);
+    normalized.ignore = ray.ignore;
+    return normalized;
+}
+
+bool shade2d_raycast_object_list(ObjectList2D objects, Ray2D ray, RayHit2D *hit) {
+    Shade2DRayQuery q = { SHAD2D_RAY_QUERY_FIRST, false, {0}, NULL, 0, 0, NULL };
+    ray = shade2d_ray_normalized(ray);
+    shade2d_ray_query(objects, &ray, &q);
+    if (q.found && hit) *hit = q.best;
+    return q.found;
+}
+
+bool shade2d_raycast_any_object_list(ObjectList2D objects, Ray2D ray) {
+    Shade2DRayQuery q = { SHAD2D_RAY_QUERY_ANY, false, {0}, NULL, 0, 0, NULL };
+    ray = shade2d_ray_normalized(ray);
+    shade2d_ray_query(objects, &ray, &q);
+    return q.found;
+}
+
+size_t shade2d_raycast_all_object_list(ObjectList2D objects, Ray2D ray, RayHit2D *hits, size_t max_hits) {
+    Shade2DRayQuery q = { SHAD2D_RAY_QUERY_ALL, false, {0}, hits, hits ? max_hits : 0, 0, NULL };
+    // Objects can sit in several grid cells, only report each one once
+    if (objects.grid) q.visited = calloc(objects.size, 1);
+    ray = shade2d_ray_normalized(ray);
+    shade2d_ray_query(objects, &ray, &q);
+    free(q.visited);
+    return q.hit_count;
+}
+
+// Job pool for batch queries. Workers start on first use and park between
+// batches, so a frame's queries don't pay for thread creation. One batch runs at
+// a time; a call that finds the pool busy runs its tasks on the calling thread.
+#define SHAD2D_MAX_JOB_THREADS 64
+
+typedef void (*Shade2DJobFn)(void *context, size_t task);
+
+typedef struct {
+    pthread_mutex_t run_lock;  // Held for a whole batch
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t done;
+    pthread_t threads[SHAD2D_MAX_JOB_THREADS];
+    int thread_count;
+    Shade2DJobFn fn;
+    void *context;
+    size_t task_count;
+    size_t next_task;
+    size_t remaining;
+} Shade2DJobPool;
+
+static Shade2DJobPool shade2d_jobs = {
+    .run_lock = PTHREAD_MUTEX_INITIALIZER,
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .wake = PTHREAD_COND_INITIALIZER,
+    .done = PTHREAD_COND_INITIALIZER,
+};
+
+// Takes the next task of the current batch, the pool lock must be held
+static bool shade2d_jobs_take(size_t *task) {
+    if (shade2d_jobs.next_task >= shade2d_jobs.task_count) return false;
+    *task = shade2d_jobs.next_task++;
+    return true;
+}
+
+static void shade2d_jobs_finish(void) {
+    if (--shade2d_jobs.remaining == 0) pthread_cond_signal(&shade2d_jobs.done);
+}
+
+static void *shade2d_jobs_worker(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&shade2d_jobs.lock);
+    for (;;) {
+        size_t task;
+        while (!shade2d_jobs_take(&task)) {
+            pthread_cond_wait(&shade2d_jobs.wake, &shade2d_jobs.lock);
+        }
+        Shade2DJobFn fn = shade2d_jobs.fn;
+        void *context = shade2d_jobs.context;
+        pthread_mutex_unlock(&shade2d_jobs.lock);
+        fn(context, task);
+        pthread_mutex_lock(&shade2d_jobs.lock);
+        shade2d_jobs_finish();
+    }
+    return NULL;
+}
+
+// Runs fn for tasks 0..task_count-1 on up to threads threads, the caller included
+static void shade2d_jobs_run(Shade2DJobFn fn, void *context, size_t task_count, int threads) {
+    if (threads > SHAD2D_MAX_JOB_THREADS) threads = SHAD2D_MAX_JOB_THREADS;
+    if (threads <= 1 || task_count <= 1 || pthread_mutex_trylock(&shade2d_jobs.run_lock) != 0) {
+        for (size_t task = 0; task < task_count; task++) fn(context, task);
+        return;
+    }
+
+    pthread_mutex_lock(&shade2d_jobs.lock);
+    while (shade2d_jobs.thread_count < threads - 1) {
+        pthread_t *thread = &shade2d_jobs.threads[shade2d_jobs.thread_count];
+        if (pthread_create(thread, NULL, shade2d_jobs_worker, NULL) != 0) break;
+        pthread_detach(*thread);
+        shade2d_jobs.thread_count++;
+    }
+    shade2d_jobs.fn = fn;
+    shade2d_jobs.context = context;
+    shade2d_jobs.task_count = task_count;
+    shade2d_jobs.next_task = 0;
+    shade2d_jobs.remaining = task_count;
+    pthread_cond_broadcast(&shade2d_jobs.wake);
+
+    // Work alongside the pool, so a pool that failed to start still finishes
+    size_t task;
+    while (shade2d_jobs_take(&task)) {
+        pthread_mutex_unlock(&shade2d_jobs.lock);
+        fn(context, task);
+        pthread_mutex_lock(&shade2d_jobs.lock);
+        shade2d_jobs_finish();
+    }
+    while (shade2d_jobs.remaining > 0) {
+        pthread_cond_wait(&shade2d_jobs.done, &shade2d_jobs.lock);
+    }
+    shade2d_jobs.task_count = 0;
+    pthread_mutex_unlock(&shade2d_jobs.lock);
+    pthread_mutex_unlock(&shade2d_jobs.run_lock);
+}
+
+typedef struct {
+    ObjectList2D objects;
+    const Ray2D *rays;
+    size_t count;
+    size_t chunk;
+    RayQueryMode2D mode;
+    RayHit2D *hits;
+    bool *did_hit;
+    size_t *hit_counts;  // One per task, summed once the batch is done
+} Shade2DRayBatch;
+
+static void shade2d_raycast_batch_task(void *context, size_t task) {
+    Shade2DRayBatch *batch = context;
+    Shade2DRayQueryMode mode = (batch->mode == SHAD2D_RAY_ANY_HIT) ? SHAD2D_RAY_QUERY_ANY : SHAD2D_RAY_QUERY_FIRST;
+    size_t begin = task * batch->chunk;
+    size_t end = begin + batch->chunk < batch->count ? begin + batch->chunk : batch->count;
+    size_t hit_count = 0;
+    for (size_t i = begin; i < end; i++) {
+        Shade2DRayQuery q = { mode, false, {0}, NULL, 0, 0, NULL };
+        Ray2D ray = shade2d_ray_normalized(batch->rays[i]);
+        shade2d_ray_query(batch->objects, &ray, &q);
+        if (batch->did_hit) batch->did_hit[i] = q.found;
+        if (batch->hits) {
+            batch->hits[i] = q.best;
+            if (!q.found) batch->hits[i].index = (size_t)-1;
+        }
+        hit_count += q.found;
+    }
+    batch->hit_counts[task] = hit_count;
+}
+
+size_t shade2d_raycast_batch(ObjectList2D objects, const Ray2D *rays, size_t count, RayQueryMode2D mode,
+                             RayHit2D *hits, bool *did_hit, int threads) {
+    if (count == 0) return 0;
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int)cpus : 1;
+    }
+    // Not worth a thread for fewer than a few hundred rays
+    if ((size_t)threads > count / 256 + 1) threads = (int)(count / 256 + 1);
+
+    // A few chunks per thread, so a thread that drew cheap rays picks up more
+    size_t tasks = (size_t)threads * 4;
+    if (tasks > count) tasks = count;
+    Shade2DRayBatch batch = { objects, rays, count, (count + tasks - 1) / tasks, mode, hits, did_hit, NULL };
+    tasks = (count + batch.chunk - 1) / batch.chunk;
+    batch.hit_counts = calloc(tasks, sizeof(size_t));
+    shade2d_jobs_run(shade2d_raycast_batch_task, &batch, tasks, threads);
+
+    size_t total = 0;
+    for (size_t i = 0; i < tasks; i++) total += batch.hit_counts[i];
+    free(batch.hit_counts);
+    return total;
+}
+
+// Contact Solver
+//
+// Sequential impulses over the contacts found by the broad phase. Accumulated
+// impulses are cached by object pair ID and applied up front on the next solve
+// (warm starting), so resting stacks converge in a few iterations instead of
+// needing many substeps. Pairs are keyed lower ID first and points are matched
+// by clipping feature, so neither list order nor point order matters.
+
+typedef struct {
+    float rax, ray, rbx, rby;  // Contact point relative to each body
+    float normal_mass;
+    float tangent_mass;
+    float velocity_bias;       // Restitution and penetration correction target
+    float normal_impulse;
+    float tangent_impulse;
+    uint32_t feature;          // Low byte for the lower ID's object
+} Shade2DContactPoint;
+
+typedef struct {
+    Shade2DBody a, b;
+    ObjectID id1, id2;         // Lower ID first, not necessarily a then b
+    float nx, ny;
+    float friction;
+    float restitution;
+    int point_count;
+    Shade2DContactPoint points[2];
+} Shade2DContactConstraint;
+
+ContactSolver2D shade2d_create_contact_solver(int iterations) {
+    ContactSolver2D solver;
+    memset(&solver, 0, sizeof(solver));
+    solver.iterations = iterations > 0 ? iterations : 1;
+    solver.warm_starting = true;
+    solver.position_correction = 0.2f;
+    solver.allowed_penetration = 0.5f;  // Half a pixel
+    solver.restitution_threshold = 60.0f;  // About a pixel per frame at 60 Hz, so resting contacts never bounce
+    return solver;
+}
+
+void shade2d_set_contact_solver_iterations(ContactSolver2D *solver, int iterations) {
+    solver->iterations = iterations > 0 ? iterations : 1;
+}
+
+static size_t shade2d_contact_hash(ObjectID id1, ObjectID id2) {
+    size_t h = (size_t)id1 * 0x9E3779B1u;
+    h ^= (size_t)id2 + 0x7F4A7C15u + (h << 6) + (h >> 2);
+    return h;
+}
+
+static const ContactCacheEntry2D *shade2d_contact_cache_find(const ContactSolver2D *solver, ObjectID id1, ObjectID id2) {
+    if (solver->cache_capacity == 0) return NULL;
+    size_t mask = solver->cache_capacity - 1;
+    for (size_t i = shade2d_contact_hash(id1, id2) & mask;; i = (i + 1) & mask) {
+        const ContactCacheEntry2D *entry = &solver->cache[i];
+        if (!entry->occupied) return NULL;  // Empty slot ends the probe
+        if (entry->id1 == id1 && entry->id2 == id2) return entry;
+    }
+}
+
+// Contacts that aren't touching this solve simply don't make it into the new table
+static void shade2d_contact_cache_rebuild(ContactSolver2D *solver, const Shade2DContactConstraint *constraints, size_t count) {
+    size_t capacity = 16;
+    while (capacity < count * 2) capacity *= 2;
+    if (capacity > solver->next_cache_capacity) {
+        solver->next_cache = realloc(solver->next_cache, capacity * sizeof(ContactCacheEntry2D));
+        solver->next_cache_capacity = capacity;
+    }
+    capacity = solver->next_cache_capacity;
+    memset(solver->next_cache, 0, capacity * sizeof(ContactCacheEntry2D));
+
+    size_t mask = capacity - 1;
+    for (size_t k = 0; k < count; k++) {
+        const Shade2DContactConstraint *c = &constraints[k];
+        size_t i = shade2d_contact_hash(c->id1, c->id2) & mask;
+        while (solver->next_cache[i].occupied) i = (i + 1) & mask;
+        ContactCacheEntry2D *entry = &solver->next_cache[i];
+        entry->id1 = c->id1;
+        entry->id2 = c->id2;
+        entry->occupied = true;
+        entry->point_count = c->point_count;
+        for (int p = 0; p < c->point_count; p++) {
+            entry->feature[p] = c->points[p].feature;
+            entry->normal_impulse[p] = c->points[p].normal_impulse;
+            entry->tangent_impulse[p] = c->points[p].tangent_impulse;
+        }
+    }
+
+    // Swap so the table just built becomes the lookup table for the next solve
+    ContactCacheEntry2D *cache = solver->cache;
+    size_t cache_capacity = solver->cache_capacity;
+    solver->cache = solver->next_cache;
+    solver->cache_capacity = solver->next_cache_capacity;
+    solver->next_cache = cache;
+    solver->next_cache_capacity = cache_capacity;
+}
+
+static void shade2d_apply_contact_impulse(Shade2DContactConstraint *c, const Shade2DContactPoint *p, float jx, float jy) {
+    *c->a.velx -= jx * c->a.inv_mass;
+    *c->a.vely -= jy * c->a.inv_mass;
+    *c->b.velx += jx * c->b.inv_mass;
+    *c->b.vely += jy * c->b.inv_mass;
+    if (c->a.angvel) *c->a.angvel -= (p->rax * jy - p->ray * jx) * c->a.inv_inertia;
+    if (c->b.angvel) *c->b.angvel += (p->rbx * jy - p->rby * jx) * c->b.inv_inertia;
+}
+
+static void shade2d_contact_relative_velocity(const Shade2DContactConstraint *c, const Shade2DContactPoint *p, float *vx, float *vy) {
+    float wa = c->a.angvel ? *c->a.angvel : 0.0f;
+    float wb = c->b.angvel ? *c->b.angvel : 0.0f;
+    *vx = (*c->b.velx - wb * p->rby) - (*c->a.velx - wa * p->ray);
+    *vy = (*c->b.vely + wb * p->rbx) - (*c->a.vely + wa * p->rax);
+}
+
+static void shade2d_contact_constraint_init(ContactSolver2D *solver, Shade2DContactConstraint *c, ObjectList2D objects,
+                                            size_t a, size_t b, const Manifold2D *m, float inv_dt) {
+    c->a = shade2d_body_of(&objects.objects[a]);
+    c->b = shade2d_body_of(&objects.objects[b]);
+    bool swapped = objects.ids[a] > objects.ids[b];
+    c->id1 = swapped ? objects.ids[b] : objects.ids[a];
+    c->id2 = swapped ? objects.ids[a] : objects.ids[b];
+    c->nx = m->normal_x;
+    c->ny = m->normal_y;
+    c->friction = sqrtf(objects.materials[a].friction * objects.materials[b].friction);
+    c->restitution = fmaxf(objects.materials[a].restitution, objects.materials[b].restitution);
+    c->point_count = m->point_count;
+
+    const ContactCacheEntry2D *cached = solver->warm_starting ? shade2d_contact_cache_find(solver, c->id1, c->id2) : NULL;
+    float tx = -c->ny;
+    float ty = c->nx;
+
+    for (int i = 0; i < c->point_count; i++) {
+        Shade2DContactPoint *p = &c->points[i];
+        p->rax = m->points[i].x - *c->a.x;
+        p->ray = m->points[i].y - *c->a.y;
+        p->rbx = m->points[i].x - *c->b.x;
+        p->rby = m->points[i].y - *c->b.y;
+
+        float raCrossN = p->rax * c->ny - p->ray * c->nx;
+        float rbCrossN = p->rbx * c->ny - p->rby * c->nx;
+        float kNormal = c->a.inv_mass + c->b.inv_mass +
+                        raCrossN * raCrossN * c->a.inv_inertia + rbCrossN * rbCrossN * c->b.inv_inertia;
+        p->normal_mass = kNormal > 0 ? 1.0f / kNormal : 0.0f;
+
+        float raCrossT = p->rax * ty - p->ray * tx;
+        float rbCrossT = p->rbx * ty - p->rby * tx;
+        float kTangent = c->a.inv_mass + c->b.inv_mass +
+                         raCrossT * raCrossT * c->a.inv_inertia + rbCrossT * rbCrossT * c->b.inv_inertia;
+        p->tangent_mass = kTangent > 0 ? 1.0f / kTangent : 0.0f;
+
+        // Bounce target from the approach speed before any impulses, warm starting included, are applied
+        float vx, vy;
+        shade2d_contact_relative_velocity(c, p, &vx, &vy);
+        float velocityAlongNormal = vx * c->nx + vy * c->ny;
+        p->velocity_bias = 0;
+        if (velocityAlongNormal < -solver->restitution_threshold) {
+            p->velocity_bias = -c->restitution * velocityAlongNormal;
+        }
+        float penetration = m->points[i].depth - solver->allowed_penetration;
+        if (penetration > 0) {
+            p->velocity_bias = fmaxf(p->velocity_bias, solver->position_correction * inv_dt * penetration);
+        }
+
+        // Impulses are symmetric in a and b, so only the features need the ID order
+        p->feature = swapped ? shade2d_feature_swap(m->points[i].feature) : m->points[i].feature;
+        p->normal_impulse = 0.0f;
+        p->tangent_impulse = 0.0f;
+        for (int k = 0; cached && k < cached->point_count; k++) {
+            if (cached->feature[k] != p->feature) continue;
+            p->normal_impulse = cached->normal_impulse[k];
+            p->tangent_impulse = cached->tangent_impulse[k];
+            break;
+        }
+    }
+}
+
+// Runs once every constraint has its bounce target, or a neighbour's warm start would read as an approach speed
+static void shade2d_contact_constraint_warm_start(Shade2DContactConstraint *c) {
+    float tx = -c->ny;
+    float ty = c->nx;
+    for (int i = 0; i < c->point_count; i++) {
+        const Shade2DContactPoint *p = &c->points[i];
+        shade2d_apply_contact_impulse(c, p, p->normal_impulse * c->nx + p->tangent_impulse * tx,
+                                      p->normal_impulse * c->ny + p->tangent_impulse * ty);
+    }
+}
+
+static void shade2d_contact_constraint_solve(Shade2DContactConstraint *c) {
+    float tx = -c->ny;
+    float ty = c->nx;
+    for (int i = 0; i < c->point_count; i++) {
+        Shade2DContactPoint *p = &c->points[i];
+        float vx, vy;
+
+        // Friction, clamped to the cone of the current normal impulse
+        shade2d_contact_relative_velocity(c, p, &vx, &vy);
+        float lambda = -(vx * tx + vy * ty) * p->tangent_mass;
+        float maxFriction = c->friction * p->normal_impulse;
+        float oldTangent = p->tangent_impulse;
+        p->tangent_impulse = fmaxf(-maxFriction, fminf(oldTangent + lambda, maxFriction));
+        lambda = p->tangent_impulse - oldTangent;
+        shade2d_apply_contact_impulse(c, p, lambda * tx, lambda * ty);
+
+        // Normal, accumulated impulse may only push
+        shade2d_contact_relative_velocity(c, p, &vx, &vy);
+        lambda = -(vx * c->nx + vy * c->ny - p->velocity_bias) * p->normal_mass;
+        float oldNormal = p->normal_impulse;
+        p->normal_impulse = fmaxf(oldNormal + lambda, 0.0f);
+        lambda = p->normal_impulse - oldNormal;
+        shade2d_apply_contact_impulse(c, p, lambda * c->nx, lambda * c->ny);
+    }
+}
+
+void shade2d_solve_contacts(ContactSolver2D *solver, ObjectList2D objects, float dt) {
+    if (dt <= 0) return;
+    float inv_dt = 1.0f / dt;
+
+    if (!solver->broadphase) {
+        solver->broadphase = calloc(1, sizeof(Shade2DBroadphase));
+        if (!solver->broadphase) return;
+    }
+    Shade2DBroadphase *broadphase = solver->broadphase;
+    shade2d_broadphase_build(broadphase, objects, &solver->stats);
+
+    size_t pair_total = 0;
+    for (int bucket = 0; bucket < SHAD2D_PAIR_BUCKETS; bucket++) {
+        pair_total += broadphase->pair_count[bucket];
+    }
+    if (pair_total > solver->constraint_capacity) {
+        solver->constraints = realloc(solver->constraints, pair_total * sizeof(Shade2DContactConstraint));
+        solver->constraint_capacity = pair_total;
+    }
+    Shade2DContactConstraint *constraints = solver->constraints;
+
+    // Build one constraint per touching pair, bucket by bucket
+    size_t count = 0;
+    Manifold2D manifold;
+    for (int bucket = 0; bucket < SHAD2D_PAIR_BUCKETS; bucket++) {
+        const Shade2DPair *pairs = broadphase->pairs[bucket];
+        size_t pair_count = broadphase->pair_count[bucket];
+        if (pair_count == 0) continue;
+        const Shade2DCollider *collider = &shade2d_collider_table[bucket / SHAD2D_SHAPE_COUNT][bucket % SHAD2D_SHAPE_COUNT];
+        for (size_t k = 0; k < pair_count; k++) {
+            size_t a = pairs[k].a;
+            size_t b = pairs[k].b;
+            if (collider->swap) {
+                size_t t = a;
+                a = b;
+                b = t;
+            }
+            if (collider->fn(&objects.objects[a], &objects.objects[b], &manifold)) {
+                shade2d_contact_constraint_init(solver, &constraints[count++], objects, a, b, &manifold, inv_dt);
+            }
+        }
+    }
+
+    for (size_t k = 0; k < count; k++) {
+        shade2d_contact_constraint_warm_start(&constraints[k]);
+    }
+
+    for (int iteration = 0; iteration < solver->iterations; iteration++) {
+        for (size_t k = 0; k < count; k++) {
+            shade2d_contact_constraint_solve(&constraints[k]);
+        }
+    }
+
+    shade2d_contact_cache_rebuild(solver, constraints, count);
+}
+
+void shade2d_destroy_contact_solver(ContactSolver2D *solver) {
+    free(solver->cache);
+    free(solver->next_cache);
+    free(solver->constraints);
+    if (solver->broadphase) {
+        shade2d_broadphase_free(solver->broadphase);
+        free(solver->broadphase);
+    }
+    memset(solver, 0, sizeof(*solver));
+}
+
+// Tilemaps
+//
+// Tiles are stored as one byte each and drawn chunk by chunk. A chunk's tiles
+// are merged into as few rectangles as possible once, kept in a vertex buffer,
+// and drawn with one call until a tile in it changes. Collision looks up only
+// the cells an object's bounds cover, and ignores faces shared by two solid
+// tiles so objects slide across seams without catching.
+
+typedef struct {
+    float x, y, width, height;
+    unsigned char type;
+} Shade2DTileQuad;
+
+typedef struct {
+    float x, y;
+    unsigned char color[4];
+} Shade2DTileVertex;
+
+#define SHAD2D_TILE_CHUNK_QUADS (SHAD2D_TILEMAP_CHUNK_SIZE * SHAD2D_TILEMAP_CHUNK_SIZE)
+
+Tilemap2D* shade2d_create_tilemap(Window2D window, int columns, int rows, float tile_size) {
+    if (columns <= 0 || rows <= 0 || tile_size <= 0) return NULL;
+    Tilemap2D *map = calloc(1, sizeof(Tilemap2D));
+    if (!map) return NULL;
+    map->columns = columns;
+    map->rows = rows;
+    map->tile_size = tile_size;
+    map->uploads = window.handle != NULL;
+    map->chunk_columns = (columns + SHAD2D_TILEMAP_CHUNK_SIZE - 1) / SHAD2D_TILEMAP_CHUNK_SIZE;
+    map->chunk_rows = (rows + SHAD2D_TILEMAP_CHUNK_SIZE - 1) / SHAD2D_TILEMAP_CHUNK_SIZE;
+    map->tiles = calloc((size_t)columns * rows, 1);
+    map->chunks = calloc((size_t)map->chunk_columns * map->chunk_rows, sizeof(TileChunk2D));
+    if (!map->tiles || !map->chunks) {
+        free(map->tiles);
+        free(map->chunks);
+        free(map);
+        return NULL;
+    }
+    for (int t = 1; t < 256; t++) {
+        map->types[t].r = map->types[t].g = map->types[t].b = 255;
+        map->types[t].solid = true;
+    }
+    return map;
+}
+
+static void shade2d_dirty_tile_chunks(Tilemap2D *map) {
+    size_t chunks = (size_t)map->chunk_columns * map->chunk_rows;
+    for (size_t i = 0; i < chunks; i++) {
+        map->chunks[i].dirty = true;
+    }
+}
+
+void shade2d_set_tile_type(Tilemap2D* map, int type, unsigned char r, unsigned char g, unsigned char b, bool solid) {
+    if (!map || type <= 0 || type > 255) return;
+    map->types[type].r = r;
+    map->types[type].g = g;
+    map->types[type].b = b;
+    map->types[type].solid = solid;
+    shade2d_dirty_tile_chunks(map);  // Colors are baked into chunk geometry
+}
+
+void shade2d_set_tile(Tilemap2D* map, int column, int row, int type) {
+    if (!map || column < 0 || row < 0 || column >= map->columns || row >= map->rows || type < 0 || type > 255) return;
+    unsigned char *tile = &map->tiles[(size_t)row * map->columns + column];
+    if (*tile == type) return;
+    *tile = (unsigned char)type;
+    map->chunks[(row / SHAD2D_TILEMAP_CHUNK_SIZE) * map->chunk_columns + column / SHAD2D_TILEMAP_CHUNK_SIZE].dirty = true;
+}
+
+int shade2d_get_tile(const Tilemap2D* map, int column, int row) {
+    if (!map || column < 0 || row < 0 || column >= map->columns || row >= map->rows) return 0;
+    return map->tiles[(size_t)row * map->columns + column];
+}
+
+// Merges each row into runs of equal tiles, and stacks runs that match the row above
+static void shade2d_build_tile_chunk(Tilemap2D *map, int chunk_x, int chunk_y) {
+    TileChunk2D *chunk = &map->chunks[chunk_y * map->chunk_columns + chunk_x];
+    chunk->dirty = false;
+    chunk->quad_count = 0;
+    if (!chunk->quads) {
+        chunk->quads = malloc(SHAD2D_TILE_CHUNK_QUADS * sizeof(Shade2DTileQuad));
+        if (!chunk->quads) return;
+    }
+    Shade2DTileQuad *quads = chunk->quads;
+
+    int c0 = chunk_x * SHAD2D_TILEMAP_CHUNK_SIZE, r0 = chunk_y * SHAD2D_TILEMAP_CHUNK_SIZE;
+    int c1 = c0 + SHAD2D_TILEMAP_CHUNK_SIZE, r1 = r0 + SHAD2D_TILEMAP_CHUNK_SIZE;
+    if (c1 > map->columns) c1 = map->columns;
+    if (r1 > map->rows) r1 = map->rows;
+    float ts = map->tile_size;
+
+    int previous_row_start = 0, previous_row_end = 0;
+    for (int r = r0; r < r1; r++) {
+        int row_start = chunk->quad_count;
+        const unsigned char *tiles = &map->tiles[(size_t)r * map->columns];
+        for (int c = c0; c < c1;) {
+            unsigned char type = tiles[c];
+            int end = c + 1;
+            while (end < c1 && tiles[end] == type) end++;
+            if (type != 0) {
+                float x = map->origin_x + c * ts, width = (end - c) * ts;
+                bool merged = false;
+                for (int q = previous_row_start; q < previous_row_end; q++) {
+                    if (quads[q].type == type && quads[q].x == x && quads[q].width == width) {
+                        quads[q].height += ts;
+                        // Keep it findable as part of this row for the next one
+                        Shade2DTileQuad kept = quads[q];
+                        memmove(&quads[q], &quads[q + 1], (chunk->quad_count - q - 1) * sizeof(Shade2DTileQuad));
+                        quads[chunk->quad_count - 1] = kept;
+                        previous_row_end--;
+                        row_start--;
+                        merged = true;
+                        break;
+                    }
+                }
+                if (!merged) {
+                    Shade2DTileQuad *quad = &quads[chunk->quad_count++];
+                    quad->x = x;
+                    quad->y = map->origin_y + r * ts;
+                    quad->width = width;
+                    quad->height = ts;
+                    quad->type = type;
+                }
+            }
+            c = end;
+        }
+        previous_row_start = row_start;
+        previous_row_end = chunk->quad_count;
+    }
+
+    if (!map->uploads) return;
+    Shade2DTileVertex vertices[SHAD2D_TILE_CHUNK_QUADS * 4];
+    for (int q = 0; q < chunk->quad_count; q++) {
+        const Shade2DTileQuad *quad = &quads[q];
+        const TileType2D *type = &map->types[quad->type];
+        Shade2DTileVertex *v = &vertices[q * 4];
+        v[0].x = quad->x;                v[0].y = quad->y;
+        v[1].x = quad->x + quad->width;  v[1].y = quad->y;
+        v[2].x = quad->x + quad->width;  v[2].y = quad->y + quad->height;
+        v[3].x = quad->x;                v[3].y = quad->y + quad->height;
+        for (int k = 0; k < 4; k++) {
+            v[k].color[0] = type->r;
+            v[k].color[1] = type->g;
+            v[k].color[2] = type->b;
+            v[k].color[3] = 255;
+        }
+    }
+    if (!chunk->buffer) {
+        glGenBuffers(1, &chunk->buffer);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, chunk->buffer);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(chunk->quad_count * 4 * sizeof(Shade2DTileVertex)), vertices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void shade2d_draw_tilemap(Window2D window, Tilemap2D* map) {
+    if (!map) return;
+
+    // Positions are baked into chunk geometry too, so moving the map rebuilds it
+    if (map->origin_x != map->built_origin_x || map->origin_y != map->built_origin_y) {
+        shade2d_dirty_tile_chunks(map);
+        map->built_origin_x = map->origin_x;
+        map->built_origin_y = map->origin_y;
+    }
+
+    // Only chunks overlapping the window
+    float chunk_extent = map->tile_size * SHAD2D_TILEMAP_CHUNK_SIZE;
+    int cx0 = (int)floorf((0 - map->origin_x) / chunk_extent);
+    int cy0 = (int)floorf((0 - map->origin_y) / chunk_extent);
+    int cx1 = (int)floorf((window.width - map->origin_x) / chunk_extent);
+    int cy1 = (int)floorf((window.height - map->origin_y) / chunk_extent);
+    if (cx0 < 0) cx0 = 0;
+    if (cy0 < 0) cy0 = 0;
+    if (cx1 >= map->chunk_columns) cx1 = map->chunk_columns - 1;
+    if (cy1 >= map->chunk_rows) cy1 = map->chunk_rows - 1;
+    if (cx0 > cx1 || cy0 > cy1) return;
+
+    Window2DState *software = shade2d_software(window);
+    if (software) {
+        uint32_t color = software->color;
+        for (int cy = cy0; cy <= cy1; cy++) {
+            for (int cx = cx0; cx <= cx1; cx++) {
+                TileChunk2D *chunk = &map->chunks[cy * map->chunk_columns + cx];
+                if (chunk->dirty || !chunk->quads) shade2d_build_tile_chunk(map, cx, cy);
+                const Shade2DTileQuad *quads = chunk->quads;
+                for (int q = 0; q < chunk->quad_count; q++) {
+                    const TileType2D *type = &map->types[quads[q].type];
+                    software->color = shade2d_pack_rgba(type->r, type->g, type->b, 255);
+                    shade2d_soft_fill_rect(software, quads[q].x, quads[q].y, quads[q].width, quads[q].height);
+                }
+            }
+        }
+        software->color = color;
+        return;
+    }
+    if (!window.handle) return;
+
+    glPushAttrib(GL_ENABLE_BIT | GL_CURRENT_BIT);
+    glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+    glDisable(GL_TEXTURE_2D);
+    shade2d_setup_projection(window);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    for (int cy = cy0; cy <= cy1; cy++) {
+        for (int cx = cx0; cx <= cx1; cx++) {
+            TileChunk2D *chunk = &map->chunks[cy * map->chunk_columns + cx];
+            if (chunk->dirty || !chunk->quads) shade2d_build_tile_chunk(map, cx, cy);
+            if (chunk->quad_count == 0) continue;
+            glBindBuffer(GL_ARRAY_BUFFER, chunk->buffer);
+            glVertexPointer(2, GL_FLOAT, sizeof(Shade2DTileVertex), (const void *)offsetof(Shade2DTileVertex, x));
+            glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Shade2DTileVertex), (const void *)offsetof(Shade2DTileVertex, color));
+            glDrawArrays(GL_QUADS, 0, chunk->quad_count * 4);
+        }
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glPopClientAttrib();
+    glPopAttrib();
+}
+
+static bool shade2d_tile_solid(const Tilemap2D *map, int column, int row) {
+    if (column < 0 || row < 0 || column >= map->columns || row >= map->rows) return false;
+    return map->types[map->tiles[(size_t)row * map->columns + column]].solid;  // Type 0 is never solid
+}
 
-    // Calculate relative velocity
-    float relativeVelX = c2->velx - c1->velx;
-    float relativeVelY = c2->vely - c1->vely;
+// Cells overlapped by a box; edges that only touch a cell don't count. False if none are on the map.
+static bool shade2d_tile_range(const Tilemap2D *map, float minx, float miny, float maxx, float maxy,
+                               int *c0, int *r0, int *c1, int *r1) {
+    *c0 = (int)floorf((minx - map->origin_x) / map->tile_size);
+    *r0 = (int)floorf((miny - map->origin_y) / map->tile_size);
+    *c1 = (int)ceilf((maxx - map->origin_x) / map->tile_size) - 1;
+    *r1 = (int)ceilf((maxy - map->origin_y) / map->tile_size) - 1;
+    if (*c0 < 0) *c0 = 0;
+    if (*r0 < 0) *r0 = 0;
+    if (*c1 >= map->columns) *c1 = map->columns - 1;
+    if (*r1 >= map->rows) *r1 = map->rows - 1;
+    return *c0 <= *c1 && *r0 <= *r1;
+}
 
-    // Calculate velocity along the collision normal
-    float velocityAlongNormal = relativeVelX * normalX + relativeVelY * normalY;
+bool shade2d_overlap_tilemap(const Tilemap2D* map, const Object2D* object) {
+    if (!map || !object) return false;
+    int c0, r0, c1, r1;
+    if (object->type == SHAD2D_RECTANGLE) {
+        const Rectangle2D *rect = &object->obj.rect;
+        if (!shade2d_tile_range(map, rect->x, rect->y, rect->x + rect->width, rect->y + rect->height, &c0, &r0, &c1, &r1)) return false;
+        for (int r = r0; r <= r1; r++) {
+            for (int c = c0; c <= c1; c++) {
+                if (shade2d_tile_solid(map, c, r)) return true;
+            }
+        }
+    } else if (object->type == SHAD2D_CIRCLE) {
+        const Circle2D *circle = &object->obj.circle;
+        float radius = circle->radius;
+        if (!shade2d_tile_range(map, circle->x - radius, circle->y - radius, circle->x + radius, circle->y + radius, &c0, &r0, &c1, &r1)) return false;
+        for (int r = r0; r <= r1; r++) {
+            for (int c = c0; c <= c1; c++) {
+                if (!shade2d_tile_solid(map, c, r)) continue;
+                float x0 = map->origin_x + c * map->tile_size, y0 = map->origin_y + r * map->tile_size;
+                float dx = circle->x - fminf(fmaxf(circle->x, x0), x0 + map->tile_size);
+                float dy = circle->y - fminf(fmaxf(circle->y, y0), y0 + map->tile_size);
+                if (dx * dx + dy * dy < radius * radius) return true;
+            }
+        }
+    }
+    return false;
+}
 
-    // Do not resolve if velocities are separating
-    if (velocityAlongNormal > 0) return;
+// Picks the shallowest way out of a cell through a face not shared with another solid cell.
+// depths: push left, right, up, down.
+static int shade2d_tile_exit(const Tilemap2D *map, int column, int row, const float depths[4]) {
+    static const int neighbors[4][2] = { {-1, 0}, {1, 0}, {0, -1}, {0, 1} };
+    int best = -1, fallback = 0;
+    for (int k = 0; k < 4; k++) {
+        if (depths[k] < depths[fallback]) fallback = k;
+        if (shade2d_tile_solid(map, column + neighbors[k][0], row + neighbors[k][1])) continue;
+        if (best < 0 || depths[k] < depths[best]) best = k;
+    }
+    return best >= 0 ? best : fallback;
+}
 
-    // Calculate impulse scalar using elastic collision formula
-    float m1 = c1->mass;
-    float m2 = c2->mass;
-    float impulseScalar = -(1.0f + 1.0f) * velocityAlongNormal / (1.0f/m1 + 1.0f/m2);
+static void shade2d_tile_response(float *velx, float *vely, float nx, float ny, float restitution) {
+    float vn = *velx * nx + *vely * ny;
+    if (vn < 0) {
+        *velx -= (1.0f + restitution) * vn * nx;
+        *vely -= (1.0f + restitution) * vn * ny;
+    }
+}
 
-    // Apply impulse to velocities
-    c1->velx -= impulseScalar * normalX / m1;
-    c1->vely -= impulseScalar * normalY / m1;
-    c2->velx += impulseScalar * normalX / m2;
-    c2->vely += impulseScalar * normalY / m2;
+bool shade2d_collide_tilemap(const Tilemap2D* map, Object2D* object, float restitution) {
+    if (!map || !object) return false;
+    static const float normals[4][2] = { {-1, 0}, {1, 0}, {0, -1}, {0, 1} };
+    float ts = map->tile_size;
+    bool hit = false;
+    int c0, r0, c1, r1;
 
-    // Separation (push circles apart)
-    float overlap = (c1->radius + c2->radius) - distance;
-    if (overlap > 0) {
-        c1->x -= normalX * overlap / 2.0f;
-        c1->y -= normalY * overlap / 2.0f;
-        c2->x += normalX * overlap / 2.0f;
-        c2->y += normalY * overlap / 2.0f;
+    if (object->type == SHAD2D_RECTANGLE) {
+        Rectangle2D *rect = &object->obj.rect;
+        if (!shade2d_tile_range(map, rect->x, rect->y, rect->x + rect->width, rect->y + rect->height, &c0, &r0, &c1, &r1)) return false;
+        for (int r = r0; r <= r1; r++) {
+            for (int c = c0; c <= c1; c++) {
+                if (!shade2d_tile_solid(map, c, r)) continue;
+                float x0 = map->origin_x + c * ts, y0 = map->origin_y + r * ts;
+                float depths[4] = {
+                    rect->x + rect->width - x0,   // Out through the left face
+                    x0 + ts - rect->x,            // Right
+                    rect->y + rect->height - y0,  // Top
+                    y0 + ts - rect->y,            // Bottom
+                };
+                if (depths[0] <= 0 || depths[1] <= 0 || depths[2] <= 0 || depths[3] <= 0) continue;  // Already pushed clear
+                int k = shade2d_tile_exit(map, c, r, depths);
+                rect->x += normals[k][0] * depths[k];
+                rect->y += normals[k][1] * depths[k];
+                shade2d_tile_response(&rect->velx, &rect->vely, normals[k][0], normals[k][1], restitution);
+                hit = true;
+            }
+        }
+    } else if (object->type == SHAD2D_CIRCLE) {
+        Circle2D *circle = &object->obj.circle;
+        float radius = circle->radius;
+        if (!shade2d_tile_range(map, circle->x - radius, circle->y - radius, circle->x + radius, circle->y + radius, &c0, &r0, &c1, &r1)) return false;
+        for (int r = r0; r <= r1; r++) {
+            for (int c = c0; c <= c1; c++) {
+                if (!shade2d_tile_solid(map, c, r)) continue;
+                float x0 = map->origin_x + c * ts, y0 = map->origin_y + r * ts;
+                float dx = circle->x - fminf(fmaxf(circle->x, x0), x0 + ts);
+                float dy = circle->y - fminf(fmaxf(circle->y, y0), y0 + ts);
+                float nx, ny, depth;
+                if (dx == 0 && dy == 0) {
+                    // Center inside the cell, leave like a box would
+                    float depths[4] = {
+                        circle->x - x0 + radius, x0 + ts - circle->x + radius,
+                        circle->y - y0 + radius, y0 + ts - circle->y + radius,
+                    };
+                    int k = shade2d_tile_exit(map, c, r, depths);
+                    nx = normals[k][0];
+                    ny = normals[k][1];
+                    depth = depths[k];
+                } else {
+                    // A corner between two solid cells is really a flat face
+                    if (dx != 0 && shade2d_tile_solid(map, c + (dx > 0 ? 1 : -1), r)) dx = 0;
+                    if (dy != 0 && shade2d_tile_solid(map, c, r + (dy > 0 ? 1 : -1))) dy = 0;
+                    float distance = sqrtf(dx * dx + dy * dy);
+                    if (distance == 0 || distance >= radius) continue;
+                    nx = dx / distance;
+                    ny = dy / distance;
+                    depth = radius - distance;
+                }
+                circle->x += nx * depth;
+                circle->y += ny * depth;
+                shade2d_tile_response(&circle->velx, &circle->vely, nx, ny, restitution);
+                hit = true;
+            }
+        }
     }
+    return hit;
 }
 
-bool shade2d_check_collision(Object2D obj1, Object2D obj2) {
-    if (obj1.type == SHAD2D_RECTANGLE && obj2.type == SHAD2D_RECTANGLE) {
-        return shade2d_check_collision_rect_rect(obj1.obj.rect, obj2.obj.rect);
-    } else if (obj1.type == SHAD2D_RECTANGLE && obj2.type == SHAD2D_CIRCLE) {
-        return shade2d_check_collision_rect_circle(obj1.obj.rect, obj2.obj.circle);
-    } else if (obj1.type == SHAD2D_CIRCLE && obj2.type == SHAD2D_RECTANGLE) {
-        // Check the collision in reverse order
-        return shade2d_check_collision_rect_circle(obj2.obj.rect, obj1.obj.circle);
-    } else if (obj1.type == SHAD2D_CIRCLE && obj2.type == SHAD2D_CIRCLE) {
-        return shade2d_check_collision_circle_circle(obj1.obj.circle, obj2.obj.circle);
-    }
-    // TODO: Handle other combinations if needed
-    return false;
+void shade2d_destroy_tilemap(Tilemap2D* map) {
+    if (!map) return;
+    size_t chunks = (size_t)map->chunk_columns * map->chunk_rows;
+    for (size_t i = 0; i < chunks; i++) {
+        if (map->chunks[i].buffer) glDeleteBuffers(1, &map->chunks[i].buffer);
+        free(map->chunks[i].quads);
+    }
+    free(map->chunks);
+    free(map->tiles);
+    free(map);
 }
 
-// Implementation of ObjectList2D functions
+// Frame Budget Governor
+//
+// The governor compares the smoothed cost of the measured stages with the
+// budget. Above the high watermark it lowers one setting belonging to the most
+// expensive stage, then waits out a cooldown so the change can show up in the
+// averages. Only after a sustained stretch below the low watermark does it
+// undo its most recent degrade, restoring the exact value it replaced. The gap
+// between the watermarks and the wait before upgrading keep it from
+// oscillating.
 
-ObjectList2D shade2d_create_object_list() {
-    ObjectList2D list;
-    list.objects = malloc(10 * sizeof(Object2D));  // Initial capacity of 10
-    list.size = 0;
-    list.capacity = 10;
-    return list;
+#define SHAD2D_GOVERNOR_SMOOTHING 0.1f
+
+// Settings each stage can trade away, cheapest loss of quality first
+static const int shade2d_stage_knobs[SHAD2D_STAGE_COUNT][2] = {
+    [SHAD2D_STAGE_UPDATE] = { SHAD2D_QUALITY_PARTICLE_CAP, -1 },
+    [SHAD2D_STAGE_PHYSICS] = { SHAD2D_QUALITY_SUBSTEPS, SHAD2D_QUALITY_SOLVER_ITERATIONS },
+    [SHAD2D_STAGE_RENDER] = { SHAD2D_QUALITY_CIRCLE_SEGMENTS, SHAD2D_QUALITY_PARTICLE_CAP },
+};
+
+FrameGovernor2D shade2d_create_frame_governor(float budget_ms) {
+    FrameGovernor2D governor;
+    memset(&governor, 0, sizeof(governor));
+    governor.budget_ms = budget_ms > 0 ? budget_ms : 16.0f;
+    governor.high_watermark = 0.95f;
+    governor.low_watermark = 0.7f;
+    governor.cooldown_frames = 15;
+    governor.recovery_frames = 120;
+    governor.last_knob = -1;
+    governor.open_stage = -1;
+    governor.recovery_scale = 1;
+    shade2d_set_quality_bounds(&governor, SHAD2D_QUALITY_CIRCLE_SEGMENTS, 8, 32);
+    shade2d_set_quality_bounds(&governor, SHAD2D_QUALITY_PARTICLE_CAP, 1000, 10000);
+    shade2d_set_quality_bounds(&governor, SHAD2D_QUALITY_SOLVER_ITERATIONS, 2, 8);
+    shade2d_set_quality_bounds(&governor, SHAD2D_QUALITY_SUBSTEPS, 1, 4);
+    return governor;
 }
 
-void shade2d_add_object_to_list(ObjectList2D *objects, Object2D obj, ObjectID id) {
-    (void)id;  // Acknowledge unused parameter to suppress warning
-    if (objects->size >= objects->capacity) {
-        objects->capacity *= 2;
-        objects->objects = realloc(objects->objects, objects->capacity * sizeof(Object2D));
+void shade2d_set_quality_bounds(FrameGovernor2D* governor, QualityKnob2D knob, int min, int max) {
+    if ((unsigned)knob >= SHAD2D_QUALITY_COUNT) return;
+    if (max < min) max = min;
+    QualitySetting2D *setting = &governor->settings[knob];
+    setting->min = min;
+    setting->max = max;
+    setting->value = max;  // Start at full quality
+}
+
+int shade2d_get_quality(const FrameGovernor2D* governor, QualityKnob2D knob) {
+    if ((unsigned)knob >= SHAD2D_QUALITY_COUNT) return 0;
+    return governor->settings[knob].value;
+}
+
+void shade2d_begin_frame_stage(FrameGovernor2D* governor, FrameStage2D stage) {
+    if ((unsigned)stage >= SHAD2D_STAGE_COUNT) return;
+    shade2d_end_frame_stage(governor);
+    governor->open_stage = stage;
+    governor->stage_start = shade2d_now();
+}
+
+void shade2d_end_frame_stage(FrameGovernor2D* governor) {
+    if (governor->open_stage < 0) return;
+    governor->stage_accum[governor->open_stage] += (float)((shade2d_now() - governor->stage_start) * 1000.0);
+    governor->open_stage = -1;
+}
+
+// Steps are a quarter of the value, so large ranges move quickly and small ones by one
+static bool shade2d_step_quality(QualitySetting2D *setting, int direction) {
+    int step = setting->value / 4;
+    if (step < 1) step = 1;
+    int value = setting->value + direction * step;
+    if (value < setting->min) value = setting->min;
+    if (value > setting->max) value = setting->max;
+    if (value == setting->value) return false;
+    setting->value = value;
+    return true;
+}
+
+static bool shade2d_governor_degrade(FrameGovernor2D *governor) {
+    // Most expensive stage first, falling back to the others when its settings are exhausted
+    bool tried[SHAD2D_STAGE_COUNT] = { false };
+    for (int attempt = 0; attempt < SHAD2D_STAGE_COUNT; attempt++) {
+        int stage = -1;
+        for (int s = 0; s < SHAD2D_STAGE_COUNT; s++) {
+            if (!tried[s] && (stage < 0 || governor->stage_ms[s] > governor->stage_ms[stage])) stage = s;
+        }
+        tried[stage] = true;
+        for (int k = 0; k < 2; k++) {
+            int knob = shade2d_stage_knobs[stage][k];
+            if (knob < 0) continue;
+            int previous = governor->settings[knob].value;
+            if (!shade2d_step_quality(&governor->settings[knob], -1)) continue;
+            if (governor->history_count == SHAD2D_GOVERNOR_HISTORY) {
+                memmove(governor->history, governor->history + 1, (SHAD2D_GOVERNOR_HISTORY - 1) * sizeof(QualityChange2D));
+                governor->history_count--;
+            }
+            governor->history[governor->history_count++] = (QualityChange2D){ knob, previous };
+            governor->last_knob = knob;
+            governor->last_direction = -1;
+            governor->degrades++;
+            return true;
+        }
     }
-    objects->objects[objects->size] = obj;  // Store the object
-    objects->size++;
-    // In a full implementation, you might associate the ID here, e.g., in a separate array
+    return false;
 }
 
-size_t shade2d_get_object_list_size(ObjectList2D objects) {
-    return objects.size;
+static bool shade2d_governor_upgraded(FrameGovernor2D *governor, int knob) {
+    governor->last_knob = knob;
+    governor->last_direction = 1;
+    governor->upgrades++;
+    return true;
 }
 
-Object2D* shade2d_get_object_by_id(ObjectList2D objects, size_t index) {  // Treating index as ID for now
-    if (index < objects.size) {
-        return &objects.objects[index];
+static bool shade2d_governor_upgrade(FrameGovernor2D *governor) {
+    // Restore exactly the value each degrade replaced, latest first
+    while (governor->history_count > 0) {
+        QualityChange2D change = governor->history[--governor->history_count];
+        QualitySetting2D *setting = &governor->settings[change.knob];
+        int value = change.previous < setting->max ? change.previous : setting->max;
+        if (value > setting->value) {
+            setting->value = value;
+            return shade2d_governor_upgraded(governor, change.knob);
+        }
     }
-    return NULL;  // Or handle error
+    // Degrades that fell out of the history still climb back to full quality
+    for (int knob = 0; knob < SHAD2D_QUALITY_COUNT; knob++) {
+        if (shade2d_step_quality(&governor->settings[knob], 1)) return shade2d_governor_upgraded(governor, knob);
+    }
+    return false;
 }
 
-bool shade2d_check_collisions_object_list(ObjectList2D objects) {
-    for (size_t i = 0; i < objects.size; i++) {
-        for (size_t j = i + 1; j < objects.size; j++) {
-            if (shade2d_check_collision(objects.objects[i], objects.objects[j])) {
-                return true;  // Collision found
+void shade2d_end_governed_frame(FrameGovernor2D* governor) {
+    shade2d_end_frame_stage(governor);
+    governor->frame++;
+    governor->frame_ms = 0;
+    for (int s = 0; s < SHAD2D_STAGE_COUNT; s++) {
+        // The first frame seeds the average instead of easing in from zero
+        float alpha = governor->frame == 1 ? 1.0f : SHAD2D_GOVERNOR_SMOOTHING;
+        governor->stage_ms[s] += alpha * (governor->stage_accum[s] - governor->stage_ms[s]);
+        governor->stage_accum[s] = 0;
+        governor->frame_ms += governor->stage_ms[s];
+    }
+
+    if (governor->cooldown > 0) {
+        governor->cooldown--;
+        return;
+    }
+    if (governor->frame_ms > governor->budget_ms * governor->high_watermark) {
+        governor->calm_frames = 0;
+        if (shade2d_governor_degrade(governor)) {
+            governor->cooldown = governor->cooldown_frames;
+            // An upgrade that didn't stick means the load is still there, wait longer next time
+            size_t recovery = (size_t)governor->recovery_frames * governor->recovery_scale;
+            if (governor->upgrades > 0 && governor->frame - governor->last_upgrade_frame < recovery &&
+                governor->recovery_scale < 16) {
+                governor->recovery_scale *= 2;
             }
         }
+    } else if (governor->frame_ms < governor->budget_ms * governor->low_watermark) {
+        if (++governor->calm_frames >= governor->recovery_frames * governor->recovery_scale) {
+            governor->calm_frames = 0;
+            if (shade2d_governor_upgrade(governor)) {
+                governor->cooldown = governor->cooldown_frames;
+                governor->last_upgrade_frame = governor->frame;
+            } else {
+                governor->recovery_scale = 1;  // Back at full quality
+            }
+        }
+    } else {
+        governor->calm_frames = 0;  // In the band between the watermarks, hold
     }
-    return false;
 }
 
-void shade2d_handle_collisions_object_list(ObjectList2D objects) {
-    for (size_t i = 0; i < objects.size; i++) {
-        for (size_t j = i + 1; j < objects.size; j++) {
-            if (shade2d_check_collision(objects.objects[i], objects.objects[j])) {
-                // Handle based on types
-                if (objects.objects[i].type == SHAD2D_RECTANGLE && objects.objects[j].type == SHAD2D_RECTANGLE) {
-                    shade2d_handle_collision_rect_rect(&objects.objects[i].obj.rect, &objects.objects[j].obj.rect);
-                } else if (objects.objects[i].type == SHAD2D_RECTANGLE && objects.objects[j].type == SHAD2D_CIRCLE) {
-                    shade2d_handle_collision_rect_circle(&objects.objects[i].obj.rect, &objects.objects[j].obj.circle);
-                } else if (objects.objects[i].type == SHAD2D_CIRCLE && objects.objects[j].type == SHAD2D_RECTANGLE) {
-                    shade2d_handle_collision_rect_circle(&objects.objects[j].obj.rect, &objects.objects[i].obj.circle);
-                } else if (objects.objects[i].type == SHAD2D_CIRCLE && objects.objects[j].type == SHAD2D_CIRCLE) {
-                    shade2d_handle_collision_circle_circle(&objects.objects[i].obj.circle, &objects.objects[j].obj.circle);
+void shade2d_apply_frame_governor(const FrameGovernor2D* governor, Window2D window, ContactSolver2D* solver) {
+    shade2d_set_circle_segments(window, governor->settings[SHAD2D_QUALITY_CIRCLE_SEGMENTS].value);
+    if (solver) {
+        shade2d_set_contact_solver_iterations(solver, governor->settings[SHAD2D_QUALITY_SOLVER_ITERATIONS].value);
+    }
+}
+
+// Asset Loading
+//
+// Worker threads read and decode files off the context thread. Decoded images
+// wait in an upload queue that shade2d_pump_asset_loader drains on the context
+// thread, packing each into the atlas and uploading it, until the frame's time
+// budget is spent. Snapshots need no GPU work: the worker maps the file and
+// touches every page, so the first frame that uses it doesn't fault them in.
+
+typedef struct {
+    bool is_image;
+    AssetStatus2D status;
+    char *path;
+    Image2D image;
+    AtlasRegion2D region;
+    ObjectList2D objects;
+    bool taken;
+} Shade2DAsset;
+
+struct AssetLoader2D {
+    TextureAtlas2D *atlas;
+    pthread_t *threads;
+    int thread_count;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    bool stopping;
+
+    Shade2DAsset **assets;  // Indexed by handle; entries never move so workers can hold them
+    size_t asset_count, asset_capacity;
+    size_t *jobs;  // FIFO of handles waiting for a worker
+    size_t job_head, job_count, job_capacity;
+    size_t *uploads;  // FIFO of decoded images waiting for the context thread
+    size_t upload_head, upload_count, upload_capacity;
+};
+
+// Caller holds the lock
+static bool shade2d_asset_queue_push(size_t **queue, size_t *head, size_t *count, size_t *capacity, size_t value) {
+    if (*count == *capacity) {
+        size_t grown = *capacity ? *capacity * 2 : 16;
+        size_t *items = malloc(grown * sizeof(size_t));
+        if (!items) return false;
+        for (size_t i = 0; i < *count; i++) {
+            items[i] = (*queue)[(*head + i) % *capacity];
+        }
+        free(*queue);
+        *queue = items;
+        *head = 0;
+        *capacity = grown;
+    }
+    (*queue)[(*head + *count) % *capacity] = value;
+    (*count)++;
+    return true;
+}
+
+static size_t shade2d_asset_queue_pop(size_t *queue, size_t *head, size_t *count, size_t capacity) {
+    size_t value = queue[*head];
+    *head = (*head + 1) % capacity;
+    (*count)--;
+    return value;
+}
+
+static void *shade2d_asset_worker(void *arg) {
+    AssetLoader2D *loader = arg;
+    pthread_mutex_lock(&loader->lock);
+    for (;;) {
+        while (!loader->stopping && loader->job_count == 0) {
+            pthread_cond_wait(&loader->wake, &loader->lock);
+        }
+        if (loader->stopping) break;
+        size_t handle = shade2d_asset_queue_pop(loader->jobs, &loader->job_head, &loader->job_count, loader->job_capacity);
+        Shade2DAsset *asset = loader->assets[handle];
+        pthread_mutex_unlock(&loader->lock);
+
+        bool ok;
+        if (asset->is_image) {
+            ok = shade2d_load_image(asset->path, &asset->image);
+        } else {
+            ok = shade2d_load_object_list(&asset->objects, asset->path);
+            if (ok) {
+                volatile unsigned char sink = 0;
+                const unsigned char *bytes = asset->objects.mapping;
+                for (size_t i = 0; i < asset->objects.mapping_size; i += 4096) {
+                    sink ^= bytes[i];
                 }
+                (void)sink;
+            }
+        }
+
+        pthread_mutex_lock(&loader->lock);
+        if (!ok) {
+            asset->status = SHAD2D_ASSET_FAILED;
+        } else if (asset->is_image && loader->atlas) {
+            asset->status = SHAD2D_ASSET_UPLOADING;
+            if (!shade2d_asset_queue_push(&loader->uploads, &loader->upload_head, &loader->upload_count,
+                                          &loader->upload_capacity, handle)) {
+                shade2d_destroy_image(asset->image);
+                asset->image.pixels = NULL;
+                asset->status = SHAD2D_ASSET_FAILED;
             }
+        } else {
+            asset->status = SHAD2D_ASSET_READY;
         }
     }
+    pthread_mutex_unlock(&loader->lock);
+    return NULL;
 }
 
-void shade2d_draw_object_list(Window2D window, ObjectList2D objects) {
+AssetLoader2D* shade2d_create_asset_loader(TextureAtlas2D* atlas, int threads) {
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int)cpus : 1;
+    }
+    AssetLoader2D *loader = calloc(1, sizeof(AssetLoader2D));
+    if (!loader) return NULL;
+    loader->atlas = atlas;
+    loader->threads = calloc(threads, sizeof(pthread_t));
+    if (!loader->threads) {
+        free(loader);
+        return NULL;
+    }
+    pthread_mutex_init(&loader->lock, NULL);
+    pthread_cond_init(&loader->wake, NULL);
+    for (int i = 0; i < threads; i++) {
+        if (pthread_create(&loader->threads[i], NULL, shade2d_asset_worker, loader) != 0) break;
+        loader->thread_count++;
+    }
+    if (loader->thread_count == 0) {
+        shade2d_destroy_asset_loader(loader);
+        return NULL;
+    }
+    return loader;
+}
+
+static AssetHandle2D shade2d_queue_asset(AssetLoader2D *loader, const char *path, bool is_image) {
+    if (!loader || !path) return -1;
+    Shade2DAsset *asset = calloc(1, sizeof(Shade2DAsset));
+    if (!asset) return -1;
+    asset->is_image = is_image;
+    asset->status = SHAD2D_ASSET_PENDING;
+    asset->path = malloc(strlen(path) + 1);
+    if (!asset->path) {
+        free(asset);
+        return -1;
+    }
+    strcpy(asset->path, path);
+
+    AssetHandle2D handle = -1;
+    pthread_mutex_lock(&loader->lock);
+    if (loader->asset_count == loader->asset_capacity && loader->asset_count < INT32_MAX) {
+        size_t grown = loader->asset_capacity ? loader->asset_capacity * 2 : 16;
+        Shade2DAsset **assets = realloc(loader->assets, grown * sizeof(Shade2DAsset *));
+        if (assets) {
+            loader->assets = assets;
+            loader->asset_capacity = grown;
+        }
+    }
+    if (loader->asset_count < loader->asset_capacity &&
+        shade2d_asset_queue_push(&loader->jobs, &loader->job_head, &loader->job_count, &loader->job_capacity,
+                                 loader->asset_count)) {
+        handle = (AssetHandle2D)loader->asset_count;
+        loader->assets[loader->asset_count++] = asset;
+        pthread_cond_signal(&loader->wake);
+    }
+    pthread_mutex_unlock(&loader->lock);
+    if (handle < 0) {
+        free(asset->path);
+        free(asset);
+    }
+    return handle;
+}
+
+AssetHandle2D shade2d_load_image_async(AssetLoader2D* loader, const char* path) {
+    return shade2d_queue_asset(loader, path, true);
+}
+
+AssetHandle2D shade2d_load_object_list_async(AssetLoader2D* loader, const char* path) {
+    return shade2d_queue_asset(loader, path, false);
+}
+
+// Asset behind a handle, locked; NULL (and unlocked) if the handle is invalid
+static Shade2DAsset *shade2d_lock_asset(AssetLoader2D *loader, AssetHandle2D handle) {
+    if (!loader || handle < 0) return NULL;
+    pthread_mutex_lock(&loader->lock);
+    if ((size_t)handle >= loader->asset_count) {
+        pthread_mutex_unlock(&loader->lock);
+        return NULL;
+    }
+    return loader->assets[handle];
+}
+
+AssetStatus2D shade2d_get_asset_status(AssetLoader2D* loader, AssetHandle2D handle) {
+    Shade2DAsset *asset = shade2d_lock_asset(loader, handle);
+    if (!asset) return SHAD2D_ASSET_FAILED;
+    AssetStatus2D status = asset->status;
+    pthread_mutex_unlock(&loader->lock);
+    return status;
+}
+
+bool shade2d_get_asset_region(AssetLoader2D* loader, AssetHandle2D handle, AtlasRegion2D* region) {
+    Shade2DAsset *asset = shade2d_lock_asset(loader, handle);
+    if (!asset) return false;
+    bool ok = asset->is_image && loader->atlas && asset->status == SHAD2D_ASSET_READY;
+    if (ok) *region = asset->region;
+    pthread_mutex_unlock(&loader->lock);
+    return ok;
+}
+
+bool shade2d_take_asset_image(AssetLoader2D* loader, AssetHandle2D handle, Image2D* image) {
+    Shade2DAsset *asset = shade2d_lock_asset(loader, handle);
+    if (!asset) return false;
+    bool ok = asset->is_image && !loader->atlas && asset->status == SHAD2D_ASSET_READY && !asset->taken;
+    if (ok) {
+        *image = asset->image;
+        asset->image.pixels = NULL;
+        asset->taken = true;
+    }
+    pthread_mutex_unlock(&loader->lock);
+    return ok;
+}
+
+bool shade2d_take_asset_object_list(AssetLoader2D* loader, AssetHandle2D handle, ObjectList2D* objects) {
+    Shade2DAsset *asset = shade2d_lock_asset(loader, handle);
+    if (!asset) return false;
+    bool ok = !asset->is_image && asset->status == SHAD2D_ASSET_READY && !asset->taken;
+    if (ok) {
+        *objects = asset->objects;
+        asset->taken = true;
+    }
+    pthread_mutex_unlock(&loader->lock);
+    return ok;
+}
+
+size_t shade2d_pump_asset_loader(AssetLoader2D* loader, float budget_ms) {
+    if (!loader || !loader->atlas) return 0;
+    double start = shade2d_now();
+    size_t finished = 0;
+    // Always finish at least one so a budget smaller than any upload still makes progress
+    while (finished == 0 || (shade2d_now() - start) * 1000.0 < budget_ms) {
+        pthread_mutex_lock(&loader->lock);
+        if (loader->upload_count == 0) {
+            pthread_mutex_unlock(&loader->lock);
+            break;
+        }
+        size_t handle = shade2d_asset_queue_pop(loader->uploads, &loader->upload_head, &loader->upload_count,
+                                                loader->upload_capacity);
+        Shade2DAsset *asset = loader->assets[handle];
+        pthread_mutex_unlock(&loader->lock);
+
+        // Only this thread touches the atlas and an uploading asset
+        bool ok = shade2d_add_image_to_atlas(loader->atlas, asset->image, &asset->region);
+        if (ok) shade2d_upload_texture_atlas(loader->atlas);
+        shade2d_destroy_image(asset->image);
+        asset->image.pixels = NULL;
+
+        pthread_mutex_lock(&loader->lock);
+        asset->status = ok ? SHAD2D_ASSET_READY : SHAD2D_ASSET_FAILED;
+        pthread_mutex_unlock(&loader->lock);
+        finished++;
+    }
+    return finished;
+}
+
+void shade2d_destroy_asset_loader(AssetLoader2D* loader) {
+    if (!loader) return;
+    pthread_mutex_lock(&loader->lock);
+    loader->stopping = true;
+    pthread_cond_broadcast(&loader->wake);
+    pthread_mutex_unlock(&loader->lock);
+    for (int i = 0; i < loader->thread_count; i++) {
+        pthread_join(loader->threads[i], NULL);
+    }
+    for (size_t i = 0; i < loader->asset_count; i++) {
+        Shade2DAsset *asset = loader->assets[i];
+        free(asset->image.pixels);
+        if (!asset->is_image && asset->status == SHAD2D_ASSET_READY && !asset->taken) {
+            shade2d_destroy_object_list(asset->objects);
+        }
+        free(asset->path);
+        free(asset);
+    }
+    pthread_mutex_destroy(&loader->lock);
+    pthread_cond_destroy(&loader->wake);
+    free(loader->threads);
+    free(loader->assets);
+    free(loader->jobs);
+    free(loader->uploads);
+    free(loader);
+}
+
+// World Sharding
+//
+// The world is cut into vertical strips, each owned and stepped by its own
+// forked process. Everything the processes share lives in one anonymous POSIX
+// shared-memory segment: each shard's object arrays, and a single-producer,
+// single-consumer queue for every ordered pair of shards. A step is: send
+// objects whose center left the strip to their new owner and copies of objects
+// near other strips to those strips, wait for every shard, drain the incoming
+// queues, run the step callback, then wait again so the next step's sends
+// can't mix with this step's. Migrants get halo copies like any other object,
+// the sender keeping one itself, so no shard loses sight of them for a step.
+// The queues need no locks, only the two barriers.
+
+typedef struct {
+    Object2D object;
+    ObjectID id;
+    Material2D material;
+    uint32_t category, mask;
+    bool migrate;  // False for a halo copy
+} Shade2DShardRecord;
+
+typedef struct {
+    _Alignas(64) atomic_size_t head;  // Next record to read, advanced by the consumer
+    _Alignas(64) atomic_size_t tail;  // Next record to write, advanced by the producer
+} Shade2DShardQueue;
+
+typedef struct {
+    _Alignas(64) size_t owned;
+    size_t halo;
+    size_t migrated_in, migrated_out, deferred;
+    Object2D *objects;  // shard_capacity entries each, in the segment
+    ObjectID *ids;
+    Material2D *materials;
+    uint32_t *categories;
+    uint32_t *masks;
+} Shade2DShardState;
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t wake;  // New steps for the workers
+    pthread_cond_t done;  // Last busy worker finished
+    pthread_barrier_t barrier;
+    unsigned generation;
+    int steps;
+    float dt;
+    int busy;
+    bool exiting;
+    atomic_bool failed;
+} Shade2DShardControl;
+
+struct ShardedWorld2D {
+    ShardConfig2D config;
+    ShardStepFn step;
+    void *user_data;
+    void *segment;  // Mapped at the same address in every process
+    size_t segment_size;
+    Shade2DShardControl *control;
+    Shade2DShardState *shards;
+    Shade2DShardQueue *queues;  // [from * shard_count + to]
+    Shade2DShardRecord *records;  // queue_capacity per queue
+    pid_t *workers;
+    bool failed;
+};
+
+ShardConfig2D shade2d_shard_config(int shard_count, float min_x, float max_x, float halo) {
+    ShardConfig2D config;
+    config.shard_count = shard_count;
+    config.min_x = min_x;
+    config.max_x = max_x;
+    config.halo = halo;
+    config.shard_capacity = 0;
+    config.queue_capacity = 0;
+    return config;
+}
+
+static int shade2d_shard_of(const ShardConfig2D *config, float x) {
+    float t = (x - config->min_x) / (config->max_x - config->min_x) * config->shard_count;
+    if (!(t >= 0.0f)) return 0;  // Also catches NaN
+    return t >= (float)config->shard_count ? config->shard_count - 1 : (int)t;
+}
+
+static bool shade2d_shard_push(ShardedWorld2D *world, int from, int to, const Shade2DShardRecord *record) {
+    size_t q = (size_t)from * world->config.shard_count + to;
+    Shade2DShardQueue *queue = &world->queues[q];
+    size_t capacity = world->config.queue_capacity;
+    size_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+    if (tail - head == capacity) return false;
+    world->records[q * capacity + tail % capacity] = *record;
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+static bool shade2d_shard_pop(ShardedWorld2D *world, int from, int to, Shade2DShardRecord *record) {
+    size_t q = (size_t)from * world->config.shard_count + to;
+    Shade2DShardQueue *queue = &world->queues[q];
+    size_t capacity = world->config.queue_capacity;
+    size_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    if (head == tail) return false;
+    *record = world->records[q * capacity + head % capacity];
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+    return true;
+}
+
+static void shade2d_object_center_x(const Object2D *object, float *center, float *minx, float *maxx) {
+    float miny, maxy;
+    shade2d_object_bounds(object, minx, &miny, maxx, &maxy);
+    *center = (*minx + *maxx) * 0.5f;
+}
+
+static void shade2d_shard_load(const Shade2DShardState *shard, size_t i, Shade2DShardRecord *record) {
+    record->object = shard->objects[i];
+    record->id = shard->ids[i];
+    record->material = shard->materials[i];
+    record->category = shard->categories[i];
+    record->mask = shard->masks[i];
+}
+
+static void shade2d_shard_store(Shade2DShardState *shard, size_t i, const Shade2DShardRecord *record) {
+    shard->objects[i] = record->object;
+    shard->ids[i] = record->id;
+    shard->materials[i] = record->material;
+    shard->categories[i] = record->category;
+    shard->masks[i] = record->mask;
+}
+
+static void shade2d_shard_fail(ShardedWorld2D *world) {
+    atomic_store(&world->control->failed, true);
+}
+
+// The lock is robust: a worker that dies holding it hands it to the next locker, which repairs
+// it and fails the world, since whatever the worker was changing can't be trusted
+static void shade2d_shard_recover(Shade2DShardControl *control, int result) {
+    if (result == EOWNERDEAD) {
+        pthread_mutex_consistent(&control->lock);
+        atomic_store(&control->failed, true);
+    }
+}
+
+static void shade2d_shard_lock(Shade2DShardControl *control) {
+    shade2d_shard_recover(control, pthread_mutex_lock(&control->lock));
+}
+
+static void shade2d_shard_step(ShardedWorld2D *world, int s, ObjectList2D *list, float dt) {
+    const ShardConfig2D *config = &world->config;
+    Shade2DShardState *shard = &world->shards[s];
+    size_t n = shard->owned;  // Last step's halo copies are simply dropped
+    size_t sent = n;
+    Shade2DShardRecord record, kept;
+
+    // Hand over objects that left the strip, keeping them if the queue is full.
+    // Sent objects are swapped to [n, sent) for the halo pass.
+    for (size_t i = 0; i < n;) {
+        float center, minx, maxx;
+        shade2d_object_center_x(&shard->objects[i], &center, &minx, &maxx);
+        int owner = shade2d_shard_of(config, center);
+        if (owner != s) {
+            shade2d_shard_load(shard, i, &record);
+            record.migrate = true;
+            if (shade2d_shard_push(world, s, owner, &record)) {
+                n--;
+                shade2d_shard_load(shard, n, &kept);
+                shade2d_shard_store(shard, i, &kept);
+                shade2d_shard_store(shard, n, &record);
+                shard->migrated_out++;
+                continue;
+            }
+            shard->deferred++;
+        }
+        i++;
+    }
+    // Copy objects near other strips into them
+    for (size_t i = 0; i < n; i++) {
+        float center, minx, maxx;
+        shade2d_object_center_x(&shard->objects[i], &center, &minx, &maxx);
+        int first = shade2d_shard_of(config, minx - config->halo);
+        int last = shade2d_shard_of(config, maxx + config->halo);
+        if (first == s && last == s) continue;
+        shade2d_shard_load(shard, i, &record);
+        record.migrate = false;
+        for (int t = first; t <= last; t++) {
+            if (t == s) continue;
+            if (!shade2d_shard_push(world, s, t, &record)) shade2d_shard_fail(world);  // A missing halo would change results
+        }
+    }
+    // Migrants too, except to their new owner, which only has them after the barrier. This shard
+    // keeps its own copy, stacked from the end like received ones; walking down never overwrites
+    // a migrant not yet read.
+    size_t capacity = config->shard_capacity;
+    size_t h = 0;
+    for (size_t i = sent; i-- > n;) {
+        float center, minx, maxx;
+        shade2d_object_center_x(&shard->objects[i], &center, &minx, &maxx);
+        int owner = shade2d_shard_of(config, center);
+        int first = shade2d_shard_of(config, minx - config->halo);
+        int last = shade2d_shard_of(config, maxx + config->halo);
+        shade2d_shard_load(shard, i, &record);
+        record.migrate = false;
+        for (int t = first; t <= last; t++) {
+            if (t == owner) continue;
+            if (t == s) {
+                shade2d_shard_store(shard, capacity - 1 - h++, &record);
+            } else if (!shade2d_shard_push(world, s, t, &record)) {
+                shade2d_shard_fail(world);
+            }
+        }
+    }
+    shard->owned = n;
+    pthread_barrier_wait(&world->control->barrier);
+
+    // Migrants are appended to the owned objects, halo copies are stacked from the end and moved down after
+    for (int t = 0; t < config->shard_count; t++) {
+        if (t == s) continue;
+        while (shade2d_shard_pop(world, t, s, &record)) {
+            if (n + h >= capacity) {
+                shade2d_shard_fail(world);
+                continue;
+            }
+            size_t slot = record.migrate ? n++ : capacity - 1 - h++;
+            shade2d_shard_store(shard, slot, &record);
+            if (record.migrate) shard->migrated_in++;
+        }
+    }
+    memmove(&shard->objects[n], &shard->objects[capacity - h], h * sizeof(Object2D));
+    memmove(&shard->ids[n], &shard->ids[capacity - h], h * sizeof(ObjectID));
+    memmove(&shard->materials[n], &shard->materials[capacity - h], h * sizeof(Material2D));
+    memmove(&shard->categories[n], &shard->categories[capacity - h], h * sizeof(uint32_t));
+    memmove(&shard->masks[n], &shard->masks[capacity - h], h * sizeof(uint32_t));
+    shard->owned = n;
+    shard->halo = h;
+
+    ShardInfo2D info;
+    info.shard = s;
+    float width = (config->max_x - config->min_x) / config->shard_count;
+    info.min_x = s == 0 ? -FLT_MAX : config->min_x + width * s;
+    info.max_x = s == config->shard_count - 1 ? FLT_MAX : config->min_x + width * (s + 1);
+    info.owned = n;
+    list->size = n + h;
+    world->step(list, &info, dt, world->user_data);
+    if (list->objects != shard->objects || list->size != n + h) {
+        shade2d_shard_fail(world);  // The callback grew or shrank the list
+        list->objects = shard->objects;
+        list->ids = shard->ids;
+        list->materials = shard->materials;
+        list->categories = shard->categories;
+        list->masks = shard->masks;
+    }
+    pthread_barrier_wait(&world->control->barrier);
+}
+
+static void shade2d_shard_worker(ShardedWorld2D *world, int s) {
+    Shade2DShardControl *control = world->control;
+    Shade2DShardState *shard = &world->shards[s];
+    // Lives across steps so a grid the callback builds can be reused
+    ObjectList2D list;
+    memset(&list, 0, sizeof(list));
+    list.objects = shard->objects;
+    list.ids = shard->ids;
+    list.materials = shard->materials;
+    list.categories = shard->categories;
+    list.masks = shard->masks;
+    list.capacity = world->config.shard_capacity;
+    list.mapping = world->segment;  // Growing copies out of the segment instead of reallocating it
+    list.mapping_size = world->segment_size;
+
+    unsigned seen = 0;
+    for (;;) {
+        shade2d_shard_lock(control);
+        while (control->generation == seen && !control->exiting) {
+            shade2d_shard_recover(control, pthread_cond_wait(&control->wake, &control->lock));
+        }
+        bool exiting = control->exiting;
+        seen = control->generation;
+        int steps = control->steps;
+        float dt = control->dt;
+        pthread_mutex_unlock(&control->lock);
+        if (exiting) break;
+
+        for (int i = 0; i < steps; i++) {
+            shade2d_shard_step(world, s, &list, dt);
+        }
+
+        shade2d_shard_lock(control);
+        if (--control->busy == 0) pthread_cond_signal(&control->done);
+        pthread_mutex_unlock(&control->lock);
+    }
+}
+
+static size_t shade2d_shard_align(size_t offset) {
+    return (offset + 63) & ~(size_t)63;
+}
+
+ShardedWorld2D* shade2d_create_sharded_world(ObjectList2D objects, ShardConfig2D config, ShardStepFn step, void* user_data) {
+    if (config.shard_count <= 0 || !(config.max_x > config.min_x) || !step) return NULL;
+    int k = config.shard_count;
+    if (config.shard_capacity == 0) config.shard_capacity = 2 * (objects.size / k) + 1024;
+    if (config.queue_capacity == 0) config.queue_capacity = config.shard_capacity / 4 + 64;
+
+    // Layout: control, shard states, queues, records, then each shard's arrays
+    size_t capacity = config.shard_capacity;
+    size_t queue_count = (size_t)k * k;
+    size_t shards_offset = shade2d_shard_align(sizeof(Shade2DShardControl));
+    size_t queues_offset = shade2d_shard_align(shards_offset + k * sizeof(Shade2DShardState));
+    size_t records_offset = shade2d_shard_align(queues_offset + queue_count * sizeof(Shade2DShardQueue));
+    size_t arrays_offset = shade2d_shard_align(records_offset + queue_count * config.queue_capacity * sizeof(Shade2DShardRecord));
+    size_t objects_bytes = shade2d_shard_align(capacity * sizeof(Object2D));
+    size_t ids_bytes = shade2d_shard_align(capacity * sizeof(ObjectID));
+    size_t materials_bytes = shade2d_shard_align(capacity * sizeof(Material2D));
+    size_t filter_bytes = shade2d_shard_align(capacity * sizeof(uint32_t));
+    size_t shard_bytes = objects_bytes + ids_bytes + materials_bytes + 2 * filter_bytes;
+    size_t size = arrays_offset + k * shard_bytes;
+
+    // Unlinked right away: the mapping is inherited across fork and nothing is left behind
+    char name[64];
+    static atomic_uint counter;
+    snprintf(name, sizeof(name), "/shade2d-%ld-%u", (long)getpid(), atomic_fetch_add(&counter, 1));
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) return NULL;
+    shm_unlink(name);
+    void *segment = MAP_FAILED;
+    if (ftruncate(fd, (off_t)size) == 0) {
+        segment = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (segment == MAP_FAILED) return NULL;
+
+    ShardedWorld2D *world = calloc(1, sizeof(ShardedWorld2D));
+    pid_t *workers = calloc(k, sizeof(pid_t));
+    if (!world || !workers) {
+        free(world);
+        free(workers);
+        munmap(segment, size);
+        return NULL;
+    }
+    char *base = segment;
+    world->config = config;
+    world->step = step;
+    world->user_data = user_data;
+    world->segment = segment;
+    world->segment_size = size;
+    world->control = segment;
+    world->shards = (Shade2DShardState *)(base + shards_offset);
+    world->queues = (Shade2DShardQueue *)(base + queues_offset);
+    world->records = (Shade2DShardRecord *)(base + records_offset);
+    world->workers = workers;
+    for (int s = 0; s < k; s++) {
+        char *arrays = base + arrays_offset + s * shard_bytes;
+        world->shards[s].objects = (Object2D *)arrays;
+        world->shards[s].ids = (ObjectID *)(arrays + objects_bytes);
+        world->shards[s].materials = (Material2D *)(arrays + objects_bytes + ids_bytes);
+        world->shards[s].categories = (uint32_t *)(arrays + objects_bytes + ids_bytes + materials_bytes);
+        world->shards[s].masks = (uint32_t *)(arrays + objects_bytes + ids_bytes + materials_bytes + filter_bytes);
+    }
+    for (size_t q = 0; q < queue_count; q++) {
+        atomic_init(&world->queues[q].head, 0);
+        atomic_init(&world->queues[q].tail, 0);
+    }
+
+    // Initial owners come straight from the list, no queues needed
+    bool fits = true;
     for (size_t i = 0; i < objects.size; i++) {
-        if (objects.objects[i].type == SHAD2D_CIRCLE) {
-            shade2d_draw_circle(window, objects.objects[i].obj.circle);
-        } else if (objects.objects[i].type == SHAD2D_RECTANGLE) {
-            shade2d_draw_rectangle(window, objects.objects[i].obj.rect);
+        float center, minx, maxx;
+        shade2d_object_center_x(&objects.objects[i], &center, &minx, &maxx);
+        Shade2DShardState *shard = &world->shards[shade2d_shard_of(&config, center)];
+        if (shard->owned == capacity) {
+            fits = false;
+            break;
+        }
+        shard->objects[shard->owned] = objects.objects[i];
+        shard->ids[shard->owned] = objects.ids[i];
+        shard->materials[shard->owned] = objects.materials[i];
+        shard->categories[shard->owned] = objects.categories[i];
+        shard->masks[shard->owned] = objects.masks[i];
+        shard->owned++;
+    }
+
+    Shade2DShardControl *control = world->control;
+    pthread_mutexattr_t mutex_attr;
+    pthread_condattr_t cond_attr;
+    pthread_barrierattr_t barrier_attr;
+    pthread_mutexattr_init(&mutex_attr);
+    pthread_mutexattr_setpshared(&mutex_attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&mutex_attr, PTHREAD_MUTEX_ROBUST);
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setpshared(&cond_attr, PTHREAD_PROCESS_SHARED);
+    pthread_barrierattr_init(&barrier_attr);
+    pthread_barrierattr_setpshared(&barrier_attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutex_init(&control->lock, &mutex_attr);
+    pthread_cond_init(&control->wake, &cond_attr);
+    pthread_cond_init(&control->done, &cond_attr);
+    pthread_barrier_init(&control->barrier, &barrier_attr, (unsigned)k);
+    pthread_mutexattr_destroy(&mutex_attr);
+    pthread_condattr_destroy(&cond_attr);
+    pthread_barrierattr_destroy(&barrier_attr);
+    atomic_init(&control->failed, false);
+    if (!fits) {
+        shade2d_destroy_sharded_world(world);
+        return NULL;
+    }
+
+    fflush(NULL);  // Don't let children flush the parent's buffered output again
+    for (int s = 0; s < k; s++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            shade2d_shard_worker(world, s);
+            _exit(0);
         }
+        if (pid < 0) {
+            world->failed = true;
+            shade2d_destroy_sharded_world(world);
+            return NULL;
+        }
+        workers[s] = pid;
     }
+    return world;
 }
 
-void shade2d_destroy_object_list(ObjectList2D objects) {
-    free(objects.objects);  // Free the allocated array
+// Reaps workers that died; true if any did
+static bool shade2d_shard_workers_died(ShardedWorld2D *world) {
+    bool died = false;
+    for (int s = 0; s < world->config.shard_count; s++) {
+        if (world->workers[s] > 0 && waitpid(world->workers[s], NULL, WNOHANG) == world->workers[s]) {
+            world->workers[s] = 0;
+            died = true;
+        }
+    }
+    return died;
 }
 
-ObjectID shade2d_create_object_id() {
-    static ObjectID next_id = 0;  // Static to maintain state
-    return next_id++;
-} 
\ No newline at end of file
+bool shade2d_step_sharded_world(ShardedWorld2D* world, int steps, float dt) {
+    if (!world || world->failed) return false;
+    if (steps <= 0) return true;
+    Shade2DShardControl *control = world->control;
+    shade2d_shard_lock(control);
+    control->steps = steps;
+    control->dt = dt;
+    control->busy = world->config.shard_count;
+    control->generation++;
+    pthread_cond_broadcast(&control->wake);
+    while (control->busy > 0) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += 100000000;  // Check on the workers every 100 ms
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+        shade2d_shard_recover(control, pthread_cond_timedwait(&control->done, &control->lock, &deadline));
+        if (control->busy > 0 && shade2d_shard_workers_died(world)) {
+            world->failed = true;  // The others are stuck at the barrier
+            break;
+        }
+    }
+    pthread_mutex_unlock(&control->lock);
+    if (atomic_load(&control->failed)) world->failed = true;
+    return !world->failed;
+}
+
+typedef struct {
+    ObjectID id;
+    const Shade2DShardState *shard;
+    size_t index;
+} Shade2DShardGather;
+
+static int shade2d_compare_gather(const void *a, const void *b) {
+    ObjectID ia = ((const Shade2DShardGather *)a)->id;
+    ObjectID ib = ((const Shade2DShardGather *)b)->id;
+    return (ia > ib) - (ia < ib);
+}
+
+bool shade2d_gather_sharded_world(ShardedWorld2D* world, ObjectList2D* objects) {
+    if (!world) return false;
+    size_t total = 0;
+    for (int s = 0; s < world->config.shard_count; s++) {
+        total += world->shards[s].owned;
+    }
+    Shade2DShardGather *entries = malloc((total ? total : 1) * sizeof(Shade2DShardGather));
+    if (!entries) return false;
+    size_t count = 0;
+    for (int s = 0; s < world->config.shard_count; s++) {
+        const Shade2DShardState *shard = &world->shards[s];
+        for (size_t i = 0; i < shard->owned; i++) {
+            entries[count].id = shard->ids[i];
+            entries[count].shard = shard;
+            entries[count].index = i;
+            count++;
+        }
+    }
+    // IDs rather than shard order, so the result doesn't depend on the partition
+    qsort(entries, count, sizeof(Shade2DShardGather), shade2d_compare_gather);
+    shade2d_reserve_object_list(objects, objects->size + count);
+    Shade2DShardRecord record;
+    for (size_t i = 0; i < count; i++) {
+        shade2d_shard_load(entries[i].shard, entries[i].index, &record);
+        objects->objects[objects->size] = record.object;
+        objects->ids[objects->size] = record.id;
+        objects->materials[objects->size] = record.material;
+        objects->categories[objects->size] = record.category;
+        objects->masks[objects->size] = record.mask;
+        objects->size++;
+    }
+    free(entries);
+    return !world->failed;
+}
+
+bool shade2d_get_shard_stats(ShardedWorld2D* world, int shard, ShardStats2D* stats) {
+    if (!world || shard < 0 || shard >= world->config.shard_count) return false;
+    const Shade2DShardState *state = &world->shards[shard];
+    stats->owned = state->owned;
+    stats->halo = state->halo;
+    stats->migrated_in = state->migrated_in;
+    stats->migrated_out = state->migrated_out;
+    stats->deferred = state->deferred;
+    return true;
+}
+
+void shade2d_destroy_sharded_world(ShardedWorld2D* world) {
+    if (!world) return;
+    Shade2DShardControl *control = world->control;
+    shade2d_shard_lock(control);
+    control->exiting = true;
+    pthread_cond_broadcast(&control->wake);
+    pthread_mutex_unlock(&control->lock);
+    for (int s = 0; s < world->config.shard_count; s++) {
+        if (world->workers[s] <= 0) continue;
+        if (world->failed) kill(world->workers[s], SIGKILL);  // May be stuck at the barrier
+        waitpid(world->workers[s], NULL, 0);
+    }
+    // Killed workers can leave the barrier mid-round, and destroying it would wait for them
+    if (!world->failed) {
+        pthread_barrier_destroy(&control->barrier);
+        pthread_cond_destroy(&control->done);
+        pthread_cond_destroy(&control->wake);
+        pthread_mutex_destroy(&control->lock);
+    }
+    munmap(world->segment, world->segment_size);
+    free(world->workers);
+    free(world);
+}
@@ -3,22 +3,30 @@
 
 #include <stdbool.h>
 #include <stddef.h>  // For size_t
+#include <stdint.h>
 
 // Window management
+typedef struct Window2DState Window2DState;  // Internal, allocated by the init functions
+
 typedef struct {
-    void* handle;
+    void* handle;         // GLFW window, NULL for headless windows
     int width;
     int height;
     const char* title;
+    Window2DState* state;
 } Window2D;
 
 Window2D shade2d_init_window(const char* title, int width, int height);
+Window2D shade2d_init_headless_window(const char* title, int width, int height);
 void shade2d_destroy_window(Window2D window);
+void shade2d_close_window(Window2D window);
+const unsigned char* shade2d_get_framebuffer(Window2D window);  // RGBA pixels of a headless window, NULL otherwise
 bool shade2d_is_running(Window2D window);
 void shade2d_update_window(Window2D window);
 int shade2d_get_width(Window2D window);
 int shade2d_get_height(Window2D window);
 void shade2d_set_window_fps(Window2D window, int fps);
+void shade2d_set_circle_segments(Window2D window, int segments);  // Tessellation of shade2d_draw_circle, default 32
 void shade2d_clear_window(Window2D window);
 void shade2d_setup_projection(Window2D window);
 
@@ -41,10 +49,159 @@ typedef struct {
     float width, height;
 } Rectangle2D;
 
+// Oriented box, positioned by its center and rotated by angle (radians)
+typedef struct {
+    float x, y;
+    float velx, vely;
+    float mass;
+    float width, height;
+    float angle;
+    float angvel;
+} Box2D;
+
+#define SHAD2D_MAX_POLYGON_VERTICES 8
+
+// Convex polygon; vertices are local to (x, y), which is kept at the centroid
+typedef struct {
+    float x, y;
+    float velx, vely;
+    float mass;
+    float angle;
+    float angvel;
+    int vertex_count;
+    float vertices[SHAD2D_MAX_POLYGON_VERTICES][2];
+} Polygon2D;
+
 Circle2D shade2d_circle(Window2D window, float x, float y, float radius);
 void shade2d_draw_circle(Window2D window, Circle2D circle);
 Rectangle2D shade2d_rectangle(Window2D window, float x, float y, float width, float height);
 void shade2d_draw_rectangle(Window2D window, Rectangle2D rectangle);
+Box2D shade2d_box(Window2D window, float x, float y, float width, float height, float angle);
+void shade2d_draw_box(Window2D window, Box2D box);
+Polygon2D shade2d_polygon(Window2D window, float x, float y, const float *vertices, int count);  // vertices: x0, y0, x1, y1, ...
+void shade2d_draw_polygon(Window2D window, Polygon2D polygon);
+
+// Render Layers
+typedef void (*RenderLayerDrawFn)(Window2D window, void* user_data);
+
+typedef struct RenderLayer2D {
+    char name[32];
+    int width, height;
+    RenderLayerDrawFn draw;
+    void* user_data;
+    bool dirty;
+    unsigned int framebuffer;  // OpenGL framebuffer object and its color texture
+    unsigned int texture;
+    unsigned char* pixels;     // RGBA pixels for headless windows
+    struct RenderLayer2D* next;
+} RenderLayer2D;
+
+RenderLayer2D* shade2d_create_render_layer(Window2D window, const char* name, RenderLayerDrawFn draw, void* user_data);
+RenderLayer2D* shade2d_get_render_layer(Window2D window, const char* name);
+void shade2d_invalidate_render_layer(RenderLayer2D* layer);
+void shade2d_draw_render_layer(Window2D window, RenderLayer2D* layer);
+void shade2d_destroy_render_layer(Window2D window, RenderLayer2D* layer);
+
+// Images and Texture Atlas
+typedef struct {
+    int width, height;
+    unsigned char* pixels;  // RGBA, rows top to bottom
+} Image2D;
+
+Image2D shade2d_create_image(int width, int height, const unsigned char* pixels);  // Copies pixels, NULL for transparent
+void shade2d_destroy_image(Image2D image);
+bool shade2d_load_image(const char* path, Image2D* image);  // PPM (P5/P6), QOI or TGA
+
+#define SHAD2D_ATLAS_MAX_PAGES 16
+
+typedef struct {
+    unsigned int texture;   // Created on first upload, 0 for headless windows
+    unsigned char* pixels;  // RGBA copy of the page, sampled by the software path
+    int* skyline;           // Packing skyline as x, y, width triples
+    int skyline_count;
+    int dirty_top, dirty_bottom;  // Rows changed since the last upload
+} AtlasPage2D;
+
+typedef struct {
+    bool uploads;  // False for headless windows, pages stay on the CPU
+    int page_size;
+    int page_count;
+    AtlasPage2D pages[SHAD2D_ATLAS_MAX_PAGES];
+} TextureAtlas2D;
+
+typedef struct {
+    int page;
+    int x, y, width, height;  // Pixels within the page
+    float u0, v0, u1, v1;
+} AtlasRegion2D;
+
+TextureAtlas2D* shade2d_create_texture_atlas(Window2D window, int page_size);
+bool shade2d_add_image_to_atlas(TextureAtlas2D* atlas, Image2D image, AtlasRegion2D* region);
+void shade2d_upload_texture_atlas(TextureAtlas2D* atlas);  // Sends changed rows to OpenGL, called by the draw functions
+void shade2d_destroy_texture_atlas(TextureAtlas2D* atlas);
+
+// Sprites
+typedef struct {
+    float x, y;  // Center
+    float width, height;
+    float angle;  // Radians
+    unsigned char r, g, b, a;  // Tint
+    AtlasRegion2D region;
+} Sprite2D;
+
+typedef struct {
+    TextureAtlas2D* atlas;
+    Sprite2D* sprites;
+    size_t count, capacity;
+    size_t page_counts[SHAD2D_ATLAS_MAX_PAGES];
+    void* scratch;  // Sprites sorted by page: vertices for OpenGL, indices for software
+    size_t scratch_size;  // Bytes
+} SpriteBatch2D;
+
+Sprite2D shade2d_sprite(AtlasRegion2D region, float x, float y);
+SpriteBatch2D* shade2d_create_sprite_batch(TextureAtlas2D* atlas, size_t capacity);
+bool shade2d_add_sprite(SpriteBatch2D* batch, Sprite2D sprite);
+void shade2d_draw_sprite_batch(Window2D window, SpriteBatch2D* batch);  // Draws and empties the batch
+void shade2d_destroy_sprite_batch(SpriteBatch2D* batch);
+
+// Text
+typedef struct {
+    AtlasRegion2D region;
+    int offset_x, offset_y;  // From the pen (top of the line) to the glyph's top-left corner
+    int advance;
+    bool present;
+} FontGlyph2D;
+
+typedef struct {
+    TextureAtlas2D* atlas;
+    int line_height;
+    FontGlyph2D glyphs[256];  // Indexed by byte, Latin-1
+} Font2D;
+
+Font2D* shade2d_create_default_font(TextureAtlas2D* atlas);  // Built-in 5x7 ASCII font in a 6x8 cell
+Font2D* shade2d_load_font(TextureAtlas2D* atlas, const char* path);  // PSF1, PSF2 or BDF
+void shade2d_destroy_font(Font2D* font);
+float shade2d_measure_text(const Font2D* font, float scale, const char* text);
+float shade2d_draw_text(SpriteBatch2D* batch, const Font2D* font, float x, float y, float scale,
+                        unsigned char r, unsigned char g, unsigned char b, const char* text);
+float shade2d_draw_textf(SpriteBatch2D* batch, const Font2D* font, float x, float y, float scale,
+                         unsigned char r, unsigned char g, unsigned char b, const char* format, ...);
+
+// Frame Capture
+typedef enum {
+    SHAD2D_CAPTURE_RAW,          // RGBA frames back to back, top row first
+    SHAD2D_CAPTURE_Y4M,          // YUV4MPEG2 stream (4:2:0), playable by ffmpeg/mpv
+    SHAD2D_CAPTURE_PNG_SEQUENCE  // One PNG per frame, path is a pattern with one integer conversion like "frame_%05d.png"
+} CaptureFormat2D;
+
+typedef struct FrameCapture2D FrameCapture2D;
+
+FrameCapture2D* shade2d_start_capture(Window2D window, const char* path, CaptureFormat2D format, int fps, int max_pending_frames);
+void shade2d_capture_frame(FrameCapture2D* capture);  // Call after drawing, before shade2d_update_window
+size_t shade2d_get_capture_frame_count(FrameCapture2D* capture);
+size_t shade2d_get_capture_dropped_frames(FrameCapture2D* capture);
+bool shade2d_capture_failed(FrameCapture2D* capture);  // True once a frame couldn't be written
+bool shade2d_stop_capture(FrameCapture2D* capture);    // False if any frame failed to write
 
 // Input Handling
 #define SHAD2D_KEY_UNKNOWN -1
@@ -190,6 +347,14 @@ void shade2d_draw_rectangle(Window2D window, Rectangle2D rectangle);
 bool shade2d_is_key_pressed(Window2D window, int key);
 bool shade2d_is_mouse_pressed_button(Window2D window, int button, Rectangle2D rectangle);
 bool shade2d_is_mouse_pressed_button_circle(Window2D window, int button, Circle2D circle);
+void shade2d_get_mouse_position(Window2D window, double* x, double* y);
+float shade2d_get_delta_time(Window2D window);  // Seconds between the last two shade2d_update_window calls
+
+// Input recording and replay
+bool shade2d_start_input_recording(Window2D window, const char* path);
+void shade2d_stop_input_recording(Window2D window);
+bool shade2d_start_input_replay(Window2D window, const char* path);  // Window closes when the stream ends
+bool shade2d_is_replaying(Window2D window);
 
 // Utility
 void shade2d_buffer_init(Window2D window);
@@ -199,7 +364,10 @@ void shade2d_window_delay(Window2D window, double seconds);
 // Collision Detection
 typedef enum {
     SHAD2D_RECTANGLE,
-    SHAD2D_CIRCLE
+    SHAD2D_CIRCLE,
+    SHAD2D_BOX,
+    SHAD2D_POLYGON,
+    SHAD2D_SHAPE_COUNT
 } ShapeType;
 
 typedef struct {
@@ -207,10 +375,31 @@ typedef struct {
     union {
         Rectangle2D rect;
         Circle2D circle;
+        Box2D box;
+        Polygon2D polygon;
     } obj;
 } Object2D;
 
+// Contact feature IDs: the low byte names the feature on the first object, the high byte the one on the second
+#define SHAD2D_FEATURE_VERTEX 0x00u
+#define SHAD2D_FEATURE_EDGE 0x40u
+#define SHAD2D_FEATURE_CLIP 0x80u  // Point made by clipping against the other object's side plane
+
+typedef struct {
+    float x, y;
+    float depth;
+    uint32_t feature;  // Features that produced the point, stable while the same edges touch
+} ContactPoint2D;
+
+typedef struct {
+    float normal_x, normal_y;  // Unit normal pointing from the first object to the second
+    int point_count;
+    ContactPoint2D points[2];
+} Manifold2D;
+
 bool shade2d_check_collision(Object2D obj1, Object2D obj2);
+bool shade2d_collide(const Object2D *obj1, const Object2D *obj2, Manifold2D *manifold);
+void shade2d_resolve_manifold(Object2D *obj1, Object2D *obj2, const Manifold2D *manifold);
 void shade2d_handle_collision_rect_rect(Rectangle2D *r1, Rectangle2D *r2);
 bool shade2d_check_collision_rect_circle(Rectangle2D r, Circle2D c);
 bool shade2d_check_collision_circle_circle(Circle2D c1, Circle2D c2);
@@ -219,10 +408,33 @@ void shade2d_handle_collision_circle_circle(Circle2D *c1, Circle2D *c2);
 
 typedef unsigned int ObjectID;  // Define ObjectID as an unsigned integer
 
+typedef struct {
+    float restitution;  // 1.0 is fully elastic, 0.0 doesn't bounce
+    float friction;     // Coulomb friction coefficient
+} Material2D;
+
+// Uniform grid over object bounds, used to speed up queries on an ObjectList2D
+typedef struct {
+    float cell_size;
+    float origin_x, origin_y;
+    int columns, rows;
+    size_t* cell_start;   // Offsets into items, columns * rows + 1 entries
+    size_t* items;        // Object indices grouped by cell
+    size_t item_count;
+    size_t object_count;  // Objects in the list when the grid was built
+} SpatialGrid2D;
+
 typedef struct {
     Object2D* objects;  // Array of Object2D
+    ObjectID* ids;      // ID of each object, parallel to objects
+    Material2D* materials;  // Material of each object, parallel to objects
+    uint32_t* categories;   // Collision layers each object is on, parallel to objects
+    uint32_t* masks;        // Layers each object collides with, parallel to objects
     size_t size;
     size_t capacity;
+    SpatialGrid2D* grid;  // Optional, see shade2d_build_object_list_grid
+    void* mapping;        // Snapshot the arrays live in, NULL for heap lists
+    size_t mapping_size;
 } ObjectList2D;
 
 ObjectList2D shade2d_create_object_list();
@@ -234,5 +446,246 @@ void shade2d_handle_collisions_object_list(ObjectList2D objects);
 void shade2d_destroy_object_list(ObjectList2D objects);
 void shade2d_draw_object_list(Window2D window, ObjectList2D objects);
 ObjectID shade2d_create_object_id();
+ObjectID shade2d_get_object_id(ObjectList2D objects, size_t index);
+void shade2d_set_object_material(ObjectList2D *objects, size_t index, float restitution, float friction);
+
+// Collision layers: two objects interact only if each one's category is in the other's mask
+#define SHAD2D_COLLISION_LAYERS 32
+#define SHAD2D_CATEGORY_DEFAULT 0x00000001u
+#define SHAD2D_MASK_ALL 0xFFFFFFFFu
+
+typedef struct {
+    size_t filtered;      // Pairs rejected by their masks before any geometric test
+    size_t narrow_phase;  // Pairs passed to the narrow phase
+    size_t layer_pairs[SHAD2D_COLLISION_LAYERS][SHAD2D_COLLISION_LAYERS];  // Narrow-phase pairs by lowest category bit, lower layer first
+} CollisionStats2D;
+
+void shade2d_set_object_collision_filter(ObjectList2D *objects, size_t index, uint32_t category, uint32_t mask);
+void shade2d_handle_collisions_object_list_stats(ObjectList2D objects, CollisionStats2D *stats);  // stats may be NULL
+
+void shade2d_build_object_list_grid(ObjectList2D *objects, float cell_size);  // cell_size <= 0 picks one from object sizes
+void shade2d_clear_object_list_grid(ObjectList2D *objects);
+
+// Snapshots: native-layout binary files that load with mmap and no parsing
+#define SHAD2D_SNAPSHOT_VERSION 2
+
+void shade2d_reserve_object_list(ObjectList2D *objects, size_t capacity);
+bool shade2d_save_object_list(ObjectList2D objects, const char *path);
+bool shade2d_load_object_list(ObjectList2D *objects, const char *path);  // Overwrites *objects without freeing it, only on success
+
+// Ray and Shape Queries
+typedef struct {
+    float x, y;      // Origin
+    float dx, dy;    // Unit direction
+    float length;    // Maximum distance travelled
+    float radius;    // 0 for a ray, otherwise the radius of the swept circle
+    uint32_t ignore; // Collision layers the ray passes through, 0 hits everything
+} Ray2D;
+
+typedef struct {
+    size_t index;    // Index of the object hit in the list
+    ObjectID id;
+    float distance;  // Distance travelled along the ray before the hit
+    float x, y;      // Contact point on the object
+    float normal_x, normal_y;
+} RayHit2D;
+
+typedef enum {
+    SHAD2D_RAY_FIRST_HIT,
+    SHAD2D_RAY_ANY_HIT
+} RayQueryMode2D;
+
+Ray2D shade2d_ray(float x, float y, float dx, float dy, float length);
+Ray2D shade2d_segment(float x1, float y1, float x2, float y2);
+Ray2D shade2d_circle_cast(float x, float y, float dx, float dy, float length, float radius);
+bool shade2d_raycast_object_list(ObjectList2D objects, Ray2D ray, RayHit2D *hit);
+bool shade2d_raycast_any_object_list(ObjectList2D objects, Ray2D ray);
+size_t shade2d_raycast_all_object_list(ObjectList2D objects, Ray2D ray, RayHit2D *hits, size_t max_hits);
+size_t shade2d_raycast_batch(ObjectList2D objects, const Ray2D *rays, size_t count, RayQueryMode2D mode,
+                             RayHit2D *hits, bool *did_hit, int threads);
+
+// Contact Solver
+typedef struct {
+    ObjectID id1, id2;       // Lower ID first, so list order doesn't matter
+    bool occupied;
+    int point_count;
+    uint32_t feature[2];     // Point features, low byte for id1's object
+    float normal_impulse[2];
+    float tangent_impulse[2];
+} ContactCacheEntry2D;
+
+typedef struct {
+    int iterations;              // Velocity iterations per solve
+    bool warm_starting;          // Start each solve from last frame's impulses
+    float position_correction;   // Fraction of penetration removed per solve (Baumgarte factor)
+    float allowed_penetration;   // Penetration left alone to keep resting contacts from jittering
+    float restitution_threshold; // Closing speeds below this don't bounce, in units per second
+    ContactCacheEntry2D* cache;  // Impulses from the last solve, hashed by object pair IDs, matched by feature
+    size_t cache_capacity;       // Power of two, 0 when empty
+    ContactCacheEntry2D* next_cache;
+    size_t next_cache_capacity;
+    void* constraints;           // Scratch space reused between solves
+    size_t constraint_capacity;
+    void* broadphase;            // Bounds and candidate pairs, reused between solves
+    CollisionStats2D stats;      // Pairs filtered and tested by the last solve
+} ContactSolver2D;
+
+ContactSolver2D shade2d_create_contact_solver(int iterations);
+void shade2d_set_contact_solver_iterations(ContactSolver2D *solver, int iterations);
+void shade2d_solve_contacts(ContactSolver2D *solver, ObjectList2D objects, float dt);
+void shade2d_destroy_contact_solver(ContactSolver2D *solver);
+
+// Tilemaps
+#define SHAD2D_TILEMAP_CHUNK_SIZE 16  // Tiles per chunk side
+
+typedef struct {
+    unsigned char r, g, b;
+    bool solid;
+} TileType2D;
+
+typedef struct {
+    void* quads;          // Runs of equal tiles merged into rectangles
+    int quad_count;
+    unsigned int buffer;  // OpenGL vertex buffer holding the same quads
+    bool dirty;
+} TileChunk2D;
+
+typedef struct {
+    int columns, rows;  // Size in tiles
+    float tile_size;
+    float origin_x, origin_y;  // Top-left corner of tile (0, 0)
+    float built_origin_x, built_origin_y;  // Origin the chunks were last built at
+    unsigned char* tiles;      // Tile types, row by row, 0 is empty
+    TileType2D types[256];
+    int chunk_columns, chunk_rows;
+    TileChunk2D* chunks;
+    bool uploads;  // False for headless windows
+} Tilemap2D;
+
+Tilemap2D* shade2d_create_tilemap(Window2D window, int columns, int rows, float tile_size);
+void shade2d_set_tile_type(Tilemap2D* map, int type, unsigned char r, unsigned char g, unsigned char b, bool solid);
+void shade2d_set_tile(Tilemap2D* map, int column, int row, int type);
+int shade2d_get_tile(const Tilemap2D* map, int column, int row);
+void shade2d_draw_tilemap(Window2D window, Tilemap2D* map);
+bool shade2d_overlap_tilemap(const Tilemap2D* map, const Object2D* object);  // Circles and rectangles
+bool shade2d_collide_tilemap(const Tilemap2D* map, Object2D* object, float restitution);
+void shade2d_destroy_tilemap(Tilemap2D* map);
+
+// Frame Budget Governor
+typedef enum {
+    SHAD2D_STAGE_UPDATE,
+    SHAD2D_STAGE_PHYSICS,
+    SHAD2D_STAGE_RENDER,
+    SHAD2D_STAGE_COUNT
+} FrameStage2D;
+
+typedef enum {
+    SHAD2D_QUALITY_CIRCLE_SEGMENTS,
+    SHAD2D_QUALITY_PARTICLE_CAP,       // Read by the application, the library has no particles
+    SHAD2D_QUALITY_SOLVER_ITERATIONS,
+    SHAD2D_QUALITY_SUBSTEPS,
+    SHAD2D_QUALITY_COUNT
+} QualityKnob2D;
+
+typedef struct {
+    int min, max;  // User bounds
+    int value;     // Current decision
+} QualitySetting2D;
+
+#define SHAD2D_GOVERNOR_HISTORY 64
+
+typedef struct {
+    int knob;
+    int previous;  // Value before the degrade
+} QualityChange2D;
+
+typedef struct {
+    float budget_ms;       // Target cost of the measured stages per frame
+    float high_watermark;  // Degrade above budget * high_watermark
+    float low_watermark;   // Upgrade after staying below budget * low_watermark
+    int cooldown_frames;   // Frames to wait after a degrade before judging again
+    int recovery_frames;   // Frames below the low watermark before an upgrade
+    float stage_ms[SHAD2D_STAGE_COUNT];  // Smoothed cost per stage
+    float frame_ms;                      // Sum of the smoothed stage costs
+    QualitySetting2D settings[SHAD2D_QUALITY_COUNT];
+    int last_knob;       // Knob changed by the last decision, -1 if none yet
+    int last_direction;  // -1 degraded, +1 upgraded
+    size_t frame;
+    size_t degrades, upgrades;
+    // Internal
+    double stage_start;
+    int open_stage;
+    float stage_accum[SHAD2D_STAGE_COUNT];
+    int calm_frames;
+    int cooldown;
+    int recovery_scale;  // Doubles when an upgrade is quickly undone
+    size_t last_upgrade_frame;
+    QualityChange2D history[SHAD2D_GOVERNOR_HISTORY];  // Degrades, undone last first
+    int history_count;
+} FrameGovernor2D;
+
+FrameGovernor2D shade2d_create_frame_governor(float budget_ms);
+void shade2d_set_quality_bounds(FrameGovernor2D* governor, QualityKnob2D knob, int min, int max);
+int shade2d_get_quality(const FrameGovernor2D* governor, QualityKnob2D knob);
+void shade2d_begin_frame_stage(FrameGovernor2D* governor, FrameStage2D stage);
+void shade2d_end_frame_stage(FrameGovernor2D* governor);
+void shade2d_end_governed_frame(FrameGovernor2D* governor);  // Updates the estimates and may change one setting
+void shade2d_apply_frame_governor(const FrameGovernor2D* governor, Window2D window, ContactSolver2D* solver);
+
+// Asset Loading
+typedef enum {
+    SHAD2D_ASSET_PENDING,   // Queued or being read and decoded
+    SHAD2D_ASSET_UPLOADING, // Decoded, waiting for shade2d_pump_asset_loader
+    SHAD2D_ASSET_READY,
+    SHAD2D_ASSET_FAILED
+} AssetStatus2D;
+
+typedef int AssetHandle2D;  // -1 when a load couldn't be queued
+typedef struct AssetLoader2D AssetLoader2D;
+
+AssetLoader2D* shade2d_create_asset_loader(TextureAtlas2D* atlas, int threads);  // atlas may be NULL, threads <= 0 picks one per core
+AssetHandle2D shade2d_load_image_async(AssetLoader2D* loader, const char* path);
+AssetHandle2D shade2d_load_object_list_async(AssetLoader2D* loader, const char* path);
+AssetStatus2D shade2d_get_asset_status(AssetLoader2D* loader, AssetHandle2D handle);
+bool shade2d_get_asset_region(AssetLoader2D* loader, AssetHandle2D handle, AtlasRegion2D* region);
+bool shade2d_take_asset_image(AssetLoader2D* loader, AssetHandle2D handle, Image2D* image);  // Loaders without an atlas
+bool shade2d_take_asset_object_list(AssetLoader2D* loader, AssetHandle2D handle, ObjectList2D* objects);
+size_t shade2d_pump_asset_loader(AssetLoader2D* loader, float budget_ms);  // Call on the context thread, returns assets finished
+void shade2d_destroy_asset_loader(AssetLoader2D* loader);
+
+// World Sharding
+typedef struct {
+    int shard_count;        // Worker processes, one per vertical strip
+    float min_x, max_x;     // Split into equal strips; the outer strips extend to infinity
+    float halo;             // Objects this close to a strip are copied into it each step
+    size_t shard_capacity;  // Owned plus halo objects per shard, 0 picks one from the object count
+    size_t queue_capacity;  // Records per queue between two shards, 0 picks one from shard_capacity
+} ShardConfig2D;
+
+typedef struct {
+    int shard;
+    float min_x, max_x;  // Strip this shard owns
+    size_t owned;        // objects[0, owned) are owned, the rest are halo copies
+} ShardInfo2D;
+
+typedef struct {
+    size_t owned;
+    size_t halo;            // Halo copies in the last step
+    size_t migrated_in;     // Totals since the world was created
+    size_t migrated_out;
+    size_t deferred;        // Migrations held back a step because a queue was full
+} ShardStats2D;
+
+// Runs in the worker process. Must not change objects->size; changes to halo copies are discarded.
+typedef void (*ShardStepFn)(ObjectList2D* objects, const ShardInfo2D* shard, float dt, void* user_data);
+
+typedef struct ShardedWorld2D ShardedWorld2D;
+
+ShardConfig2D shade2d_shard_config(int shard_count, float min_x, float max_x, float halo);
+ShardedWorld2D* shade2d_create_sharded_world(ObjectList2D objects, ShardConfig2D config, ShardStepFn step, void* user_data);
+bool shade2d_step_sharded_world(ShardedWorld2D* world, int steps, float dt);  // false once a shard failed
+bool shade2d_gather_sharded_world(ShardedWorld2D* world, ObjectList2D* objects);  // Appends every object, ordered by ID
+bool shade2d_get_shard_stats(ShardedWorld2D* world, int shard, ShardStats2D* stats);
+void shade2d_destroy_sharded_world(ShardedWorld2D* world);
 
 #endif // SHADE2D_H 
\ No newline at end of file
@@ -0,0 +1,25 @@
+// Tiny assertion helpers shared by the behaviour tests. Every failed check is
+// reported, and CHECK_DONE() turns the count into the process exit status.
+#ifndef SHADE2D_CHECK_H
+#define SHADE2D_CHECK_H
+
+#include <math.h>
+#include <stdio.h>
+
+static int check_failures = 0;
+
+#define CHECK(cond)                                                                   \
+    do {                                                                              \
+        if (!(cond)) {                                                                \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            check_failures++;                                                         \
+        }                                                                             \
+    } while (0)
+
+#define CHECK_NEAR(a, b, eps) CHECK(fabs((double)(a) - (double)(b)) <= (eps))
+
+#define CHECK_DONE()                                                             \
+    (check_failures ? (fprintf(stderr, "%s: %d check(s) failed\n", __FILE__, check_failures), 1) \
+                    : (printf("%s: ok\n", __FILE__), 0))
+
+#endif // SHADE2D_CHECK_H
@@ -0,0 +1,144 @@
+// Async asset loader: status moves through each stage, ready assets are handed over once, and destroy copes with queued work
+#define _POSIX_C_SOURCE 200809L
+#include "shade2dlib.h"
+#include "check.h"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define IMAGE "tests/asset_image.ppm"
+#define SNAPSHOT "tests/asset_world.snap"
+#define BLOCKER "tests/asset_fifo"  // Opening it blocks the worker until the test opens the other end
+#define MISSING "tests/asset_missing.ppm"
+
+static Window2D no_window;
+
+static void write_image(void) {
+    FILE *file = fopen(IMAGE, "wb");
+    if (!file) return;
+    fprintf(file, "P6\n3 2\n255\n");
+    for (int i = 0; i < 6; i++) {
+        unsigned char rgb[3] = { (unsigned char)(i * 40), 7, (unsigned char)(255 - i) };
+        fwrite(rgb, 1, 3, file);
+    }
+    fclose(file);
+}
+
+// Polls until the asset leaves the given status; the timeout only guards against a hang
+static AssetStatus2D wait_while(AssetLoader2D *loader, AssetHandle2D handle, AssetStatus2D status) {
+    struct timespec pause = { 0, 1000000 };
+    for (int i = 0; i < 10000 && shade2d_get_asset_status(loader, handle) == status; i++) {
+        nanosleep(&pause, NULL);
+    }
+    return shade2d_get_asset_status(loader, handle);
+}
+
+// Lets the worker stuck opening the FIFO go on
+static void unblock(void) {
+    int fd = open(BLOCKER, O_WRONLY);
+    if (fd >= 0) close(fd);
+}
+
+int main(void) {
+    write_image();
+    Image2D expected;
+    CHECK(shade2d_load_image(IMAGE, &expected));
+    ObjectList2D world = shade2d_create_object_list();
+    shade2d_add_object_to_list(&world, (Object2D){ SHAD2D_CIRCLE, .obj.circle = shade2d_circle(no_window, 5, 6, 7) }, 41);
+    shade2d_add_object_to_list(&world, (Object2D){ SHAD2D_RECTANGLE, .obj.rect = shade2d_rectangle(no_window, 1, 2, 3, 4) }, 42);
+    CHECK(shade2d_save_object_list(world, SNAPSHOT));
+    remove(BLOCKER);
+    CHECK(mkfifo(BLOCKER, 0600) == 0);
+
+    // One worker, held up by the FIFO, so everything behind it is still pending
+    TextureAtlas2D *atlas = shade2d_create_texture_atlas(no_window, 64);
+    AssetLoader2D *loader = shade2d_create_asset_loader(atlas, 1);
+    CHECK(loader != NULL);
+    AssetHandle2D blocked = shade2d_load_image_async(loader, BLOCKER);
+    AssetHandle2D first = shade2d_load_image_async(loader, IMAGE);
+    AssetHandle2D second = shade2d_load_image_async(loader, IMAGE);
+    AssetHandle2D missing = shade2d_load_image_async(loader, MISSING);
+    CHECK(blocked == 0 && first == 1 && second == 2 && missing == 3);
+    CHECK(shade2d_get_asset_status(loader, blocked) == SHAD2D_ASSET_PENDING);
+    CHECK(shade2d_get_asset_status(loader, first) == SHAD2D_ASSET_PENDING);
+    CHECK(shade2d_get_asset_status(loader, missing) == SHAD2D_ASSET_PENDING);
+    CHECK(shade2d_get_asset_status(loader, 99) == SHAD2D_ASSET_FAILED);
+    CHECK(shade2d_get_asset_status(loader, -1) == SHAD2D_ASSET_FAILED);
+    CHECK(shade2d_load_image_async(loader, NULL) == -1);
+
+    // Decoded images wait for the pump; a pipe can't be read as a file and nothing is at the missing path
+    unblock();
+    CHECK(wait_while(loader, blocked, SHAD2D_ASSET_PENDING) == SHAD2D_ASSET_FAILED);
+    CHECK(wait_while(loader, first, SHAD2D_ASSET_PENDING) == SHAD2D_ASSET_UPLOADING);
+    CHECK(wait_while(loader, second, SHAD2D_ASSET_PENDING) == SHAD2D_ASSET_UPLOADING);
+    CHECK(wait_while(loader, missing, SHAD2D_ASSET_PENDING) == SHAD2D_ASSET_FAILED);
+    AtlasRegion2D region;
+    CHECK(!shade2d_get_asset_region(loader, first, &region));
+
+    // A zero budget still finishes one upload per pump, oldest first
+    CHECK(shade2d_pump_asset_loader(loader, 0.0f) == 1);
+    CHECK(shade2d_get_asset_status(loader, first) == SHAD2D_ASSET_READY);
+    CHECK(shade2d_get_asset_status(loader, second) == SHAD2D_ASSET_UPLOADING);
+    CHECK(shade2d_pump_asset_loader(loader, 0.0f) == 1);
+    CHECK(shade2d_get_asset_status(loader, second) == SHAD2D_ASSET_READY);
+    CHECK(shade2d_pump_asset_loader(loader, 0.0f) == 0);
+
+    bool found = shade2d_get_asset_region(loader, first, &region);
+    CHECK(found);
+    if (found) {
+        CHECK(region.width == 3 && region.height == 2);
+        const unsigned char *texel = &atlas->pages[region.page].pixels[((region.y + 1) * 64 + region.x + 2) * 4];
+        CHECK(memcmp(texel, &expected.pixels[(1 * 3 + 2) * 4], 4) == 0);
+    }
+    Image2D image;
+    CHECK(!shade2d_take_asset_image(loader, first, &image));  // Images with an atlas stay in it
+    CHECK(!shade2d_get_asset_region(loader, missing, &region));
+    shade2d_destroy_asset_loader(loader);
+
+    // Without an atlas images are ready straight from the worker and handed over once
+    loader = shade2d_create_asset_loader(NULL, 2);
+    first = shade2d_load_image_async(loader, IMAGE);
+    AssetHandle2D snapshot = shade2d_load_object_list_async(loader, SNAPSHOT);
+    AssetHandle2D untaken = shade2d_load_object_list_async(loader, SNAPSHOT);
+    CHECK(wait_while(loader, first, SHAD2D_ASSET_PENDING) == SHAD2D_ASSET_READY);
+    CHECK(shade2d_pump_asset_loader(loader, 0.0f) == 0);
+    CHECK(!shade2d_get_asset_region(loader, first, &region));
+    CHECK(shade2d_take_asset_image(loader, first, &image));
+    CHECK(image.width == 3 && image.height == 2 && memcmp(image.pixels, expected.pixels, 3 * 2 * 4) == 0);
+    shade2d_destroy_image(image);
+    CHECK(!shade2d_take_asset_image(loader, first, &image));
+    CHECK(!shade2d_take_asset_object_list(loader, first, &world));  // Wrong kind
+
+    CHECK(wait_while(loader, snapshot, SHAD2D_ASSET_PENDING) == SHAD2D_ASSET_READY);
+    CHECK(!shade2d_take_asset_image(loader, snapshot, &image));
+    ObjectList2D loaded;
+    CHECK(shade2d_take_asset_object_list(loader, snapshot, &loaded));
+    CHECK(loaded.size == 2 && loaded.ids[0] == 41 && loaded.ids[1] == 42);
+    CHECK(memcmp(loaded.objects, world.objects, 2 * sizeof(Object2D)) == 0);
+    CHECK(!shade2d_take_asset_object_list(loader, snapshot, &loaded));
+    shade2d_destroy_object_list(loaded);
+    CHECK(wait_while(loader, untaken, SHAD2D_ASSET_PENDING) == SHAD2D_ASSET_READY);
+    shade2d_destroy_asset_loader(loader);  // Frees the snapshot nobody took
+
+    // Destroyed with work still queued, blocked, decoded and waiting for the pump
+    loader = shade2d_create_asset_loader(atlas, 1);
+    blocked = shade2d_load_image_async(loader, BLOCKER);
+    for (int i = 0; i < 20; i++) {
+        shade2d_load_image_async(loader, IMAGE);
+        shade2d_load_object_list_async(loader, SNAPSHOT);
+    }
+    CHECK(shade2d_get_asset_status(loader, blocked) == SHAD2D_ASSET_PENDING);
+    unblock();
+    CHECK(wait_while(loader, blocked, SHAD2D_ASSET_PENDING) == SHAD2D_ASSET_FAILED);
+    shade2d_destroy_asset_loader(loader);
+
+    shade2d_destroy_texture_atlas(atlas);
+    shade2d_destroy_image(expected);
+    shade2d_destroy_object_list(world);
+    remove(IMAGE);
+    remove(SNAPSHOT);
+    remove(BLOCKER);
+    return CHECK_DONE();
+}
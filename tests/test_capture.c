@@ -0,0 +1,75 @@
+// Frame capture: pattern validation and write errors reach the caller
+#include "shade2dlib.h"
+#include "check.h"
+#include <string.h>
+
+#define FRAMES 5
+
+static long file_size(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (!file) return -1;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fclose(file);
+    return size;
+}
+
+static bool is_png(const char *path) {
+    unsigned char signature[8] = {0};
+    FILE *file = fopen(path, "rb");
+    if (!file) return false;
+    size_t n = fread(signature, 1, 8, file);
+    fclose(file);
+    return n == 8 && memcmp(signature, "\x89PNG\r\n\x1A\n", 8) == 0;
+}
+
+int main(void) {
+    Window2D window = shade2d_init_headless_window("capture", 8, 6);
+
+    // PNG patterns need exactly one integer conversion
+    CHECK(shade2d_start_capture(window, "tests/frame.png", SHAD2D_CAPTURE_PNG_SEQUENCE, 60, 3) == NULL);
+    CHECK(shade2d_start_capture(window, "tests/frame_%s.png", SHAD2D_CAPTURE_PNG_SEQUENCE, 60, 3) == NULL);
+    CHECK(shade2d_start_capture(window, "tests/frame_%d_%d.png", SHAD2D_CAPTURE_PNG_SEQUENCE, 60, 3) == NULL);
+    CHECK(shade2d_start_capture(window, "tests/frame_%*d.png", SHAD2D_CAPTURE_PNG_SEQUENCE, 60, 3) == NULL);
+    CHECK(shade2d_start_capture(window, "tests/frame_%ld.png", SHAD2D_CAPTURE_PNG_SEQUENCE, 60, 3) == NULL);
+
+    FrameCapture2D *capture = shade2d_start_capture(window, "tests/capture_100%%_%03d.png", SHAD2D_CAPTURE_PNG_SEQUENCE, 60, 3);
+    CHECK(capture != NULL);
+    if (capture) {
+        for (int i = 0; i < 2; i++) shade2d_capture_frame(capture);
+        CHECK(shade2d_stop_capture(capture));
+    }
+    CHECK(is_png("tests/capture_100%_000.png"));
+    CHECK(is_png("tests/capture_100%_001.png"));
+    remove("tests/capture_100%_000.png");
+    remove("tests/capture_100%_001.png");
+
+    // Raw frames are all written
+    capture = shade2d_start_capture(window, "tests/capture.raw", SHAD2D_CAPTURE_RAW, 60, 3);
+    CHECK(capture != NULL);
+    if (capture) {
+        for (int i = 0; i < FRAMES; i++) shade2d_capture_frame(capture);
+        CHECK(!shade2d_capture_failed(capture));
+        CHECK(shade2d_stop_capture(capture));
+    }
+    CHECK(file_size("tests/capture.raw") == FRAMES * 8 * 6 * 4);
+    remove("tests/capture.raw");
+
+    // A full disk is reported instead of silently truncating the video
+    capture = shade2d_start_capture(window, "/dev/full", SHAD2D_CAPTURE_Y4M, 60, 3);
+    if (capture) {
+        for (int i = 0; i < FRAMES; i++) shade2d_capture_frame(capture);
+        CHECK(!shade2d_stop_capture(capture));
+    }
+
+    // A missing directory fails every PNG
+    capture = shade2d_start_capture(window, "tests/no/such/dir/frame_%d.png", SHAD2D_CAPTURE_PNG_SEQUENCE, 60, 3);
+    CHECK(capture != NULL);
+    if (capture) {
+        shade2d_capture_frame(capture);
+        CHECK(!shade2d_stop_capture(capture));
+    }
+
+    shade2d_destroy_window(window);
+    return CHECK_DONE();
+}
@@ -0,0 +1,83 @@
+// Collision pass: a crowded rect and circle scene ends up exactly where the plain loop over every pair puts it
+#include "shade2dlib.h"
+#include "check.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define COUNT 80
+#define STEPS 60
+#define SIZE 200.0f
+#define DT (1.0f / 60.0f)
+
+// Every pair in (i, j) order against live positions, the way the pass has always resolved them
+static void reference_pass(ObjectList2D objects) {
+    for (size_t i = 0; i < objects.size; i++) {
+        for (size_t j = i + 1; j < objects.size; j++) {
+            Object2D *a = &objects.objects[i], *b = &objects.objects[j];
+            if (!shade2d_check_collision(*a, *b)) continue;
+            if (a->type == SHAD2D_RECTANGLE && b->type == SHAD2D_RECTANGLE) {
+                shade2d_handle_collision_rect_rect(&a->obj.rect, &b->obj.rect);
+            } else if (a->type == SHAD2D_RECTANGLE && b->type == SHAD2D_CIRCLE) {
+                shade2d_handle_collision_rect_circle(&a->obj.rect, &b->obj.circle);
+            } else if (a->type == SHAD2D_CIRCLE && b->type == SHAD2D_RECTANGLE) {
+                shade2d_handle_collision_rect_circle(&b->obj.rect, &a->obj.circle);
+            } else {
+                shade2d_handle_collision_circle_circle(&a->obj.circle, &b->obj.circle);
+            }
+        }
+    }
+}
+
+static float frand(float range) {
+    return range * rand() / (float)RAND_MAX;
+}
+
+static void move(ObjectList2D objects) {
+    for (size_t i = 0; i < objects.size; i++) {
+        Object2D *o = &objects.objects[i];
+        if (o->type == SHAD2D_CIRCLE) {
+            o->obj.circle.x += o->obj.circle.velx * DT;
+            o->obj.circle.y += o->obj.circle.vely * DT;
+        } else {
+            o->obj.rect.x += o->obj.rect.velx * DT;
+            o->obj.rect.y += o->obj.rect.vely * DT;
+        }
+    }
+}
+
+int main(void) {
+    ObjectList2D pass = shade2d_create_object_list();
+    ObjectList2D loop = shade2d_create_object_list();
+    srand(5);
+    for (int i = 0; i < COUNT; i++) {
+        Object2D o;
+        memset(&o, 0, sizeof(o));
+        if (i % 3 == 0) {
+            o.type = SHAD2D_RECTANGLE;
+            o.obj.rect = (Rectangle2D){ frand(SIZE), frand(SIZE), frand(80) - 40, frand(80) - 40, 1 + frand(3), 6 + frand(14), 6 + frand(14) };
+        } else {
+            o.type = SHAD2D_CIRCLE;
+            o.obj.circle = (Circle2D){ frand(SIZE), frand(SIZE), frand(80) - 40, frand(80) - 40, 1 + frand(3), 3 + frand(7) };
+        }
+        shade2d_add_object_to_list(&pass, o, (ObjectID)i);
+        shade2d_add_object_to_list(&loop, o, (ObjectID)i);
+    }
+
+    // Crowded enough that pairs share objects, so resolution order shows in the result
+    size_t touching = 0;
+    for (int step = 0; step < STEPS; step++) {
+        for (size_t i = 0; i < loop.size; i++) {
+            for (size_t j = i + 1; j < loop.size; j++) touching += shade2d_check_collision(loop.objects[i], loop.objects[j]);
+        }
+        reference_pass(loop);
+        shade2d_handle_collisions_object_list(pass);
+        move(loop);
+        move(pass);
+    }
+    CHECK(touching > STEPS);
+    CHECK(memcmp(pass.objects, loop.objects, COUNT * sizeof(Object2D)) == 0);
+
+    shade2d_destroy_object_list(pass);
+    shade2d_destroy_object_list(loop);
+    return CHECK_DONE();
+}
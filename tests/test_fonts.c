@@ -0,0 +1,225 @@
+// Fonts: PSF1, PSF2 with a Unicode table and BDF files load their glyphs, text measures as drawn, and cut files fail
+#include "shade2dlib.h"
+#include "check.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define SIZE 32
+#define PATH "tests/font_test.bin"
+
+static Window2D no_window;
+
+typedef struct {
+    unsigned char *data;
+    size_t size;
+} Buffer;
+
+static void put(Buffer *b, const void *bytes, size_t n) {
+    b->data = realloc(b->data, b->size + n);
+    memcpy(b->data + b->size, bytes, n);
+    b->size += n;
+}
+
+static void put_byte(Buffer *b, int value) {
+    unsigned char byte = (unsigned char)value;
+    put(b, &byte, 1);
+}
+
+static void put_le32(Buffer *b, unsigned value) {
+    for (int shift = 0; shift < 32; shift += 8) put_byte(b, (int)(value >> shift));
+}
+
+static Font2D *load(TextureAtlas2D *atlas, Buffer b, size_t size) {
+    FILE *file = fopen(PATH, "wb");
+    if (!file) return NULL;
+    fwrite(b.data, 1, size, file);
+    fclose(file);
+    return shade2d_load_font(atlas, PATH);
+}
+
+// Whether the glyph's pixel (x, y) is set in the atlas
+static bool lit(const TextureAtlas2D *atlas, const FontGlyph2D *glyph, int x, int y) {
+    const AtlasRegion2D *r = &glyph->region;
+    return atlas->pages[r->page].pixels[((r->y + y) * atlas->page_size + r->x + x) * 4 + 3] == 255;
+}
+
+// 256 8x8 glyphs, no table; glyph n has its top-left pixel set and n in the last row
+static Buffer psf1(void) {
+    Buffer b = { NULL, 0 };
+    unsigned char header[4] = { 0x36, 0x04, 0x00, 8 };
+    put(&b, header, 4);
+    for (int n = 0; n < 256; n++) {
+        unsigned char rows[8] = { 0x80, 0, 0, 0, 0, 0, 0, (unsigned char)n };
+        put(&b, rows, 8);
+    }
+    return b;
+}
+
+// Four 10x12 glyphs: 0 is 'x' and Latin-1 e-acute, 1 is '?', 2 is a smiley and a sequence, 3 is 'z'
+static Buffer psf2(void) {
+    Buffer b = { NULL, 0 };
+    put_le32(&b, 0x864AB572);
+    put_le32(&b, 0);   // Version
+    put_le32(&b, 32);  // Header size
+    put_le32(&b, 1);   // Has a Unicode table
+    put_le32(&b, 4);   // Glyphs
+    put_le32(&b, 24);  // Bytes per glyph, two per row
+    put_le32(&b, 12);  // Height
+    put_le32(&b, 10);  // Width
+    for (int n = 0; n < 4; n++) {
+        unsigned char rows[24] = { 0 };
+        rows[0] = 0x80;                // (0, 0)
+        if (n == 3) rows[23] = 0x40;  // (9, 11)
+        put(&b, rows, 24);
+    }
+    put(&b, "x\xC3\xA9\xFF", 4);
+    put(&b, "?\xFF", 2);
+    put(&b, "\xE2\x98\xBA\xFE" "ab\xFF", 7);  // Codes past 255 and sequences are skipped
+    put(&b, "z\xFF", 2);
+    return b;
+}
+
+static Buffer bdf(void) {
+    static const char text[] =
+        "STARTFONT 2.1\n"
+        "FONT -test-fixed-medium-r-normal--9-90-75-75-c-60-iso8859-1\n"
+        "SIZE 9 75 75\n"
+        "FONTBOUNDINGBOX 6 9 0 -2\n"
+        "STARTPROPERTIES 2\n"
+        "FONT_ASCENT 7\n"
+        "FONT_DESCENT 2\n"
+        "ENDPROPERTIES\n"
+        "CHARS 3\n"
+        "STARTCHAR A\n"
+        "ENCODING 65\n"
+        "SWIDTH 666 0\n"
+        "DWIDTH 6 0\n"
+        "BBX 5 7 0 0\n"
+        "BITMAP\n"
+        "70\n88\n88\nF8\n88\n88\n88\n"
+        "ENDCHAR\n"
+        "STARTCHAR g\n"
+        "ENCODING 103\n"
+        "DWIDTH 7 0\n"
+        "BBX 4 6 1 -2\n"
+        "BITMAP\n"
+        "70\n90\n90\n70\n10\nE0\n"
+        "ENDCHAR\n"
+        "STARTCHAR Lslash\n"
+        "ENCODING 321\n"
+        "DWIDTH 6 0\n"
+        "BBX 5 7 0 0\n"
+        "BITMAP\n"
+        "80\n80\nA0\nC0\n80\n80\nF8\n"
+        "ENDCHAR\n"
+        "ENDFONT\n";
+    Buffer b = { NULL, 0 };
+    put(&b, text, sizeof(text) - 1);
+    return b;
+}
+
+// measure_text and draw_text agree, at two scales
+static void check_measure(const Font2D *font, SpriteBatch2D *batch, const char *text, float expected) {
+    for (float scale = 1; scale <= 2; scale++) {
+        float measured = shade2d_measure_text(font, scale, text);
+        CHECK(measured == expected * scale);
+        CHECK(shade2d_draw_text(batch, font, 3, 3, scale, 255, 255, 255, text) == measured);
+    }
+    shade2d_draw_sprite_batch(no_window, batch);  // Empties it
+}
+
+static bool pixel_is(Window2D window, int x, int y, int r, int g, int b) {
+    const unsigned char *p = &shade2d_get_framebuffer(window)[(y * SIZE + x) * 4];
+    return p[0] == r && p[1] == g && p[2] == b;
+}
+
+int main(void) {
+    Window2D window = shade2d_init_headless_window("fonts", SIZE, SIZE);
+    TextureAtlas2D *atlas = shade2d_create_texture_atlas(window, 256);
+    SpriteBatch2D *batch = shade2d_create_sprite_batch(atlas, 64);
+
+    // PSF1: every byte maps straight to its glyph
+    Buffer file = psf1();
+    Font2D *font = load(atlas, file, file.size);
+    CHECK(font != NULL);
+    if (font) {
+        CHECK(font->line_height == 8);
+        int wrong = 0;
+        for (int c = 0; c < 256; c++) {
+            const FontGlyph2D *g = &font->glyphs[c];
+            wrong += !g->present || g->advance != 8 || g->offset_x != 0 || g->offset_y != 0 || g->region.width != 8 || g->region.height != 8;
+        }
+        CHECK(wrong == 0);
+        const FontGlyph2D *a = &font->glyphs['A'];
+        CHECK(lit(atlas, a, 0, 0) && !lit(atlas, a, 1, 0));
+        CHECK(lit(atlas, a, 7, 7) && !lit(atlas, a, 6, 7) && lit(atlas, a, 1, 7));  // 65 in the last row
+        check_measure(font, batch, "AB\nCDEF", 32);
+        shade2d_destroy_font(font);
+    }
+    CHECK(load(atlas, file, file.size - 5) == NULL);  // Glyph data cut short
+    CHECK(load(atlas, file, 3) == NULL);
+    free(file.data);
+
+    // PSF2: glyphs go where the Unicode table says
+    file = psf2();
+    font = load(atlas, file, file.size);
+    CHECK(font != NULL);
+    if (font) {
+        CHECK(font->line_height == 12);
+        CHECK(font->glyphs['x'].present && font->glyphs[0xE9].present && font->glyphs['?'].present && font->glyphs['z'].present);
+        CHECK(!font->glyphs['a'].present && !font->glyphs['b'].present && !font->glyphs[0].present);
+        CHECK(lit(atlas, &font->glyphs[0xE9], 0, 0) && !lit(atlas, &font->glyphs[0xE9], 9, 11));  // Same glyph as 'x'
+        const FontGlyph2D *z = &font->glyphs['z'];
+        CHECK(z->advance == 10 && z->region.width == 10 && z->region.height == 12);
+        CHECK(lit(atlas, z, 0, 0) && lit(atlas, z, 9, 11) && !lit(atlas, z, 8, 11));
+        CHECK(!lit(atlas, &font->glyphs['x'], 9, 11));
+        check_measure(font, batch, "xz", 20);
+        check_measure(font, batch, "aq", 20);  // Missing bytes draw as '?'
+        shade2d_destroy_font(font);
+    }
+    CHECK(load(atlas, file, file.size - 1) == NULL);  // Last table entry has no terminator
+    CHECK(load(atlas, file, 32 + 4 * 24 + 4) == NULL);  // Table cut after the first glyph
+    CHECK(load(atlas, file, 32 + 3 * 24) == NULL);      // Glyph data cut short
+    free(file.data);
+
+    // BDF: offsets come from the bounding boxes, measured from the top of the line
+    file = bdf();
+    font = load(atlas, file, file.size);
+    CHECK(font != NULL);
+    if (font) {
+        CHECK(font->line_height == 9);
+        const FontGlyph2D *a = &font->glyphs['A'], *g = &font->glyphs['g'];
+        CHECK(a->present && a->advance == 6 && a->offset_x == 0 && a->offset_y == 0);
+        CHECK(a->region.width == 5 && a->region.height == 7);
+        CHECK(g->present && g->advance == 7 && g->offset_x == 1 && g->offset_y == 3);
+        CHECK(g->region.width == 4 && g->region.height == 6);
+        CHECK(!lit(atlas, a, 0, 0) && lit(atlas, a, 1, 0) && lit(atlas, a, 4, 3));
+        CHECK(lit(atlas, g, 0, 5) && !lit(atlas, g, 3, 5));
+        CHECK(!font->glyphs['L'].present);  // Encoding 321 is past Latin-1, and didn't replace 'A' either
+        check_measure(font, batch, "Ag\nAAA", 18);
+        check_measure(font, batch, "AqA", 12);  // No '?' either, so missing bytes take no space
+
+        // Drawn: 'A' with its top-left at the pen, 'g' one pixel in and three down from the next pen position
+        shade2d_set_background(window, 0, 0, 0);
+        CHECK(shade2d_draw_text(batch, font, 4, 4, 1, 255, 255, 0, "Ag") == 13);
+        shade2d_draw_sprite_batch(window, batch);
+        CHECK(!pixel_is(window, 4, 4, 255, 255, 0) && pixel_is(window, 5, 4, 255, 255, 0) && pixel_is(window, 7, 4, 255, 255, 0));
+        CHECK(!pixel_is(window, 8, 4, 255, 255, 0));
+        CHECK(pixel_is(window, 4, 7, 255, 255, 0) && pixel_is(window, 8, 7, 255, 255, 0) && !pixel_is(window, 9, 7, 255, 255, 0));
+        CHECK(pixel_is(window, 4, 10, 255, 255, 0) && !pixel_is(window, 5, 10, 255, 255, 0) && !pixel_is(window, 4, 11, 255, 255, 0));
+        CHECK(!pixel_is(window, 11, 7, 255, 255, 0) && pixel_is(window, 12, 7, 255, 255, 0));
+        CHECK(pixel_is(window, 11, 12, 255, 255, 0) && pixel_is(window, 13, 12, 255, 255, 0) && !pixel_is(window, 14, 12, 255, 255, 0));
+        CHECK(pixel_is(window, 20, 20, 0, 0, 0));
+        shade2d_destroy_font(font);
+    }
+    const char *end = strstr((const char *)file.data, "ENDCHAR\nSTARTCHAR g");
+    CHECK(load(atlas, file, (size_t)(end - (const char *)file.data) + 8) == NULL);  // Cut after the first glyph
+    CHECK(load(atlas, file, file.size - 8) == NULL);  // Only ENDFONT missing
+    free(file.data);
+
+    remove(PATH);
+    shade2d_destroy_sprite_batch(batch);
+    shade2d_destroy_texture_atlas(atlas);
+    shade2d_destroy_window(window);
+    return CHECK_DONE();
+}
@@ -0,0 +1,71 @@
+// Frame governor: degrades under load, holds in the band, and recovers to exactly full quality
+#include "shade2dlib.h"
+#include "check.h"
+
+// Feeds a frame whose stage cost is given instead of measured
+static void frame(FrameGovernor2D *governor, FrameStage2D stage, float ms) {
+    governor->stage_accum[stage] = ms;
+    shade2d_end_governed_frame(governor);
+}
+
+static void run(FrameGovernor2D *governor, FrameStage2D stage, float ms, int frames) {
+    for (int i = 0; i < frames; i++) frame(governor, stage, ms);
+}
+
+static bool at_max(const FrameGovernor2D *governor) {
+    for (int k = 0; k < SHAD2D_QUALITY_COUNT; k++) {
+        if (governor->settings[k].value != governor->settings[k].max) return false;
+    }
+    return true;
+}
+
+int main(void) {
+    FrameGovernor2D governor = shade2d_create_frame_governor(10.0f);
+    CHECK(at_max(&governor));
+
+    // Physics over budget trades physics settings first
+    run(&governor, SHAD2D_STAGE_PHYSICS, 20.0f, 16);
+    CHECK(governor.degrades == 1);
+    CHECK(governor.last_knob == SHAD2D_QUALITY_SUBSTEPS && governor.last_direction == -1);
+    CHECK(shade2d_get_quality(&governor, SHAD2D_QUALITY_SUBSTEPS) == 3);
+
+    // Sustained load runs the physics settings down to their minimum, then falls back to the others
+    run(&governor, SHAD2D_STAGE_PHYSICS, 20.0f, 2000);
+    CHECK(shade2d_get_quality(&governor, SHAD2D_QUALITY_SUBSTEPS) == 1);
+    CHECK(shade2d_get_quality(&governor, SHAD2D_QUALITY_SOLVER_ITERATIONS) == 2);
+    CHECK(shade2d_get_quality(&governor, SHAD2D_QUALITY_CIRCLE_SEGMENTS) == 8);
+
+    // Between the watermarks nothing changes
+    size_t degrades = governor.degrades, upgrades = governor.upgrades;
+    run(&governor, SHAD2D_STAGE_PHYSICS, 8.0f, 2000);
+    CHECK(governor.degrades == degrades && governor.upgrades == upgrades);
+
+    // Well under budget every degrade is undone, landing on the exact maximum
+    run(&governor, SHAD2D_STAGE_PHYSICS, 1.0f, 20000);
+    CHECK(at_max(&governor));
+    CHECK(governor.upgrades == governor.degrades);
+
+    // Quarter steps down and back from 10000 would end at 9375; history puts back the exact value
+    governor = shade2d_create_frame_governor(10.0f);
+    run(&governor, SHAD2D_STAGE_UPDATE, 20.0f, 40);
+    CHECK(governor.degrades == 3);
+    CHECK(shade2d_get_quality(&governor, SHAD2D_QUALITY_PARTICLE_CAP) == 4219);
+    int seen[3], count = 0;
+    while (governor.upgrades < 3) {
+        size_t before = governor.upgrades;
+        frame(&governor, SHAD2D_STAGE_UPDATE, 1.0f);
+        if (governor.upgrades != before) seen[count++] = shade2d_get_quality(&governor, SHAD2D_QUALITY_PARTICLE_CAP);
+    }
+    CHECK(seen[0] == 5625 && seen[1] == 7500 && seen[2] == 10000);
+
+    // More degrades than the history holds still recover all the way
+    governor = shade2d_create_frame_governor(10.0f);
+    shade2d_set_quality_bounds(&governor, SHAD2D_QUALITY_PARTICLE_CAP, 1, 1000000000);
+    run(&governor, SHAD2D_STAGE_UPDATE, 20.0f, 3000);
+    CHECK(shade2d_get_quality(&governor, SHAD2D_QUALITY_PARTICLE_CAP) == 1);
+    CHECK(governor.degrades > SHAD2D_GOVERNOR_HISTORY);
+    run(&governor, SHAD2D_STAGE_UPDATE, 1.0f, 200000);
+    CHECK(at_max(&governor));
+
+    return CHECK_DONE();
+}
@@ -0,0 +1,208 @@
+// Image decoding: PPM, QOI and TGA files written here decode to the pixels they were made from
+#include "shade2dlib.h"
+#include "check.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define W 37
+#define H 23
+#define PATH "tests/image_test.bin"
+
+static unsigned char ref[W * H * 4];
+
+// Runs, small steps between neighbours and noise with two alpha levels, so every encoder op shows up
+static void make_reference(void) {
+    srand(1);
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            unsigned char *p = &ref[(y * W + x) * 4];
+            if (x < 10) {
+                p[0] = 200, p[1] = 30, p[2] = 40, p[3] = 255;
+            } else if (x < 15) {
+                p[0] = (unsigned char)x, p[1] = (unsigned char)y, p[2] = (unsigned char)(x + y), p[3] = 255;
+            } else if (x < 20) {
+                p[0] = (unsigned char)(x * 7), p[1] = (unsigned char)(y * 11), p[2] = (unsigned char)(x + y), p[3] = 255;
+            } else {
+                p[0] = (unsigned char)rand(), p[1] = (unsigned char)rand(), p[2] = (unsigned char)rand();
+                p[3] = rand() % 2 ? 255 : 128;
+            }
+        }
+    }
+}
+
+typedef struct {
+    unsigned char *data;
+    size_t size;
+} Buffer;
+
+static void put(Buffer *b, const void *bytes, size_t n) {
+    b->data = realloc(b->data, b->size + n);
+    memcpy(b->data + b->size, bytes, n);
+    b->size += n;
+}
+
+static void put_byte(Buffer *b, int value) {
+    unsigned char byte = (unsigned char)value;
+    put(b, &byte, 1);
+}
+
+static void put_be32(Buffer *b, unsigned value) {
+    for (int shift = 24; shift >= 0; shift -= 8) put_byte(b, (int)(value >> shift));
+}
+
+static void put_le16(Buffer *b, unsigned value) {
+    put_byte(b, (int)value);
+    put_byte(b, (int)(value >> 8));
+}
+
+static void put_bgra(Buffer *b, const unsigned char *p) {
+    unsigned char bgra[4] = { p[2], p[1], p[0], p[3] };
+    put(b, bgra, 4);
+}
+
+static Buffer qoi(void) {
+    Buffer b = { NULL, 0 };
+    put(&b, "qoif", 4);
+    put_be32(&b, W);
+    put_be32(&b, H);
+    put_byte(&b, 4);
+    put_byte(&b, 0);
+    unsigned char index[64][4] = { { 0 } };
+    unsigned char prev[4] = { 0, 0, 0, 255 };
+    int run = 0;
+    for (int n = 0; n < W * H; n++) {
+        const unsigned char *p = &ref[n * 4];
+        if (memcmp(p, prev, 4) == 0) {
+            if (++run == 62 || n == W * H - 1) {
+                put_byte(&b, 0xC0 | (run - 1));
+                run = 0;
+            }
+            continue;
+        }
+        if (run) {
+            put_byte(&b, 0xC0 | (run - 1));
+            run = 0;
+        }
+        int h = (p[0] * 3 + p[1] * 5 + p[2] * 7 + p[3] * 11) % 64;
+        if (memcmp(index[h], p, 4) == 0) {
+            put_byte(&b, h);
+        } else {
+            memcpy(index[h], p, 4);
+            signed char dr = (signed char)(p[0] - prev[0]), dg = (signed char)(p[1] - prev[1]), db = (signed char)(p[2] - prev[2]);
+            if (p[3] != prev[3]) {
+                put_byte(&b, 0xFF);
+                put(&b, p, 4);
+            } else if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+                put_byte(&b, 0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2));
+            } else if (dg >= -32 && dg <= 31 && dr - dg >= -8 && dr - dg <= 7 && db - dg >= -8 && db - dg <= 7) {
+                put_byte(&b, 0x80 | (dg + 32));
+                put_byte(&b, (dr - dg + 8) << 4 | (db - dg + 8));
+            } else {
+                put_byte(&b, 0xFE);
+                put(&b, p, 3);
+            }
+        }
+        memcpy(prev, p, 4);
+    }
+    put(&b, "\0\0\0\0\0\0\0\1", 8);
+    return b;
+}
+
+// 32-bit TGA, raw rows bottom-up or run-length encoded rows top-down
+static Buffer tga(bool rle) {
+    Buffer b = { NULL, 0 };
+    unsigned char header[12] = { 0, 0, (unsigned char)(rle ? 10 : 2) };
+    put(&b, header, sizeof(header));
+    put_le16(&b, W);
+    put_le16(&b, H);
+    put_byte(&b, 32);
+    put_byte(&b, 8 | (rle ? 0x20 : 0));
+    for (int row = 0; row < H; row++) {
+        const unsigned char *line = &ref[(rle ? row : H - 1 - row) * W * 4];
+        if (!rle) {
+            for (int x = 0; x < W; x++) put_bgra(&b, &line[x * 4]);
+            continue;
+        }
+        // Packets may span rows in the format; these stay within one to keep the writer short
+        for (int x = 0; x < W;) {
+            int end = x + 1;
+            while (end < W && end - x < 128 && memcmp(&line[end * 4], &line[x * 4], 4) == 0) end++;
+            if (end - x > 1) {
+                put_byte(&b, 0x80 | (end - x - 1));
+                put_bgra(&b, &line[x * 4]);
+            } else {
+                while (end < W && end - x < 128 && memcmp(&line[end * 4], &line[(end - 1) * 4], 4) != 0) end++;
+                put_byte(&b, end - x - 1);
+                for (int k = x; k < end; k++) put_bgra(&b, &line[k * 4]);
+            }
+            x = end;
+        }
+    }
+    return b;
+}
+
+// P6 with a comment, or P5 with 16-bit samples of the red channel
+static Buffer ppm(bool gray16) {
+    Buffer b = { NULL, 0 };
+    char header[64];
+    int n = snprintf(header, sizeof(header), gray16 ? "P5\n%d %d\n1000\n" : "P6\n# made by a test\n%d %d\n255\n", W, H);
+    put(&b, header, (size_t)n);
+    for (int i = 0; i < W * H; i++) {
+        if (gray16) {
+            unsigned value = ref[i * 4] * 1000u / 255;
+            put_byte(&b, (int)(value >> 8));
+            put_byte(&b, (int)value);
+        } else {
+            put(&b, &ref[i * 4], 3);
+        }
+    }
+    return b;
+}
+
+static bool load(Buffer b, size_t size, Image2D *image) {
+    FILE *file = fopen(PATH, "wb");
+    if (!file) return false;
+    fwrite(b.data, 1, size, file);
+    fclose(file);
+    return shade2d_load_image(PATH, image);
+}
+
+// Decodes the file, then a truncated copy, which has to fail
+static void check_file(Buffer b, bool rgb_only, bool gray16) {
+    Image2D image;
+    CHECK(load(b, b.size, &image));
+    CHECK(image.width == W && image.height == H);
+    int mismatches = 0;
+    for (int i = 0; i < W * H && image.pixels; i++) {
+        const unsigned char *p = &image.pixels[i * 4], *q = &ref[i * 4];
+        if (gray16) {
+            unsigned expected = (q[0] * 1000u / 255) * 255 / 1000;
+            mismatches += p[0] != expected || p[1] != expected || p[2] != expected || p[3] != 255;
+        } else {
+            mismatches += memcmp(p, q, 3) != 0 || p[3] != (rgb_only ? 255 : q[3]);
+        }
+    }
+    CHECK(mismatches == 0);
+    shade2d_destroy_image(image);
+    CHECK(!load(b, b.size - 40, &image));
+    free(b.data);
+}
+
+int main(void) {
+    make_reference();
+    check_file(qoi(), false, false);
+    check_file(tga(false), false, false);
+    check_file(tga(true), false, false);
+    check_file(ppm(false), true, false);
+    check_file(ppm(true), false, true);
+
+    // Nothing recognisable
+    Buffer junk = { NULL, 0 };
+    put(&junk, "not an image at all", 19);
+    Image2D image;
+    CHECK(!load(junk, junk.size, &image));
+    free(junk.data);
+
+    remove(PATH);
+    return CHECK_DONE();
+}
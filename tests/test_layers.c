@@ -0,0 +1,116 @@
+// Collision layers: masks filter pairs in the broad phase and the solver, and rays ignore layers
+#include "shade2dlib.h"
+#include "check.h"
+#include <string.h>
+
+#define PLAYER 0x1u
+#define ENEMY 0x2u
+#define BULLET 0x4u
+#define GHOST 0x80000000u
+
+static Window2D no_window;
+
+static Object2D circle(float x, float y, float velx) {
+    Object2D o = {SHAD2D_CIRCLE, .obj.circle = shade2d_circle(no_window, x, y, 5)};
+    o.obj.circle.velx = velx;
+    o.obj.circle.mass = 1;
+    return o;
+}
+
+// Two circles overlapping and closing, on the given layers; true if the pass bounced them apart
+static bool bounces(uint32_t category_a, uint32_t mask_a, uint32_t category_b, uint32_t mask_b) {
+    ObjectList2D objects = shade2d_create_object_list();
+    shade2d_add_object_to_list(&objects, circle(0, 0, 10), shade2d_create_object_id());
+    shade2d_add_object_to_list(&objects, circle(8, 0, -10), shade2d_create_object_id());
+    shade2d_set_object_collision_filter(&objects, 0, category_a, mask_a);
+    shade2d_set_object_collision_filter(&objects, 1, category_b, mask_b);
+    bool overlapping = shade2d_check_collisions_object_list(objects);
+    shade2d_handle_collisions_object_list(objects);
+    bool bounced = objects.objects[0].obj.circle.velx < 0;
+    CHECK(overlapping == bounced);
+    shade2d_destroy_object_list(objects);
+    return bounced;
+}
+
+int main(void) {
+    // Both sides have to accept the other
+    CHECK(bounces(SHAD2D_CATEGORY_DEFAULT, SHAD2D_MASK_ALL, SHAD2D_CATEGORY_DEFAULT, SHAD2D_MASK_ALL));
+    CHECK(bounces(PLAYER, ENEMY, ENEMY, PLAYER));
+    CHECK(!bounces(PLAYER, ENEMY, ENEMY, BULLET));
+    CHECK(!bounces(PLAYER, SHAD2D_MASK_ALL, ENEMY, SHAD2D_MASK_ALL ^ PLAYER));
+    CHECK(!bounces(PLAYER, PLAYER, PLAYER, 0));
+    CHECK(bounces(PLAYER | BULLET, ENEMY, ENEMY, BULLET));  // Any shared bit is enough
+
+    // Stats: filtered pairs, and the narrow-phase pairs by lowest layer
+    ObjectList2D objects = shade2d_create_object_list();
+    shade2d_add_object_to_list(&objects, circle(0, 0, 0), shade2d_create_object_id());
+    shade2d_add_object_to_list(&objects, circle(4, 0, 0), shade2d_create_object_id());
+    shade2d_add_object_to_list(&objects, circle(8, 0, 0), shade2d_create_object_id());
+    shade2d_add_object_to_list(&objects, circle(500, 0, 0), shade2d_create_object_id());
+    shade2d_set_object_collision_filter(&objects, 0, PLAYER, ENEMY | GHOST);
+    shade2d_set_object_collision_filter(&objects, 1, ENEMY | BULLET, PLAYER);
+    shade2d_set_object_collision_filter(&objects, 2, GHOST, PLAYER);
+    shade2d_set_object_collision_filter(&objects, 3, ENEMY, SHAD2D_MASK_ALL);
+    // The pass resolves 0-1 before testing 0-2, so the stats come from a copy spread out to still touch after it
+    ObjectList2D spread = shade2d_create_object_list();
+    for (size_t i = 0; i < objects.size; i++) shade2d_add_object_to_list(&spread, objects.objects[i], objects.ids[i]);
+    spread.objects[1].obj.circle.x = 8;
+    spread.objects[2].obj.circle.x = 0;
+    spread.objects[2].obj.circle.y = 8;
+    memcpy(spread.categories, objects.categories, objects.size * sizeof(uint32_t));
+    memcpy(spread.masks, objects.masks, objects.size * sizeof(uint32_t));
+    CollisionStats2D stats;
+    shade2d_handle_collisions_object_list_stats(spread, &stats);
+    CHECK(stats.narrow_phase == 2);  // 0-1 and 0-2; 1-2 is filtered, 3 is too far from everyone
+    CHECK(stats.filtered == 3);      // 1-2, 1-3, 2-3
+    CHECK(stats.layer_pairs[0][1] == 1);
+    CHECK(stats.layer_pairs[0][31] == 1);
+    shade2d_destroy_object_list(spread);
+
+    // The contact solver filters the same way: a box on another layer falls through the ground
+    ObjectList2D world = shade2d_create_object_list();
+    Object2D ground = {SHAD2D_BOX, .obj.box = shade2d_box(no_window, 0, 20, 100, 20, 0)};
+    ground.obj.box.mass = 0;
+    Object2D box = {SHAD2D_BOX, .obj.box = shade2d_box(no_window, 0, 5.5f, 10, 10, 0)};
+    box.obj.box.vely = 100;
+    shade2d_add_object_to_list(&world, ground, shade2d_create_object_id());
+    shade2d_add_object_to_list(&world, box, shade2d_create_object_id());
+    shade2d_add_object_to_list(&world, box, shade2d_create_object_id());
+    world.objects[2].obj.box.x = 30;
+    shade2d_set_object_collision_filter(&world, 2, GHOST, SHAD2D_MASK_ALL ^ SHAD2D_CATEGORY_DEFAULT);
+    ContactSolver2D solver = shade2d_create_contact_solver(4);
+    shade2d_solve_contacts(&solver, world, 1.0f / 60.0f);
+    CHECK(world.objects[1].obj.box.vely < 50);
+    CHECK(world.objects[2].obj.box.vely == 100);
+    CHECK(solver.stats.narrow_phase == 1 && solver.stats.filtered == 2);
+    shade2d_destroy_contact_solver(&solver);
+    shade2d_destroy_object_list(world);
+
+    // Rays: zero ignores nothing, ignored layers are passed through, with and without the grid
+    for (int grid = 0; grid < 2; grid++) {
+        if (grid) shade2d_build_object_list_grid(&objects, 0);
+        RayHit2D hit;
+        Ray2D ray = shade2d_ray(-50, 0, 1, 0, 1000);
+        CHECK(ray.ignore == 0);
+        CHECK(shade2d_raycast_object_list(objects, ray, &hit) && hit.index == 0);
+
+        Ray2D zeroed;
+        memset(&zeroed, 0, sizeof(zeroed));
+        zeroed.x = -50, zeroed.dx = 1, zeroed.length = 1000;
+        CHECK(shade2d_raycast_object_list(objects, zeroed, &hit) && hit.index == 0);
+
+        ray.ignore = PLAYER;
+        CHECK(shade2d_raycast_object_list(objects, ray, &hit) && hit.index == 1);
+        ray.ignore = PLAYER | ENEMY;  // Object 1 is still hit through its bullet bit
+        CHECK(shade2d_raycast_object_list(objects, ray, &hit) && hit.index == 1);
+        ray.ignore = PLAYER | ENEMY | BULLET;
+        CHECK(shade2d_raycast_object_list(objects, ray, &hit) && hit.index == 2);
+        RayHit2D hits[4];
+        CHECK(shade2d_raycast_all_object_list(objects, ray, hits, 4) == 1);
+        ray.ignore = SHAD2D_MASK_ALL;
+        CHECK(!shade2d_raycast_any_object_list(objects, ray));
+    }
+
+    shade2d_destroy_object_list(objects);
+    return CHECK_DONE();
+}
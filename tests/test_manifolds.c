@@ -0,0 +1,67 @@
+// Narrow phase: SAT manifolds for boxes, polygons and circles
+#include "shade2dlib.h"
+#include "check.h"
+#include <string.h>
+
+static Window2D no_window;
+
+static Object2D box(float x, float y, float w, float h, float angle) {
+    Object2D o = {SHAD2D_BOX, .obj.box = shade2d_box(no_window, x, y, w, h, angle)};
+    return o;
+}
+
+static Object2D circle(float x, float y, float r) {
+    Object2D o = {SHAD2D_CIRCLE, .obj.circle = shade2d_circle(no_window, x, y, r)};
+    return o;
+}
+
+int main(void) {
+    Manifold2D m;
+
+    // Face to face: two points, normal along +x, depth equal to the overlap
+    Object2D a = box(0, 0, 10, 10, 0);
+    Object2D b = box(9, 2, 10, 10, 0);
+    CHECK(shade2d_collide(&a, &b, &m));
+    CHECK(m.point_count == 2);
+    CHECK_NEAR(m.normal_x, 1.0, 1e-5);
+    CHECK_NEAR(m.normal_y, 0.0, 1e-5);
+    for (int i = 0; i < m.point_count; i++) {
+        CHECK_NEAR(m.points[i].depth, 1.0, 1e-4);
+    }
+
+    // Corner into a face: one point
+    Object2D c = box(0, 0, 10, 10, 0);
+    Object2D d = box(11.5f, 0, 10, 10, 0.78539816f);
+    CHECK(shade2d_collide(&c, &d, &m));
+    CHECK(m.point_count == 1);
+    CHECK_NEAR(m.normal_x, 1.0, 1e-4);
+    CHECK_NEAR(m.points[0].depth, 5 * sqrt(2.0) - 6.5, 1e-3);
+
+    // Separated, including along a rotated axis only SAT can find
+    Object2D e = box(12.5f, 0, 10, 10, 0.78539816f);
+    CHECK(!shade2d_collide(&c, &e, &m));
+    CHECK(!shade2d_check_collision(c, e));
+
+    // Circle pressing 2 units into the flat edge of a triangle (y points down)
+    float tri[] = { -10, 5, 10, 5, 0, -5 };
+    Object2D t = {SHAD2D_POLYGON, .obj.polygon = shade2d_polygon(no_window, 0, 0, tri, 3)};
+    float edge = 5.0f;  // World y of the flat edge; shade2d_polygon keeps the shape where it was given
+    Object2D s = circle(0, edge + 1.0f, 3);
+    CHECK(shade2d_collide(&t, &s, &m));
+    CHECK(m.point_count == 1);
+    CHECK_NEAR(m.normal_y, 1.0, 1e-4);
+    CHECK_NEAR(m.points[0].depth, 2.0, 1e-3);
+
+    // Normals always point from the first object to the second
+    CHECK(shade2d_collide(&b, &a, &m));
+    CHECK_NEAR(m.normal_x, -1.0, 1e-5);
+
+    // A hand-built polygon with an out-of-range count is clamped, not overrun
+    Object2D bad = t;
+    bad.obj.polygon.vertex_count = 1000;
+    shade2d_collide(&bad, &s, &m);
+    bad.obj.polygon.vertex_count = -3;
+    CHECK(!shade2d_collide(&bad, &s, &m));
+
+    return CHECK_DONE();
+}
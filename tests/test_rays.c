@@ -0,0 +1,116 @@
+// Ray queries: hit distances and normals, grid acceleration and batches
+#include "shade2dlib.h"
+#include "check.h"
+#include <stdlib.h>
+
+#define RAYS 3000
+
+static Window2D no_window;
+
+static Object2D circle(float x, float y, float r) {
+    Object2D o = {SHAD2D_CIRCLE, .obj.circle = shade2d_circle(no_window, x, y, r)};
+    return o;
+}
+
+static Object2D rect(float x, float y, float w, float h) {
+    Object2D o = {SHAD2D_RECTANGLE, .obj.rect = shade2d_rectangle(no_window, x, y, w, h)};
+    return o;
+}
+
+static void check_queries(ObjectList2D objects) {
+    RayHit2D hit;
+
+    // First hit is the circle in front, with the normal facing back along the ray
+    CHECK(shade2d_raycast_object_list(objects, shade2d_ray(0, 0, 1, 0, 100), &hit));
+    CHECK(hit.index == 0);
+    CHECK_NEAR(hit.distance, 15.0, 1e-4);
+    CHECK_NEAR(hit.x, 15.0, 1e-4);
+    CHECK_NEAR(hit.normal_x, -1.0, 1e-4);
+
+    // All hits come back sorted, the objects behind included
+    RayHit2D hits[4];
+    CHECK(shade2d_raycast_all_object_list(objects, shade2d_ray(0, 0, 1, 0, 100), hits, 4) == 3);
+    CHECK_NEAR(hits[0].distance, 15.0, 1e-4);
+    CHECK(hits[1].index == 1);
+    CHECK_NEAR(hits[1].distance, 40.0, 1e-4);
+    CHECK(hits[2].index == 2);
+    CHECK_NEAR(hits[2].distance, 80 - 10 * sqrt(2.0), 1e-3);
+
+    // Too short, pointing away, and starting inside the circle
+    CHECK(!shade2d_raycast_any_object_list(objects, shade2d_segment(0, 0, 14, 0)));
+    CHECK(!shade2d_raycast_any_object_list(objects, shade2d_ray(0, 0, -1, 0, 100)));
+    CHECK(shade2d_raycast_object_list(objects, shade2d_ray(20, 0, 1, 0, 100), &hit));
+    CHECK(hit.index == 1);
+
+    // A swept circle touches one radius earlier, and catches a ray that would pass by
+    CHECK(shade2d_raycast_object_list(objects, shade2d_circle_cast(0, 0, 1, 0, 100, 2), &hit));
+    CHECK_NEAR(hit.distance, 13.0, 1e-3);
+    CHECK(!shade2d_raycast_any_object_list(objects, shade2d_ray(0, 6, 1, 0, 30)));
+    CHECK(shade2d_raycast_any_object_list(objects, shade2d_circle_cast(0, 6, 1, 0, 30, 2)));
+
+    // Rotated box hit on its corner
+    CHECK(shade2d_raycast_object_list(objects, shade2d_ray(80, -50, 0, 1, 100), &hit));
+    CHECK(hit.index == 2);
+    CHECK_NEAR(hit.distance, 50 - 10 * sqrt(2.0), 1e-3);
+}
+
+int main(void) {
+    ObjectList2D objects = shade2d_create_object_list();
+    shade2d_add_object_to_list(&objects, circle(20, 0, 5), shade2d_create_object_id());
+    shade2d_add_object_to_list(&objects, rect(40, -5, 10, 10), shade2d_create_object_id());
+    Object2D box = {SHAD2D_BOX, .obj.box = shade2d_box(no_window, 80, 0, 20, 20, 0.78539816f)};
+    shade2d_add_object_to_list(&objects, box, shade2d_create_object_id());
+
+    check_queries(objects);
+    shade2d_build_object_list_grid(&objects, 0);
+    check_queries(objects);
+
+    // A NaN object doesn't break the grid, and nothing hits it
+    shade2d_add_object_to_list(&objects, circle(NAN, 0, 5), shade2d_create_object_id());
+    shade2d_build_object_list_grid(&objects, 0);
+    CHECK(isfinite(objects.grid->cell_size));
+    check_queries(objects);
+
+    // A scattered field, batched on the pool twice, matches one-at-a-time queries
+    srand(7);
+    for (int i = 0; i < 500; i++) {
+        float x = (float)(rand() % 2000), y = (float)(rand() % 2000);
+        if (i % 2) {
+            shade2d_add_object_to_list(&objects, circle(x, y, 3 + rand() % 10), shade2d_create_object_id());
+        } else {
+            shade2d_add_object_to_list(&objects, rect(x, y, 5 + rand() % 20, 5 + rand() % 20), shade2d_create_object_id());
+        }
+    }
+    shade2d_build_object_list_grid(&objects, 0);
+    Ray2D *rays = malloc(RAYS * sizeof(Ray2D));
+    RayHit2D *hits = malloc(RAYS * sizeof(RayHit2D));
+    bool *did_hit = malloc(RAYS * sizeof(bool));
+    for (int i = 0; i < RAYS; i++) {
+        rays[i] = shade2d_ray((float)(rand() % 2000), (float)(rand() % 2000),
+                              (float)(rand() % 200 - 100), (float)(rand() % 200 - 100), 300);
+    }
+    for (int round = 0; round < 2; round++) {
+        size_t hit_total = shade2d_raycast_batch(objects, rays, RAYS, SHAD2D_RAY_FIRST_HIT, hits, did_hit, 4);
+        size_t expected = 0;
+        int mismatches = 0;
+        for (int i = 0; i < RAYS; i++) {
+            RayHit2D single;
+            bool found = shade2d_raycast_object_list(objects, rays[i], &single);
+            expected += found;
+            if (found != did_hit[i] || (found && (single.index != hits[i].index || single.distance != hits[i].distance))) {
+                mismatches++;
+            }
+            if (!found && hits[i].index != (size_t)-1) mismatches++;
+        }
+        CHECK(mismatches == 0);
+        CHECK(hit_total == expected);
+        CHECK(expected > 0);
+    }
+    CHECK(shade2d_raycast_batch(objects, rays, RAYS, SHAD2D_RAY_ANY_HIT, NULL, NULL, 0) > 0);
+
+    free(rays);
+    free(hits);
+    free(did_hit);
+    shade2d_destroy_object_list(objects);
+    return CHECK_DONE();
+}
@@ -0,0 +1,104 @@
+// Render layers: the callback runs only when invalidated, layers blend over earlier drawing, and lookup by name
+#include "shade2dlib.h"
+#include "check.h"
+
+#define SIZE 32
+
+typedef struct {
+    int calls;
+    unsigned char red;  // Read by the callback, so stale pixels show when it didn't run
+    SpriteBatch2D *batch;
+    AtlasRegion2D white;
+} Scene;
+
+// An opaque square and a half-transparent green square, on an otherwise transparent layer
+static void draw_scene(Window2D window, void *user_data) {
+    Scene *scene = user_data;
+    scene->calls++;
+    shade2d_set_color(window, scene->red, 0, 0);
+    shade2d_draw_rectangle(window, shade2d_rectangle(window, 2, 2, 8, 8));
+    Sprite2D sprite = shade2d_sprite(scene->white, 20, 20);
+    sprite.r = 0, sprite.b = 0, sprite.a = 128;
+    shade2d_add_sprite(scene->batch, sprite);
+    shade2d_draw_sprite_batch(window, scene->batch);
+}
+
+static bool pixel_is(Window2D window, int x, int y, int r, int g, int b) {
+    const unsigned char *p = &shade2d_get_framebuffer(window)[(y * SIZE + x) * 4];
+    return p[0] == r && p[1] == g && p[2] == b && p[3] == 255;
+}
+
+// Yellow underneath the translucent square, then the layer
+static void frame(Window2D window, RenderLayer2D *layer) {
+    shade2d_clear_window(window);
+    shade2d_set_color(window, 255, 255, 0);
+    shade2d_draw_rectangle(window, shade2d_rectangle(window, 16, 16, 8, 8));
+    shade2d_draw_render_layer(window, layer);
+}
+
+int main(void) {
+    Window2D window = shade2d_init_headless_window("layers", SIZE, SIZE);
+    shade2d_set_background(window, 0, 0, 100);
+    TextureAtlas2D *atlas = shade2d_create_texture_atlas(window, 16);
+    Image2D image = shade2d_create_image(4, 4, NULL);
+    for (int i = 0; i < 16 * 4; i++) image.pixels[i] = 255;
+    Scene scene = { 0, 255, shade2d_create_sprite_batch(atlas, 4), { 0 } };
+    CHECK(shade2d_add_image_to_atlas(atlas, image, &scene.white));
+    shade2d_destroy_image(image);
+
+    RenderLayer2D *layer = shade2d_create_render_layer(window, "background", draw_scene, &scene);
+    RenderLayer2D *other = shade2d_create_render_layer(window, "hud", NULL, NULL);
+    CHECK(layer && other);
+    CHECK(shade2d_get_render_layer(window, "background") == layer);
+    CHECK(shade2d_get_render_layer(window, "hud") == other);
+    CHECK(shade2d_get_render_layer(window, "missing") == NULL);
+    CHECK(shade2d_get_render_layer(window, NULL) == NULL);
+    CHECK(scene.calls == 0);  // Nothing is drawn until the layer is
+
+    // The layer covers what was drawn before where it is opaque, blends where it is translucent, and leaves the rest
+    frame(window, layer);
+    CHECK(scene.calls == 1);
+    CHECK(pixel_is(window, 5, 5, 255, 0, 0));
+    CHECK(pixel_is(window, 20, 20, 127, 255, 0));  // (0 * 128 + 255 * 127) / 255 over yellow
+    CHECK(pixel_is(window, 17, 17, 255, 255, 0));  // Yellow outside the green square
+    CHECK(pixel_is(window, 28, 4, 0, 0, 100));
+
+    // Drawing the square straight onto the window gives the same pixels
+    shade2d_clear_window(window);
+    shade2d_set_color(window, 255, 255, 0);
+    shade2d_draw_rectangle(window, shade2d_rectangle(window, 16, 16, 8, 8));
+    Sprite2D sprite = shade2d_sprite(scene.white, 20, 20);
+    sprite.r = 0, sprite.b = 0, sprite.a = 128;
+    shade2d_add_sprite(scene.batch, sprite);
+    shade2d_draw_sprite_batch(window, scene.batch);
+    CHECK(pixel_is(window, 20, 20, 127, 255, 0));
+
+    // Later frames reuse the cached pixels without calling back
+    scene.red = 100;
+    for (int i = 0; i < 3; i++) frame(window, layer);
+    CHECK(scene.calls == 1);
+    CHECK(pixel_is(window, 5, 5, 255, 0, 0));
+
+    // Until the layer is invalidated
+    shade2d_invalidate_render_layer(layer);
+    CHECK(scene.calls == 1);
+    frame(window, layer);
+    CHECK(scene.calls == 2);
+    CHECK(pixel_is(window, 5, 5, 100, 0, 0));
+    frame(window, layer);
+    CHECK(scene.calls == 2);
+
+    // A layer without a callback is transparent
+    shade2d_draw_render_layer(window, other);
+    CHECK(pixel_is(window, 28, 4, 0, 0, 100) && pixel_is(window, 5, 5, 100, 0, 0));
+
+    shade2d_destroy_render_layer(window, layer);
+    CHECK(shade2d_get_render_layer(window, "background") == NULL);
+    CHECK(shade2d_get_render_layer(window, "hud") == other);
+
+    // The window frees layers that are still alive
+    shade2d_destroy_sprite_batch(scene.batch);
+    shade2d_destroy_texture_atlas(atlas);
+    shade2d_destroy_window(window);
+    return CHECK_DONE();
+}
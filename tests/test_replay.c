@@ -0,0 +1,136 @@
+// Input replay: decodes every kind of change, and a replayed run matches the live one exactly
+#include "shade2dlib.h"
+#include "check.h"
+#include <string.h>
+
+#define SESSION "tests/replay_session.input"
+#define HANDMADE "tests/replay_handmade.input"
+#define FRAMES 40
+#define SIZE 32
+
+// What the game did each frame, compared bit for bit between runs
+typedef struct {
+    float dt[FRAMES];
+    float x[FRAMES];
+    unsigned char pixels[SIZE * SIZE * 4];
+    int frames;
+} Run;
+
+// A tiny game whose state depends only on the frame times it sees
+static void play(Window2D window, Run *run) {
+    memset(run, 0, sizeof(*run));
+    float x = 0, v = 50;
+    while (shade2d_is_running(window) && run->frames < FRAMES) {
+        float dt = shade2d_get_delta_time(window);
+        v += 30 * dt;
+        x += v * dt;
+        run->dt[run->frames] = dt;
+        run->x[run->frames] = x;
+        run->frames++;
+        shade2d_clear_window(window);
+        shade2d_set_color(window, 255, 128, 0);
+        shade2d_draw_circle(window, shade2d_circle(window, fmodf(x, SIZE), SIZE / 2, 4));
+        shade2d_update_window(window);
+    }
+    memcpy(run->pixels, shade2d_get_framebuffer(window), sizeof(run->pixels));
+}
+
+static void put_varint(FILE *file, unsigned long long value) {
+    while (value >= 0x80) {
+        fputc((int)(value & 0x7F) | 0x80, file);
+        value >>= 7;
+    }
+    fputc((int)value, file);
+}
+
+static void put_zigzag(FILE *file, long long value) {
+    put_varint(file, ((unsigned long long)value << 1) ^ (unsigned long long)(value >> 63));
+}
+
+int main(void) {
+    // Live: frame times come from the clock and are recorded
+    Window2D live = shade2d_init_headless_window("live", SIZE, SIZE);
+    CHECK(shade2d_start_input_recording(live, SESSION));
+    Run recorded;
+    play(live, &recorded);
+    shade2d_stop_input_recording(live);
+    shade2d_destroy_window(live);
+    CHECK(recorded.frames == FRAMES);
+
+    // Replayed twice: the same frame times, positions and pixels, then the window closes
+    for (int round = 0; round < 2; round++) {
+        Window2D window = shade2d_init_headless_window("replay", SIZE, SIZE);
+        CHECK(shade2d_start_input_replay(window, SESSION));
+        CHECK(shade2d_is_replaying(window));
+        Run replayed;
+        play(window, &replayed);
+        CHECK(replayed.frames == FRAMES);
+        CHECK(memcmp(replayed.dt, recorded.dt, sizeof(recorded.dt)) == 0);
+        CHECK(memcmp(replayed.x, recorded.x, sizeof(recorded.x)) == 0);
+        CHECK(memcmp(replayed.pixels, recorded.pixels, sizeof(recorded.pixels)) == 0);
+        CHECK(!shade2d_is_running(window));
+        shade2d_destroy_window(window);
+    }
+
+    // Written by hand: keys, buttons, whole and fractional cursor moves, frame time changes
+    FILE *file = fopen(HANDMADE, "wb");
+    CHECK(file != NULL);
+    if (!file) return CHECK_DONE();
+    fwrite("SHD2INP1", 1, 8, file);
+    fputc(0x01 | 0x02 | 0x04 | 0x10, file);  // A and C down, left button, cursor (10, -3), 16667 us
+    put_varint(file, 2);
+    put_varint(file, SHAD2D_KEY_A);
+    put_varint(file, SHAD2D_KEY_C - SHAD2D_KEY_A);
+    fputc(1 << SHAD2D_MOUSE_BUTTON_LEFT, file);
+    put_zigzag(file, 10);
+    put_zigzag(file, -3);
+    put_zigzag(file, 16667);
+    fputc(0x00, file);  // Idle
+    fputc(0x01 | 0x08 | 0x10, file);  // A up, cursor at (1.5, 2.25), 8000 us
+    put_varint(file, 1);
+    put_varint(file, SHAD2D_KEY_A);
+    double raw[2] = { 1.5, 2.25 };
+    for (int i = 0; i < 2; i++) {
+        unsigned long long bits;
+        memcpy(&bits, &raw[i], sizeof(bits));
+        for (int b = 0; b < 8; b++) fputc((int)(bits >> (b * 8)) & 0xFF, file);
+    }
+    put_zigzag(file, 8000 - 16667);
+    fclose(file);
+
+    Window2D window = shade2d_init_headless_window("handmade", SIZE, SIZE);
+    CHECK(shade2d_start_input_replay(window, HANDMADE));
+    Rectangle2D everywhere = shade2d_rectangle(window, -100, -100, 200, 200);
+    double mx, my;
+    for (int frame = 0; frame < 2; frame++) {
+        CHECK(shade2d_is_running(window));
+        CHECK(shade2d_is_key_pressed(window, SHAD2D_KEY_A));
+        CHECK(!shade2d_is_key_pressed(window, SHAD2D_KEY_B));
+        CHECK(shade2d_is_key_pressed(window, SHAD2D_KEY_C));
+        CHECK(shade2d_is_mouse_pressed_button(window, SHAD2D_MOUSE_BUTTON_LEFT, everywhere));
+        shade2d_get_mouse_position(window, &mx, &my);
+        CHECK(mx == 10 && my == -3);
+        CHECK_NEAR(shade2d_get_delta_time(window), 0.016667, 1e-7);
+        shade2d_update_window(window);
+    }
+    CHECK(shade2d_is_running(window));
+    CHECK(!shade2d_is_key_pressed(window, SHAD2D_KEY_A));
+    CHECK(shade2d_is_key_pressed(window, SHAD2D_KEY_C));
+    CHECK(shade2d_is_mouse_pressed_button(window, SHAD2D_MOUSE_BUTTON_LEFT, everywhere));
+    shade2d_get_mouse_position(window, &mx, &my);
+    CHECK(mx == 1.5 && my == 2.25);
+    CHECK_NEAR(shade2d_get_delta_time(window), 0.008, 1e-7);
+    shade2d_update_window(window);
+    CHECK(!shade2d_is_running(window));
+    shade2d_destroy_window(window);
+
+    // Not a recording
+    window = shade2d_init_headless_window("bad", SIZE, SIZE);
+    CHECK(!shade2d_start_input_replay(window, "tests/check.h"));
+    CHECK(!shade2d_is_replaying(window));
+    shade2d_destroy_window(window);
+
+    remove(SESSION);
+    remove(HANDMADE);
+    return CHECK_DONE();
+}
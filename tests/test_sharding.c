@@ -0,0 +1,108 @@
+// Sharded worlds: any number of strips gives the same result as stepping the whole list
+#include "shade2dlib.h"
+#include "check.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define COUNT 400
+#define STEPS 120
+#define WIDTH 800.0f
+#define HEIGHT 300.0f
+#define RANGE 12.0f  // Interaction distance, no more than the halo
+#define DT (1.0f / 60.0f)
+
+// Soft repulsion from every object in range, halo copies included, then integration of the owned ones
+static void step(ObjectList2D *objects, size_t owned, float dt) {
+    float *push = calloc(owned * 2 + 1, sizeof(float));
+    for (size_t i = 0; i < owned; i++) {
+        const Circle2D *a = &objects->objects[i].obj.circle;
+        for (size_t j = 0; j < objects->size; j++) {
+            const Circle2D *b = &objects->objects[j].obj.circle;
+            float dx = a->x - b->x, dy = a->y - b->y;
+            float d = sqrtf(dx * dx + dy * dy);
+            if (j == i || d >= RANGE || d == 0) continue;
+            float strength = 400.0f * (RANGE - d) / (RANGE * d);
+            push[i * 2] += dx * strength;
+            push[i * 2 + 1] += dy * strength;
+        }
+    }
+    for (size_t i = 0; i < owned; i++) {
+        Circle2D *c = &objects->objects[i].obj.circle;
+        c->velx += push[i * 2] * dt;
+        c->vely += push[i * 2 + 1] * dt;
+        c->x += c->velx * dt;
+        c->y += c->vely * dt;
+        if ((c->x < 0 && c->velx < 0) || (c->x > WIDTH && c->velx > 0)) c->velx = -c->velx;
+        if ((c->y < 0 && c->vely < 0) || (c->y > HEIGHT && c->vely > 0)) c->vely = -c->vely;
+    }
+    free(push);
+}
+
+static void shard_step(ObjectList2D *objects, const ShardInfo2D *shard, float dt, void *user_data) {
+    (void)user_data;
+    step(objects, shard->owned, dt);
+}
+
+static Object2D circle(float x, float y, float velx, float vely) {
+    Object2D o;
+    memset(&o, 0, sizeof(o));
+    o.type = SHAD2D_CIRCLE;
+    o.obj.circle = (Circle2D){ x, y, velx, vely, 1, 2 };
+    return o;
+}
+
+int main(void) {
+    ObjectList2D start = shade2d_create_object_list();
+    srand(11);
+    for (int i = 0; i < COUNT; i++) {
+        float x = WIDTH * rand() / (float)RAND_MAX, y = HEIGHT * rand() / (float)RAND_MAX;
+        float velx = 200.0f * (rand() / (float)RAND_MAX - 0.5f), vely = 60.0f * (rand() / (float)RAND_MAX - 0.5f);
+        shade2d_add_object_to_list(&start, circle(x, y, velx, vely), (ObjectID)i);
+    }
+    // Pairs straddling every strip boundary for 2, 3 and 4 strips, crossing it on the first step
+    float boundaries[] = { WIDTH / 2, WIDTH / 3, 2 * WIDTH / 3, WIDTH / 4, 3 * WIDTH / 4 };
+    for (int b = 0; b < 5; b++) {
+        float y = 20.0f + 50.0f * b;
+        shade2d_add_object_to_list(&start, circle(boundaries[b] - 1, y, 90, 0), (ObjectID)(COUNT + 2 * b));
+        shade2d_add_object_to_list(&start, circle(boundaries[b] + 6, y, -30, 0), (ObjectID)(COUNT + 2 * b + 1));
+    }
+
+    ObjectList2D single = shade2d_create_object_list();
+    for (size_t i = 0; i < start.size; i++) shade2d_add_object_to_list(&single, start.objects[i], start.ids[i]);
+    for (int s = 0; s < STEPS; s++) step(&single, single.size, DT);
+
+    for (int k = 2; k <= 4; k++) {
+        ShardedWorld2D *world = shade2d_create_sharded_world(start, shade2d_shard_config(k, 0, WIDTH, RANGE), shard_step, NULL);
+        CHECK(world != NULL);
+        if (!world) continue;
+        CHECK(shade2d_step_sharded_world(world, STEPS, DT));
+
+        ObjectList2D gathered = shade2d_create_object_list();
+        CHECK(shade2d_gather_sharded_world(world, &gathered));
+        CHECK(gathered.size == single.size);
+        size_t migrated = 0;
+        for (int s = 0; s < k; s++) {
+            ShardStats2D stats;
+            CHECK(shade2d_get_shard_stats(world, s, &stats));
+            migrated += stats.migrated_out;
+        }
+        CHECK(migrated > 0);
+
+        // Gathered by ID and single built in ID order, so index i is the same object in both
+        float worst = 0;
+        for (size_t i = 0; i < gathered.size && i < single.size; i++) {
+            CHECK(gathered.ids[i] == single.ids[i]);
+            const Circle2D *a = &gathered.objects[i].obj.circle, *b = &single.objects[i].obj.circle;
+            worst = fmaxf(worst, fmaxf(fabsf(a->x - b->x), fabsf(a->y - b->y)));
+        }
+        CHECK(worst < 0.01f);
+        if (worst >= 0.01f) printf("%d strips: off by %g\n", k, worst);
+
+        shade2d_destroy_object_list(gathered);
+        shade2d_destroy_sharded_world(world);
+    }
+
+    shade2d_destroy_object_list(single);
+    shade2d_destroy_object_list(start);
+    return CHECK_DONE();
+}
@@ -0,0 +1,122 @@
+// Snapshots: save/load round trip, and corrupt files are rejected
+#include "shade2dlib.h"
+#include "check.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define PATH "tests/snapshot_test.snap"
+#define BAD_PATH "tests/snapshot_bad.snap"
+
+static Window2D no_window;
+
+static unsigned char *read_all(const char *path, long *size) {
+    FILE *file = fopen(path, "rb");
+    if (!file) return NULL;
+    fseek(file, 0, SEEK_END);
+    *size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    unsigned char *data = malloc(*size);
+    if (fread(data, 1, *size, file) != (size_t)*size) *size = 0;
+    fclose(file);
+    return data;
+}
+
+static void write_all(const char *path, const unsigned char *data, long size) {
+    FILE *file = fopen(path, "wb");
+    if (!file) return;
+    fwrite(data, 1, size, file);
+    fclose(file);
+}
+
+// Loads a copy of the snapshot with value written at offset
+static bool load_patched(const unsigned char *data, long size, long offset, const void *value, size_t bytes) {
+    unsigned char *copy = malloc(size);
+    memcpy(copy, data, size);
+    memcpy(copy + offset, value, bytes);
+    write_all(BAD_PATH, copy, size);
+    free(copy);
+    ObjectList2D list;
+    bool ok = shade2d_load_object_list(&list, BAD_PATH);
+    if (ok) shade2d_destroy_object_list(list);
+    return ok;
+}
+
+int main(void) {
+    ObjectList2D objects = shade2d_create_object_list();
+    for (int i = 0; i < 200; i++) {
+        Object2D o;
+        float x = (float)(i % 20) * 30, y = (float)(i / 20) * 30;
+        if (i % 3 == 0) {
+            o = (Object2D){SHAD2D_CIRCLE, .obj.circle = shade2d_circle(no_window, x, y, 8)};
+        } else if (i % 3 == 1) {
+            o = (Object2D){SHAD2D_RECTANGLE, .obj.rect = shade2d_rectangle(no_window, x, y, 12, 9)};
+        } else {
+            float vertices[] = { -5, -5, 6, -4, 0, 7 };
+            o = (Object2D){SHAD2D_POLYGON, .obj.polygon = shade2d_polygon(no_window, x, y, vertices, 3)};
+        }
+        shade2d_add_object_to_list(&objects, o, shade2d_create_object_id());
+        shade2d_set_object_material(&objects, i, 0.1f * (i % 10), 0.5f);
+        shade2d_set_object_collision_filter(&objects, i, 1u << (i % 4), SHAD2D_MASK_ALL ^ (1u << (i % 5)));
+    }
+    shade2d_build_object_list_grid(&objects, 0);
+    CHECK(shade2d_save_object_list(objects, PATH));
+
+    // Everything comes back as saved
+    ObjectList2D loaded;
+    CHECK(shade2d_load_object_list(&loaded, PATH));
+    CHECK(loaded.size == objects.size);
+    CHECK(memcmp(loaded.objects, objects.objects, objects.size * sizeof(Object2D)) == 0);
+    CHECK(memcmp(loaded.ids, objects.ids, objects.size * sizeof(ObjectID)) == 0);
+    CHECK(memcmp(loaded.materials, objects.materials, objects.size * sizeof(Material2D)) == 0);
+    CHECK(memcmp(loaded.categories, objects.categories, objects.size * sizeof(uint32_t)) == 0);
+    CHECK(memcmp(loaded.masks, objects.masks, objects.size * sizeof(uint32_t)) == 0);
+    CHECK(loaded.grid != NULL);
+    if (loaded.grid) {
+        CHECK(loaded.grid->columns == objects.grid->columns && loaded.grid->rows == objects.grid->rows);
+        CHECK(loaded.grid->item_count == objects.grid->item_count);
+    }
+    RayHit2D a, b;
+    Ray2D ray = shade2d_ray(-50, 61, 1, 0, 1000);
+    CHECK(shade2d_raycast_object_list(objects, ray, &a));
+    CHECK(shade2d_raycast_object_list(loaded, ray, &b));
+    CHECK(a.id == b.id && a.distance == b.distance);
+
+    // Offsets of the arrays in the file, from where the mapping put them
+    const char *base = loaded.mapping;
+    long objects_at = (long)((const char *)loaded.objects - base);
+    long cell_start_at = (long)((const char *)loaded.grid->cell_start - base);
+    long items_at = (long)((const char *)loaded.grid->items - base);
+    size_t polygon = 2;
+    shade2d_destroy_object_list(loaded);
+
+    long size = 0;
+    unsigned char *data = read_all(PATH, &size);
+    CHECK(data != NULL && size > 0);
+
+    // Truncated: a partly written save
+    write_all(BAD_PATH, data, size / 2);
+    CHECK(!shade2d_load_object_list(&loaded, BAD_PATH));
+
+    // Unknown shape type, oversized polygon
+    ShapeType bad_type = (ShapeType)77;
+    CHECK(!load_patched(data, size, objects_at + offsetof(Object2D, type), &bad_type, sizeof(bad_type)));
+    int bad_count = 1000;
+    long vertex_count_at = objects_at + (long)(polygon * sizeof(Object2D) + offsetof(Object2D, obj.polygon.vertex_count));
+    CHECK(!load_patched(data, size, vertex_count_at, &bad_count, sizeof(bad_count)));
+
+    // Grid item past the objects, and cell offsets that go backwards
+    size_t bad_item = objects.size + 5;
+    CHECK(!load_patched(data, size, items_at, &bad_item, sizeof(bad_item)));
+    size_t bad_start = objects.grid->item_count;
+    CHECK(!load_patched(data, size, cell_start_at + (long)sizeof(size_t), &bad_start, sizeof(bad_start)));
+
+    // An untouched copy still loads, so the checks above failed for the right reason
+    size_t first_item = objects.grid->items[0];
+    CHECK(load_patched(data, size, items_at, &first_item, sizeof(first_item)));
+
+    free(data);
+    remove(PATH);
+    remove(BAD_PATH);
+    shade2d_destroy_object_list(objects);
+    return CHECK_DONE();
+}
@@ -0,0 +1,95 @@
+// Contact solver: stacks settle and warm starting doesn't depend on list order
+#include "shade2dlib.h"
+#include "check.h"
+
+#define STACK 3
+#define GRAVITY 980.0f
+#define DT (1.0f / 60.0f)
+
+static Window2D no_window;
+
+static void step(ContactSolver2D *solver, ObjectList2D objects) {
+    for (size_t i = 0; i < objects.size; i++) {
+        Box2D *b = &objects.objects[i].obj.box;
+        if (b->mass > 0) b->vely += GRAVITY * DT;
+    }
+    shade2d_solve_contacts(solver, objects, DT);
+    for (size_t i = 0; i < objects.size; i++) {
+        Box2D *b = &objects.objects[i].obj.box;
+        b->x += b->velx * DT;
+        b->y += b->vely * DT;
+        b->angle += b->angvel * DT;
+    }
+}
+
+// Ground plus a stack of boxes, fully elastic but with friction so the stack can stand
+static ObjectList2D stack(void) {
+    ObjectList2D objects = shade2d_create_object_list();
+    Object2D ground = {SHAD2D_BOX, .obj.box = shade2d_box(no_window, 200, 300, 400, 20, 0)};
+    ground.obj.box.mass = 0;
+    shade2d_add_object_to_list(&objects, ground, shade2d_create_object_id());
+    for (int i = 0; i < STACK; i++) {
+        Object2D o = {SHAD2D_BOX, .obj.box = shade2d_box(no_window, 200, 280 - 20.0f * i, 20, 20, 0)};
+        shade2d_add_object_to_list(&objects, o, shade2d_create_object_id());
+    }
+    for (size_t i = 0; i < objects.size; i++) shade2d_set_object_material(&objects, i, 1.0f, 0.6f);
+    return objects;
+}
+
+int main(void) {
+    ObjectList2D objects = stack();
+    ContactSolver2D solver = shade2d_create_contact_solver(4);
+    float top_start = objects.objects[STACK].obj.box.y;
+    for (int frame = 0; frame < 300; frame++) step(&solver, objects);
+
+    // Settled: nothing moving, the top box hasn't sunk or bounced away
+    for (size_t i = 1; i < objects.size; i++) {
+        const Box2D *b = &objects.objects[i].obj.box;
+        CHECK(fabsf(b->vely) < 1.0f);
+        CHECK(fabsf(b->velx) < 1.0f);
+        CHECK(fabsf(b->angle) < 0.02f);
+    }
+    CHECK_NEAR(objects.objects[STACK].obj.box.y, top_start, 2.0);
+
+    // The same world in reverse order still warm-starts: it barely moves, where a cold solver lets the stack sag
+    ObjectList2D reversed = shade2d_create_object_list();
+    for (size_t i = objects.size; i-- > 0;) {
+        shade2d_add_object_to_list(&reversed, objects.objects[i], objects.ids[i]);
+    }
+    ObjectList2D cold = shade2d_create_object_list();
+    for (size_t i = 0; i < reversed.size; i++) shade2d_add_object_to_list(&cold, reversed.objects[i], reversed.ids[i]);
+    ContactSolver2D cold_solver = shade2d_create_contact_solver(4);
+    step(&solver, reversed);
+    step(&cold_solver, cold);
+    float warm_max = 0, cold_max = 0;
+    for (size_t i = 0; i < reversed.size; i++) {
+        warm_max = fmaxf(warm_max, fabsf(reversed.objects[i].obj.box.vely));
+        cold_max = fmaxf(cold_max, fabsf(cold.objects[i].obj.box.vely));
+    }
+    CHECK(warm_max < cold_max / 2);
+
+    // A slow approach doesn't bounce even at restitution 1
+    ObjectList2D drop = shade2d_create_object_list();
+    shade2d_add_object_to_list(&drop, objects.objects[0], shade2d_create_object_id());
+    Object2D slow = {SHAD2D_BOX, .obj.box = shade2d_box(no_window, 200, 280.5f, 20, 20, 0)};
+    slow.obj.box.vely = 30.0f;
+    shade2d_add_object_to_list(&drop, slow, shade2d_create_object_id());
+    ContactSolver2D drop_solver = shade2d_create_contact_solver(4);
+    shade2d_solve_contacts(&drop_solver, drop, DT);
+    CHECK(drop.objects[1].obj.box.vely > -1.0f);
+    CHECK(drop.objects[1].obj.box.vely < 1.0f);
+
+    // A fast one does
+    drop.objects[1].obj.box.vely = 300.0f;
+    shade2d_solve_contacts(&drop_solver, drop, DT);
+    CHECK(drop.objects[1].obj.box.vely < -200.0f);
+
+    shade2d_destroy_contact_solver(&cold_solver);
+    shade2d_destroy_contact_solver(&drop_solver);
+    shade2d_destroy_contact_solver(&solver);
+    shade2d_destroy_object_list(cold);
+    shade2d_destroy_object_list(drop);
+    shade2d_destroy_object_list(reversed);
+    shade2d_destroy_object_list(objects);
+    return CHECK_DONE();
+}
@@ -0,0 +1,167 @@
+// Atlas and sprite batch: packing never overlaps and spills to new pages, and sprites land on the expected pixels
+#include "shade2dlib.h"
+#include "check.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define SIZE 32
+
+static Window2D no_window;
+
+static Image2D solid(int width, int height, unsigned char r, unsigned char g, unsigned char b) {
+    Image2D image = shade2d_create_image(width, height, NULL);
+    for (int i = 0; i < width * height; i++) {
+        unsigned char *p = &image.pixels[i * 4];
+        p[0] = r, p[1] = g, p[2] = b, p[3] = 255;
+    }
+    return image;
+}
+
+static const unsigned char *pixel(Window2D window, int x, int y) {
+    return &shade2d_get_framebuffer(window)[(y * SIZE + x) * 4];
+}
+
+static bool pixel_is(Window2D window, int x, int y, int r, int g, int b) {
+    const unsigned char *p = pixel(window, x, y);
+    return p[0] == r && p[1] == g && p[2] == b && p[3] == 255;
+}
+
+static void check_packing(void) {
+    TextureAtlas2D *atlas = shade2d_create_texture_atlas(no_window, 64);
+    AtlasRegion2D regions[200];
+    int count = 0;
+    srand(3);
+    while (count < 200) {
+        int width = 3 + rand() % 18, height = 3 + rand() % 18;
+        Image2D image = solid(width, height, (unsigned char)count, (unsigned char)(count >> 8), 1);
+        bool added = shade2d_add_image_to_atlas(atlas, image, &regions[count]);
+        shade2d_destroy_image(image);
+        if (!added) break;
+        count++;
+    }
+    CHECK(atlas->page_count > 1);
+    CHECK(regions[0].page == 0);
+
+    int overlaps = 0, outside = 0, wrong = 0;
+    for (int i = 0; i < count; i++) {
+        const AtlasRegion2D *a = &regions[i];
+        outside += a->x < 0 || a->y < 0 || a->x + a->width > 64 || a->y + a->height > 64;
+        for (int j = i + 1; j < count; j++) {
+            const AtlasRegion2D *b = &regions[j];
+            overlaps += a->page == b->page && a->x < b->x + b->width && b->x < a->x + a->width &&
+                        a->y < b->y + b->height && b->y < a->y + a->height;
+        }
+        // The image's pixels are where its region says, at both corners
+        const unsigned char *page = atlas->pages[a->page].pixels;
+        const unsigned char *first = &page[(a->y * 64 + a->x) * 4];
+        const unsigned char *last = &page[((a->y + a->height - 1) * 64 + a->x + a->width - 1) * 4];
+        wrong += first[0] != (unsigned char)i || first[1] != (unsigned char)(i >> 8) || memcmp(first, last, 4) != 0;
+    }
+    CHECK(overlaps == 0);
+    CHECK(outside == 0);
+    CHECK(wrong == 0);
+
+    // Once the last page is full, nothing more fits
+    Image2D big = solid(63, 63, 1, 2, 3);
+    while (shade2d_add_image_to_atlas(atlas, big, NULL)) continue;
+    CHECK(atlas->page_count == SHAD2D_ATLAS_MAX_PAGES);
+    shade2d_destroy_image(big);
+    Image2D too_big = solid(64, 64, 1, 2, 3);  // Doesn't fit with the padding
+    TextureAtlas2D *empty = shade2d_create_texture_atlas(no_window, 64);
+    CHECK(!shade2d_add_image_to_atlas(empty, too_big, NULL));
+    shade2d_destroy_image(too_big);
+    shade2d_destroy_texture_atlas(empty);
+    shade2d_destroy_texture_atlas(atlas);
+}
+
+int main(void) {
+    check_packing();
+
+    Window2D window = shade2d_init_headless_window("sprites", SIZE, SIZE);
+    shade2d_set_background(window, 0, 0, 100);
+    TextureAtlas2D *atlas = shade2d_create_texture_atlas(window, 16);
+    SpriteBatch2D *batch = shade2d_create_sprite_batch(atlas, 1);
+
+    // A 4x2 image with a different color in every texel, then single colors
+    Image2D image = shade2d_create_image(4, 2, NULL);
+    for (int ty = 0; ty < 2; ty++) {
+        for (int tx = 0; tx < 4; tx++) {
+            unsigned char *p = &image.pixels[(ty * 4 + tx) * 4];
+            p[0] = (unsigned char)(10 + tx * 60), p[1] = (unsigned char)(20 + ty * 100), p[2] = 77, p[3] = 255;
+        }
+    }
+    AtlasRegion2D texels, red, green, blue;
+    CHECK(shade2d_add_image_to_atlas(atlas, image, &texels));
+    shade2d_destroy_image(image);
+    image = solid(4, 4, 255, 0, 0);
+    CHECK(shade2d_add_image_to_atlas(atlas, image, &red));
+    shade2d_destroy_image(image);
+    image = solid(4, 4, 0, 255, 0);
+    CHECK(shade2d_add_image_to_atlas(atlas, image, &green));
+    shade2d_destroy_image(image);
+    image = solid(15, 15, 0, 0, 255);  // Fills a page by itself
+    CHECK(shade2d_add_image_to_atlas(atlas, image, &blue));
+    shade2d_destroy_image(image);
+    CHECK(red.page == 0 && green.page == 0 && blue.page == 1);
+
+    // Bad pages are refused and leave the batch alone
+    AtlasRegion2D bad = red;
+    bad.page = SHAD2D_ATLAS_MAX_PAGES;
+    CHECK(!shade2d_add_sprite(batch, shade2d_sprite(bad, 0, 0)));
+    CHECK(!shade2d_add_sprite(NULL, shade2d_sprite(red, 0, 0)));
+    CHECK(batch->count == 0);
+
+    shade2d_clear_window(window);
+
+    // Unrotated: texel (tx, ty) lands on pixel (8 + tx, 9 + ty)
+    CHECK(shade2d_add_sprite(batch, shade2d_sprite(texels, 10, 10)));
+
+    // A quarter turn clockwise on screen: texel (tx, ty) lands on pixel (20 - ty, 18 + tx)
+    Sprite2D turned = shade2d_sprite(texels, 20, 20);
+    turned.angle = 3.14159265f / 2;
+    CHECK(shade2d_add_sprite(batch, turned));
+
+    // Tint multiplies each channel, translucency blends over the background
+    Sprite2D tinted = shade2d_sprite(red, 4, 26);
+    tinted.r = 200, tinted.g = 128, tinted.b = 0;
+    CHECK(shade2d_add_sprite(batch, tinted));
+    Sprite2D faded = shade2d_sprite(red, 26, 4);
+    faded.a = 128;
+    CHECK(shade2d_add_sprite(batch, faded));
+
+    // Within a page later sprites cover earlier ones; higher pages draw after lower ones whatever the order
+    CHECK(shade2d_add_sprite(batch, shade2d_sprite(green, 4, 4)));
+    CHECK(shade2d_add_sprite(batch, shade2d_sprite(red, 4, 4)));
+    CHECK(shade2d_add_sprite(batch, shade2d_sprite(red, 14, 28)));
+    CHECK(shade2d_add_sprite(batch, shade2d_sprite(green, 14, 28)));
+    Sprite2D on_top = shade2d_sprite(blue, 26, 26);
+    on_top.width = on_top.height = 4;
+    CHECK(shade2d_add_sprite(batch, on_top));
+    CHECK(shade2d_add_sprite(batch, shade2d_sprite(red, 26, 26)));
+    CHECK(batch->count == 10 && batch->capacity >= 10);
+
+    shade2d_draw_sprite_batch(window, batch);
+    CHECK(batch->count == 0);
+
+    int misses = 0;
+    for (int ty = 0; ty < 2; ty++) {
+        for (int tx = 0; tx < 4; tx++) {
+            misses += !pixel_is(window, 8 + tx, 9 + ty, 10 + tx * 60, 20 + ty * 100, 77);
+            misses += !pixel_is(window, 20 - ty, 18 + tx, 10 + tx * 60, 20 + ty * 100, 77);
+        }
+    }
+    CHECK(misses == 0);
+    CHECK(pixel_is(window, 7, 9, 0, 0, 100) && pixel_is(window, 12, 9, 0, 0, 100));
+    CHECK(pixel_is(window, 18, 18, 0, 0, 100) && pixel_is(window, 21, 18, 0, 0, 100));
+
+    CHECK(pixel_is(window, 4, 26, 200, 0, 0));
+    CHECK(pixel_is(window, 26, 4, 128, 0, 49));  // (255 * 128 + 0 * 127) / 255 and (0 * 128 + 100 * 127) / 255
+    CHECK(pixel_is(window, 4, 4, 255, 0, 0));
+    CHECK(pixel_is(window, 14, 28, 0, 255, 0));
+    CHECK(pixel_is(window, 26, 26, 0, 0, 255));
+
+    shade2d_destroy_sprite_batch(batch);
+    shade2d_destroy_texture_atlas(atlas);
+    shade2d_destroy_window(window);
+    return CHECK_DONE();
+}
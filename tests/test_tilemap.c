@@ -0,0 +1,168 @@
+// Tilemaps: chunk merging and rebuilds, push-out from solid tiles, sliding across seams, and headless drawing
+#include "shade2dlib.h"
+#include "check.h"
+
+#define SIZE 64
+
+static Object2D circle(float x, float y, float velx, float vely, float radius) {
+    Object2D o = {SHAD2D_CIRCLE, .obj.circle = {x, y, velx, vely, 1, radius}};
+    return o;
+}
+
+static Object2D rect(float x, float y, float velx, float vely, float width, float height) {
+    Object2D o = {SHAD2D_RECTANGLE, .obj.rect = {x, y, velx, vely, 1, width, height}};
+    return o;
+}
+
+static void clear(Tilemap2D *map) {
+    for (int r = 0; r < map->rows; r++) {
+        for (int c = 0; c < map->columns; c++) shade2d_set_tile(map, c, r, 0);
+    }
+}
+
+static void fill(Tilemap2D *map, int c0, int r0, int c1, int r1, int type) {
+    for (int r = r0; r <= r1; r++) {
+        for (int c = c0; c <= c1; c++) shade2d_set_tile(map, c, r, type);
+    }
+}
+
+// Quads the first chunk merges its tiles into
+static int quads(Window2D window, Tilemap2D *map) {
+    shade2d_draw_tilemap(window, map);
+    return map->chunks[0].quad_count;
+}
+
+static bool pixel_is(Window2D window, int x, int y, int r, int g, int b) {
+    const unsigned char *p = &shade2d_get_framebuffer(window)[(y * SIZE + x) * 4];
+    return p[0] == r && p[1] == g && p[2] == b;
+}
+
+int main(void) {
+    Window2D window = shade2d_init_headless_window("tilemap", SIZE, SIZE);
+
+    // Merging: one tile per pixel, so the first chunk is the top-left 16x16 pixels
+    Tilemap2D *map = shade2d_create_tilemap(window, 48, 48, 1);
+    shade2d_set_tile_type(map, 2, 0, 255, 0, true);
+    CHECK(quads(window, map) == 0);
+    fill(map, 0, 0, 15, 0, 1);
+    CHECK(quads(window, map) == 1);  // A full row
+    fill(map, 0, 1, 15, 15, 1);
+    CHECK(quads(window, map) == 1);  // The whole chunk
+    clear(map);
+    fill(map, 2, 3, 6, 8, 1);
+    CHECK(quads(window, map) == 1);  // A block
+    fill(map, 2, 9, 3, 9, 1);
+    CHECK(quads(window, map) == 2);  // An L
+    clear(map);
+    fill(map, 0, 0, 1, 0, 1);
+    fill(map, 2, 0, 3, 0, 2);
+    fill(map, 4, 0, 4, 0, 1);
+    CHECK(quads(window, map) == 3);  // Runs of different types stay apart
+    fill(map, 0, 1, 4, 1, 1);
+    CHECK(quads(window, map) == 4);  // A run only stacks on an identical one
+    clear(map);
+    for (int r = 0; r < 16; r++) {
+        for (int c = 0; c < 16; c++) shade2d_set_tile(map, c, r, (r + c) % 2 ? 1 : 2);
+    }
+    CHECK(quads(window, map) == 256);  // A checkerboard can't merge at all
+
+    // Setting a tile dirties only its own chunk, and setting it to what it already is dirties nothing
+    shade2d_draw_tilemap(window, map);
+    int dirty = 0;
+    for (int i = 0; i < map->chunk_columns * map->chunk_rows; i++) dirty += map->chunks[i].dirty;
+    CHECK(map->chunk_columns == 3 && map->chunk_rows == 3 && dirty == 0);
+    shade2d_set_tile(map, 20, 35, 1);
+    shade2d_set_tile(map, 0, 0, shade2d_get_tile(map, 0, 0));
+    for (int i = 0; i < map->chunk_columns * map->chunk_rows; i++) CHECK(map->chunks[i].dirty == (i == 2 * 3 + 1));
+    CHECK(shade2d_get_tile(map, 20, 35) == 1 && shade2d_get_tile(map, -1, 0) == 0 && shade2d_get_tile(map, 48, 0) == 0);
+    shade2d_destroy_tilemap(map);
+
+    // Push-out: a floor along row 5 (y 50 to 60) and a lone wall tile at column 7, row 3
+    map = shade2d_create_tilemap(window, 20, 10, 10);
+    fill(map, 0, 5, 19, 5, 1);
+    shade2d_set_tile(map, 7, 3, 1);
+
+    Object2D o = rect(20, 44, 0, 30, 8, 8);  // Bottom 2 into the floor
+    CHECK(shade2d_overlap_tilemap(map, &o));
+    CHECK(shade2d_collide_tilemap(map, &o, 0.0f));
+    CHECK_NEAR(o.obj.rect.y, 42, 1e-5);
+    CHECK(o.obj.rect.x == 20 && o.obj.rect.vely == 0);
+    CHECK(!shade2d_overlap_tilemap(map, &o));
+
+    o = rect(20, 44, 0, 30, 8, 8);
+    shade2d_collide_tilemap(map, &o, 0.5f);
+    CHECK_NEAR(o.obj.rect.vely, -15, 1e-4);  // Bounces by the restitution
+
+    o = circle(35, 47, 0, 40, 5);  // 2 into the floor
+    CHECK(shade2d_collide_tilemap(map, &o, 0.0f));
+    CHECK_NEAR(o.obj.circle.y, 45, 1e-5);
+    CHECK(o.obj.circle.x == 35 && o.obj.circle.vely == 0);
+
+    o = circle(67, 35, 25, 0, 5);  // 2 into the wall's left face
+    CHECK(shade2d_collide_tilemap(map, &o, 0.0f));
+    CHECK_NEAR(o.obj.circle.x, 65, 1e-5);
+    CHECK(o.obj.circle.y == 35 && o.obj.circle.velx == 0);
+
+    o = circle(83, 35, -25, 0, 5);  // And its right face
+    CHECK(shade2d_collide_tilemap(map, &o, 0.0f));
+    CHECK_NEAR(o.obj.circle.x, 85, 1e-5);
+
+    o = circle(35, 20, 0, 0, 5);  // In the open
+    CHECK(!shade2d_overlap_tilemap(map, &o));
+    CHECK(!shade2d_collide_tilemap(map, &o, 0.0f));
+
+    shade2d_set_tile_type(map, 3, 0, 0, 255, false);  // Non-solid tiles are only drawn
+    shade2d_set_tile(map, 3, 1, 3);
+    o = circle(35, 15, 0, 0, 5);
+    CHECK(!shade2d_overlap_tilemap(map, &o));
+
+    // A circle rolling along the floor under gravity crosses the seams between tiles without catching
+    o = circle(25, 45, 100, 0, 5);
+    float lowest = 45, highest = 45;
+    bool snagged = false;
+    for (int step = 0; step < 60; step++) {
+        float dt = 1.0f / 60.0f;
+        o.obj.circle.vely += 500 * dt;
+        o.obj.circle.x += o.obj.circle.velx * dt;
+        o.obj.circle.y += o.obj.circle.vely * dt;
+        shade2d_collide_tilemap(map, &o, 0.0f);
+        snagged |= o.obj.circle.velx != 100;
+        lowest = fminf(lowest, o.obj.circle.y);
+        highest = fmaxf(highest, o.obj.circle.y);
+    }
+    CHECK(!snagged);
+    CHECK(o.obj.circle.x > 120);  // Across ten seams
+    CHECK(highest - lowest < 0.2f);
+
+    // Sitting right on a seam, sunk a little: straight up, no sideways push
+    o = circle(50, 45.5f, 100, 10, 5);
+    CHECK(shade2d_collide_tilemap(map, &o, 0.0f));
+    CHECK(o.obj.circle.x == 50);
+    CHECK_NEAR(o.obj.circle.y, 45, 1e-5);
+    CHECK(o.obj.circle.velx == 100 && o.obj.circle.vely == 0);
+    shade2d_destroy_tilemap(map);
+
+    // Drawing: tile (2, 3) of a 4-pixel map covers pixels 8-11 by 12-15
+    map = shade2d_create_tilemap(window, 16, 16, 4);
+    shade2d_set_tile_type(map, 1, 200, 50, 10, true);
+    shade2d_set_tile_type(map, 2, 0, 100, 0, false);
+    shade2d_set_tile(map, 2, 3, 1);
+    shade2d_set_tile(map, 5, 5, 2);
+    shade2d_set_background(window, 0, 0, 0);
+    shade2d_draw_tilemap(window, map);
+    CHECK(pixel_is(window, 8, 12, 200, 50, 10) && pixel_is(window, 11, 15, 200, 50, 10));
+    CHECK(pixel_is(window, 7, 12, 0, 0, 0) && pixel_is(window, 12, 12, 0, 0, 0));
+    CHECK(pixel_is(window, 8, 11, 0, 0, 0) && pixel_is(window, 8, 16, 0, 0, 0));
+    CHECK(pixel_is(window, 20, 20, 0, 100, 0) && pixel_is(window, 23, 23, 0, 100, 0));
+
+    // Moving the origin moves what's drawn
+    map->origin_x = 5;
+    shade2d_clear_window(window);
+    shade2d_draw_tilemap(window, map);
+    CHECK(pixel_is(window, 13, 12, 200, 50, 10) && pixel_is(window, 16, 15, 200, 50, 10));
+    CHECK(pixel_is(window, 12, 12, 0, 0, 0) && pixel_is(window, 17, 12, 0, 0, 0));
+
+    shade2d_destroy_tilemap(map);
+    shade2d_destroy_window(window);
+    return CHECK_DONE();
+}